@@ -63,12 +63,20 @@ SOURCES += \
     src/power_info.cpp \
     src/inverter_gateway.cpp \
     src/local_ip_address_generator.cpp \
+    src/neighbour_table.cpp \
+    src/tcp_probe.cpp \
+    src/scan_cache.cpp \
+    src/scan_concurrency.cpp \
     src/settings.cpp \
     src/dbus_fronius.cpp \
+    src/device_info_store.cpp \
     src/inverter_settings.cpp \
     src/fronius_device_info.cpp \
     src/inverter_mediator.cpp \
     src/modbus_tcp_client/modbus_tcp_client.cpp \
+    src/modbus_tcp_client/modbus_tcp_transport.cpp \
+    src/modbus_tcp_client/modbus_tcp_channel.cpp \
+    src/modbus_tcp_client/modbus_io_thread.cpp \
     src/ve_qitem_consumer.cpp \
     src/ve_qitem_init_monitor.cpp \
     src/ve_service.cpp \
@@ -78,10 +86,18 @@ SOURCES += \
     src/fronius_udp_detector.cpp \
     src/modbus_tcp_client/modbus_reply.cpp \
     src/modbus_tcp_client/modbus_client.cpp \
+    src/modbus_tcp_client/ring_buffer.cpp \
+    src/modbus_tcp_client/timer_wheel.cpp \
     src/sunspec_tools.cpp \
+    src/register_planner.cpp \
+    src/register_cache.cpp \
+    src/poll_interval_policy.cpp \
+    src/poll_scheduler.cpp \
+    src/power_limit_stage.cpp \
     src/gateway_interface.cpp \
     src/sunspec_updater.cpp \
     src/solar_api_updater.cpp \
+    src/solar_api_system_poller.cpp \
     src/data_processor.cpp \
     src/solaredge_limiter.cpp \
     src/sma_limiter.cpp
@@ -93,13 +109,22 @@ HEADERS += \
     src/power_info.h \
     src/inverter_gateway.h \
     src/local_ip_address_generator.h \
+    src/neighbour_table.h \
+    src/tcp_probe.h \
+    src/scan_cache.h \
+    src/scan_concurrency.h \
     src/settings.h \
     src/dbus_fronius.h \
+    src/device_info_store.h \
     src/inverter_settings.h \
     src/defines.h \
     src/fronius_device_info.h \
     src/inverter_mediator.h \
     src/modbus_tcp_client/modbus_tcp_client.h \
+    src/modbus_tcp_client/modbus_tcp_transport.h \
+    src/modbus_tcp_client/modbus_tcp_channel.h \
+    src/modbus_tcp_client/modbus_io_thread.h \
+    src/modbus_tcp_client/spsc_queue.h \
     src/ve_qitem_consumer.h \
     src/ve_qitem_init_monitor.h \
     src/ve_service.h \
@@ -109,10 +134,19 @@ HEADERS += \
     src/fronius_udp_detector.h \
     src/modbus_tcp_client/modbus_reply.h \
     src/modbus_tcp_client/modbus_client.h \
+    src/modbus_tcp_client/register_span.h \
+    src/modbus_tcp_client/ring_buffer.h \
+    src/modbus_tcp_client/timer_wheel.h \
     src/sunspec_tools.h \
+    src/register_planner.h \
+    src/register_cache.h \
+    src/poll_interval_policy.h \
+    src/poll_scheduler.h \
+    src/power_limit_stage.h \
     src/gateway_interface.h \
     src/sunspec_updater.h \
     src/solar_api_updater.h \
+    src/solar_api_system_poller.h \
     src/data_processor.h \
     src/solaredge_limiter.h \
     src/sma_limiter.h
@@ -5,8 +5,17 @@ DetectorReply::DetectorReply(QObject *parent) :
 {
 }
 
+void DetectorReply::cancel()
+{
+}
+
 
 AbstractDetector::AbstractDetector(QObject *parent) :
 	QObject(parent)
 {
 }
+
+quint16 AbstractDetector::tcpPort() const
+{
+	return 0;
+}
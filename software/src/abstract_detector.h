@@ -13,6 +13,13 @@ class DetectorReply : public QObject
 public:
 	virtual QString hostName() const = 0;
 
+	/*!
+	 * Stops the detection. The default implementation does nothing, so the detection runs until
+	 * it is finished. The `finished` signal is emitted in both cases, possibly from within this
+	 * function.
+	 */
+	virtual void cancel();
+
 signals:
 	void deviceFound(const DeviceInfo &info);
 
@@ -45,6 +52,12 @@ public:
 	 */
 	virtual DetectorReply *start(const QString &hostName, int timeout) = 0;
 
+	/*!
+	 * TCP port used by the detector. During a full scan, the detector is only started if a
+	 * connection to this port can be made. Returns 0 if the detector should always be started.
+	 */
+	virtual quint16 tcpPort() const;
+
 protected:
 	explicit AbstractDetector(QObject *parent = 0);
 };
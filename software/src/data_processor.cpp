@@ -97,6 +97,33 @@ void DataProcessor::process(const ThreePhasesInverterData &data)
 	mPreviousTotalEnergy = totalEnergy;
 }
 
+void DataProcessor::processPower(double acPower)
+{
+	BasicPowerInfo *pi = mInverter->meanPowerInfo();
+	double previousPower = pi->power();
+	pi->setPower(acPower);
+	InverterPhase phase = getPhase();
+	if (phase != MultiPhase) {
+		mInverter->getPowerInfo(phase)->setPower(acPower);
+		return;
+	}
+	int phaseCount = qMin(3, mInverter->deviceInfo().phaseCount);
+	if (phaseCount < 2) {
+		// A single phase inverter across two phases (split phase, in North America). The power
+		// is shared equally by L1 and L2, like in the full update.
+		mInverter->l1PowerInfo()->setPower(acPower / 2);
+		mInverter->l2PowerInfo()->setPower(acPower / 2);
+		return;
+	}
+	double factor = previousPower > 0 ? acPower / previousPower : qQNaN();
+	for (int i=0; i<phaseCount; ++i) {
+		PowerInfo *li = mInverter->getPowerInfo(static_cast<InverterPhase>(PhaseL1 + i));
+		double power = li->power();
+		li->setPower(qIsFinite(factor) && qIsFinite(power) ? power * factor :
+														   acPower / phaseCount);
+	}
+}
+
 void DataProcessor::updateEnergySettings()
 {
 	updateEnergySettings(PhaseL1);
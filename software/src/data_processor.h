@@ -29,6 +29,12 @@ public:
 
 	void process(const ThreePhasesInverterData &data);
 
+	/*!
+	 * Updates the AC power only. On multi phase inverters the power is distributed over the
+	 * phases in the same ratio as during the last full update.
+	 */
+	void processPower(double acPower);
+
 	void updateEnergySettings();
 
 private:
@@ -1,3 +1,4 @@
+#include <QTimer>
 #include "dbus_fronius.h"
 #include "defines.h"
 #include "inverter_gateway.h"
@@ -12,11 +13,20 @@ DBusFronius::DBusFronius(QObject *parent) :
 	mSettings(new Settings(VeQItems::getRoot()->itemGetOrCreate("sub/com.victronenergy.settings/Settings/Fronius", false), this)),
 	mAutoDetect(createItem("AutoDetect")),
 	mScanProgress(createItem("ScanProgress")),
-	mGateway(new InverterGateway(mSettings, this))
+	mScanConcurrency(createItem("ScanConcurrency")),
+	mScanRate(createItem("ScanRate")),
+	mGateway(new InverterGateway(mSettings, this)),
+	mRefreshTimer(new QTimer(this)),
+	mWarmStarted(false)
 {
 	connect(mGateway, SIGNAL(inverterFound(DeviceInfo)), this, SLOT(onInverterFound(DeviceInfo)));
 	connect(mGateway, SIGNAL(autoDetectChanged()), this, SLOT(onAutoDetectChanged()));
 	connect(mGateway, SIGNAL(scanProgressChanged()), this, SLOT(onScanProgressChanged()));
+	// Inverters with a working connection are not detected again, so they are marked as seen
+	// here. The store only writes the file once per RefreshInterval.
+	mRefreshTimer->setInterval(3600 * 1000);
+	connect(mRefreshTimer, SIGNAL(timeout()), this, SLOT(onRefreshTimer()));
+	mRefreshTimer->start();
 
 	VeQItemInitMonitor::monitor(mSettings->root(), this, SLOT(onSettingsInitialized()));
 	registerService();
@@ -55,6 +65,19 @@ void DBusFronius::onSettingsInitialized()
 	mGateway->initializeSettings();
 	onScanProgressChanged();
 	onAutoDetectChanged();
+
+	// Start data acquisition of the inverters found before the last restart right away. The
+	// detection below will correct the information if an inverter has changed.
+	if (!mWarmStarted) {
+		mWarmStarted = true;
+		mDeviceInfoStore.load();
+		foreach (const DeviceInfo &deviceInfo, mDeviceInfoStore.devices()) {
+			qInfo() << "Restoring inverter" << deviceInfo.productName << "@"
+					<< deviceInfo.hostName << ':' << deviceInfo.networkId;
+			addInverter(deviceInfo);
+		}
+	}
+
 	startDetection();
 }
 
@@ -69,7 +92,13 @@ void DBusFronius::onInverterFound(const DeviceInfo &deviceInfo)
 		return;
 	}
 
+	mDeviceInfoStore.setDevice(deviceInfo);
+	mDeviceInfoStore.save();
+	addInverter(deviceInfo);
+}
 
+void DBusFronius::addInverter(const DeviceInfo &deviceInfo)
+{
 	// Check if any of our mediators know about this inverter already
 	foreach (InverterMediator *m, mMediators) {
 		if (m->processNewInverter(deviceInfo))
@@ -78,12 +107,32 @@ void DBusFronius::onInverterFound(const DeviceInfo &deviceInfo)
 
 	// Allocate a new one
 	InverterMediator *m = new InverterMediator(deviceInfo, this, mSettings, this);
+	connect(m, SIGNAL(deactivated()), this, SLOT(onInverterDeactivated()));
 	mMediators.append(m);
 }
 
+void DBusFronius::onInverterDeactivated()
+{
+	// Do not start acquisition of a deactivated inverter after the next restart
+	InverterMediator *m = static_cast<InverterMediator *>(sender());
+	mDeviceInfoStore.remove(m->deviceInfo().uniqueId);
+	mDeviceInfoStore.save();
+}
+
+void DBusFronius::onRefreshTimer()
+{
+	foreach (InverterMediator *m, mMediators) {
+		if (m->isAcquiring())
+			mDeviceInfoStore.setDevice(m->deviceInfo());
+	}
+	mDeviceInfoStore.save();
+}
+
 void DBusFronius::onScanProgressChanged()
 {
 	produceDouble(mScanProgress, mGateway->scanProgress(), 0, "%");
+	produceValue(mScanConcurrency, mGateway->scanConcurrency());
+	produceDouble(mScanRate, mGateway->scanRate(), 1, "hosts/s");
 }
 
 void DBusFronius::onAutoDetectChanged()
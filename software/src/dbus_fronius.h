@@ -1,11 +1,13 @@
 #ifndef DBUS_TEST2_H
 #define DBUS_TEST2_H
 
+#include "device_info_store.h"
 #include "gateway_interface.h"
 #include "ve_service.h"
 
 class InverterGateway;
 class InverterMediator;
+class QTimer;
 class Settings;
 class VeQItem;
 
@@ -36,12 +38,23 @@ private slots:
 
 	void onAutoDetectChanged();
 
+	void onInverterDeactivated();
+
+	void onRefreshTimer();
+
 private:
+	void addInverter(const DeviceInfo &deviceInfo);
+
 	QList<InverterMediator *> mMediators;
 	Settings *mSettings;
 	VeQItem *mAutoDetect;
 	VeQItem *mScanProgress;
+	VeQItem *mScanConcurrency;
+	VeQItem *mScanRate;
 	InverterGateway *mGateway;
+	QTimer *mRefreshTimer;
+	DeviceInfoStore mDeviceInfoStore;
+	bool mWarmStarted;
 };
 
 #endif // DBUS_TEST2_H
@@ -0,0 +1,210 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <qnumeric.h>
+#include "device_info_store.h"
+
+static const int FormatVersion = 1;
+
+// NaN is stored as null. JSON has no NaN, and NaN would make every comparison of the objects fail.
+static QJsonValue fromDouble(double d)
+{
+	return qIsNaN(d) ? QJsonValue() : QJsonValue(d);
+}
+
+static double toDouble(const QJsonValue &v)
+{
+	return v.isDouble() ? v.toDouble() : qQNaN();
+}
+
+static bool isSame(double d1, double d2)
+{
+	return d1 == d2 || (qIsNaN(d1) && qIsNaN(d2));
+}
+
+DeviceInfoStore::DeviceInfoStore(const QString &fileName):
+	mFileName(fileName),
+	mDirty(false)
+{
+}
+
+QString DeviceInfoStore::defaultFileName()
+{
+	return "/data/var/lib/dbus-fronius/inverters.json";
+}
+
+void DeviceInfoStore::load()
+{
+	mDevices.clear();
+	mDirty = false;
+	QFile file(mFileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+	if (root.value("version").toInt() != FormatVersion)
+		return;
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	foreach (const QJsonValue &v, root.value("inverters").toArray()) {
+		QJsonObject o = v.toObject();
+		Record r;
+		r.lastSeen = static_cast<qint64>(o.value("lastSeen").toDouble());
+		r.deviceInfo = o.value("deviceInfo").toObject();
+		QString uniqueId = r.deviceInfo.value("uniqueId").toString();
+		if (uniqueId.isEmpty())
+			continue;
+		if (r.lastSeen + MaxAge <= now) {
+			mDirty = true;
+			continue;
+		}
+		mDevices.insert(uniqueId, r);
+	}
+}
+
+void DeviceInfoStore::save()
+{
+	if (!mDirty)
+		return;
+	QJsonArray inverters;
+	foreach (const Record &r, mDevices) {
+		QJsonObject o;
+		o.insert("lastSeen", static_cast<double>(r.lastSeen));
+		o.insert("deviceInfo", r.deviceInfo);
+		inverters.append(o);
+	}
+	QJsonObject root;
+	root.insert("version", FormatVersion);
+	root.insert("inverters", inverters);
+
+	QDir().mkpath(QFileInfo(mFileName).absolutePath());
+	QSaveFile file(mFileName);
+	if (!file.open(QIODevice::WriteOnly) ||
+		file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 ||
+		!file.commit()) {
+		qWarning() << "Could not write inverter information to" << mFileName;
+		return;
+	}
+	mDirty = false;
+}
+
+QList<DeviceInfo> DeviceInfoStore::devices() const
+{
+	QList<DeviceInfo> result;
+	foreach (const Record &r, mDevices)
+		result.append(fromJson(r.deviceInfo));
+	return result;
+}
+
+void DeviceInfoStore::setDevice(const DeviceInfo &deviceInfo)
+{
+	if (deviceInfo.uniqueId.isEmpty())
+		return;
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QJsonObject o = toJson(deviceInfo);
+	for (QHash<QString, Record>::iterator it = mDevices.begin(); it != mDevices.end();) {
+		const QJsonObject &other = it->deviceInfo;
+		if (it.key() != deviceInfo.uniqueId &&
+			other.value("hostName") == o.value("hostName") &&
+			other.value("modbusPort") == o.value("modbusPort") &&
+			other.value("networkId") == o.value("networkId")) {
+			it = mDevices.erase(it);
+			mDirty = true;
+		} else {
+			++it;
+		}
+	}
+	Record &r = mDevices[deviceInfo.uniqueId];
+	if (r.deviceInfo == o && r.lastSeen + RefreshInterval > now)
+		return;
+	r.deviceInfo = o;
+	r.lastSeen = now;
+	mDirty = true;
+}
+
+void DeviceInfoStore::remove(const QString &uniqueId)
+{
+	if (mDevices.remove(uniqueId) > 0)
+		mDirty = true;
+}
+
+QJsonObject DeviceInfoStore::toJson(const DeviceInfo &deviceInfo)
+{
+	QJsonObject o;
+	o.insert("hostName", deviceInfo.hostName);
+	o.insert("uniqueId", deviceInfo.uniqueId);
+	o.insert("productName", deviceInfo.productName);
+	o.insert("dataManagerVersion", deviceInfo.dataManagerVersion);
+	o.insert("firmwareVersion", deviceInfo.firmwareVersion);
+	o.insert("serialNumber", deviceInfo.serialNumber);
+	o.insert("modbusPort", deviceInfo.modbusPort);
+	o.insert("networkId", deviceInfo.networkId);
+	o.insert("port", deviceInfo.port);
+	o.insert("deviceType", deviceInfo.deviceType);
+	o.insert("phaseCount", deviceInfo.phaseCount);
+	o.insert("productId", deviceInfo.productId);
+	o.insert("retrievalMode", deviceInfo.retrievalMode);
+	o.insert("inverterModelOffset", deviceInfo.inverterModelOffset);
+	o.insert("inverterModel", deviceInfo.inverterModel);
+	o.insert("immediateControlOffset", deviceInfo.immediateControlOffset);
+	o.insert("immediateControlModel", deviceInfo.immediateControlModel);
+	o.insert("trackerModelOffset", deviceInfo.trackerModelOffset);
+	o.insert("numberOfTrackers", deviceInfo.numberOfTrackers);
+	o.insert("powerLimitScale", fromDouble(deviceInfo.powerLimitScale));
+	o.insert("trackerVoltageScale", fromDouble(deviceInfo.trackerVoltageScale));
+	o.insert("trackerPowerScale", fromDouble(deviceInfo.trackerPowerScale));
+	o.insert("maxPower", fromDouble(deviceInfo.maxPower));
+	o.insert("storageCapacity", fromDouble(deviceInfo.storageCapacity));
+	return o;
+}
+
+DeviceInfo DeviceInfoStore::fromJson(const QJsonObject &o)
+{
+	DeviceInfo deviceInfo;
+	deviceInfo.hostName = o.value("hostName").toString();
+	deviceInfo.uniqueId = o.value("uniqueId").toString();
+	deviceInfo.productName = o.value("productName").toString();
+	deviceInfo.dataManagerVersion = o.value("dataManagerVersion").toString();
+	deviceInfo.firmwareVersion = o.value("firmwareVersion").toString();
+	deviceInfo.serialNumber = o.value("serialNumber").toString();
+	deviceInfo.modbusPort = o.value("modbusPort").toInt(deviceInfo.modbusPort);
+	deviceInfo.networkId = o.value("networkId").toInt();
+	deviceInfo.port = o.value("port").toInt();
+	deviceInfo.deviceType = o.value("deviceType").toInt();
+	deviceInfo.phaseCount = o.value("phaseCount").toInt();
+	deviceInfo.productId = o.value("productId").toInt();
+	deviceInfo.retrievalMode = static_cast<ProtocolType>(o.value("retrievalMode").toInt());
+	deviceInfo.inverterModelOffset = o.value("inverterModelOffset").toInt();
+	deviceInfo.inverterModel = o.value("inverterModel").toInt();
+	deviceInfo.immediateControlOffset = o.value("immediateControlOffset").toInt();
+	deviceInfo.immediateControlModel = o.value("immediateControlModel").toInt();
+	deviceInfo.trackerModelOffset = o.value("trackerModelOffset").toInt();
+	deviceInfo.numberOfTrackers = o.value("numberOfTrackers").toInt();
+	deviceInfo.powerLimitScale = toDouble(o.value("powerLimitScale"));
+	deviceInfo.trackerVoltageScale = toDouble(o.value("trackerVoltageScale"));
+	deviceInfo.trackerPowerScale = toDouble(o.value("trackerPowerScale"));
+	deviceInfo.maxPower = toDouble(o.value("maxPower"));
+	deviceInfo.storageCapacity = toDouble(o.value("storageCapacity"));
+	return deviceInfo;
+}
+
+bool DeviceInfoStore::isSameLayout(const DeviceInfo &d1, const DeviceInfo &d2)
+{
+	return d1.retrievalMode == d2.retrievalMode &&
+		d1.modbusPort == d2.modbusPort &&
+		d1.networkId == d2.networkId &&
+		d1.deviceType == d2.deviceType &&
+		d1.phaseCount == d2.phaseCount &&
+		d1.inverterModelOffset == d2.inverterModelOffset &&
+		d1.inverterModel == d2.inverterModel &&
+		d1.immediateControlOffset == d2.immediateControlOffset &&
+		d1.immediateControlModel == d2.immediateControlModel &&
+		d1.trackerModelOffset == d2.trackerModelOffset &&
+		d1.numberOfTrackers == d2.numberOfTrackers &&
+		isSame(d1.powerLimitScale, d2.powerLimitScale) &&
+		isSame(d1.trackerVoltageScale, d2.trackerVoltageScale) &&
+		isSame(d1.trackerPowerScale, d2.trackerPowerScale) &&
+		isSame(d1.maxPower, d2.maxPower);
+}
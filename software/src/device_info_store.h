@@ -0,0 +1,69 @@
+#ifndef DEVICE_INFO_STORE_H
+#define DEVICE_INFO_STORE_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include "defines.h"
+
+/*!
+ * Keeps the `DeviceInfo` of the inverters found by the detectors on disk, so data acquisition
+ * can start right after a restart, without waiting for the detection to complete. The detection
+ * still runs, and corrects the information if the inverter has changed.
+ *
+ * The file is only written if the information of an inverter has changed, or if it was last
+ * written more than `RefreshInterval` ago. Inverters are removed when they are deactivated, when
+ * another inverter is found at their address, or when they have not been seen for `MaxAge`.
+ */
+class DeviceInfoStore
+{
+public:
+	static const qint64 RefreshInterval = 24 * 3600 * 1000; // ms
+	// Inverters that have not been seen for this long are removed
+	static const qint64 MaxAge = 7LL * 24 * 3600 * 1000; // ms
+
+	explicit DeviceInfoStore(const QString &fileName = defaultFileName());
+
+	static QString defaultFileName();
+
+	void load();
+
+	void save();
+
+	QList<DeviceInfo> devices() const;
+
+	/*!
+	 * Stores `deviceInfo`, and marks the inverter as seen. Other inverters stored with the same
+	 * address (host, modbus port and unit ID) are removed.
+	 */
+	void setDevice(const DeviceInfo &deviceInfo);
+
+	void remove(const QString &uniqueId);
+
+	static QJsonObject toJson(const DeviceInfo &deviceInfo);
+
+	static DeviceInfo fromJson(const QJsonObject &object);
+
+	/*!
+	 * Returns true if data can be retrieved from `d1` the same way as from `d2`, ie. the
+	 * protocol, model offsets and scale factors are the same.
+	 */
+	static bool isSameLayout(const DeviceInfo &d1, const DeviceInfo &d2);
+
+private:
+	struct Record {
+		Record():
+			lastSeen(0)
+		{}
+
+		QJsonObject deviceInfo;
+		qint64 lastSeen; // ms since epoch
+	};
+
+	QString mFileName;
+	QHash<QString, Record> mDevices; // Indexed by unique ID
+	bool mDirty;
+};
+
+#endif // DEVICE_INFO_STORE_H
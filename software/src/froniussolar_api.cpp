@@ -83,6 +83,15 @@ void FroniusSolarApi::getThreePhasesInverterDataAsync(int deviceId)
 	sendGetRequest(url, "getThreePhasesInverterData");
 }
 
+void FroniusSolarApi::getSystemDataAsync()
+{
+	QUrl url = baseUrl("/solar_api/v1/GetInverterRealtimeData.cgi");
+	QUrlQuery query;
+	query.addQueryItem("Scope", "System");
+	url.setQuery(query);
+	sendGetRequest(url, "getSystemData");
+}
+
 void FroniusSolarApi::getDeviceInfoAsync()
 {
 	QUrl url = baseUrl("/solar_api/v1/GetActiveDeviceInfo.cgi");
@@ -178,6 +187,38 @@ void FroniusSolarApi::processThreePhasesData(const QString &networkError)
 	emit threePhasesDataFound(data);
 }
 
+void FroniusSolarApi::processSystemData(const QString &networkError)
+{
+	SystemInverterData data;
+	QVariantMap map;
+	processReply(networkError, data, map);
+	if (data.error != SolarApiReply::NoError) {
+		emit systemDataFound(data);
+		return;
+	}
+	QVariant d = getByPath(map, "Body/Data");
+	// The values are listed per device ID, eg. "PAC": {"Unit": "W", "Values": {"1": 3373}}
+	QVariantMap power = getByPath(d, "PAC/Values").toMap();
+	if (power.isEmpty() && getByPath(d, "PAC").toMap().contains("Value")) {
+		data.error = SolarApiReply::ApiError;
+		data.errorMessage = "System data has no values per inverter";
+		emit systemDataFound(data);
+		return;
+	}
+	QVariantMap dayEnergy = getByPath(d, "DAY_ENERGY/Values").toMap();
+	QVariantMap yearEnergy = getByPath(d, "YEAR_ENERGY/Values").toMap();
+	QVariantMap totalEnergy = getByPath(d, "TOTAL_ENERGY/Values").toMap();
+	QStringList ids = power.keys() + totalEnergy.keys();
+	foreach (const QString &id, ids) {
+		SystemInverterValues &values = data.inverters[id.toInt()];
+		values.acPower = power.value(id).toDouble();
+		values.dayEnergy = dayEnergy.value(id).toDouble();
+		values.yearEnergy = yearEnergy.value(id).toDouble();
+		values.totalEnergy = totalEnergy.value(id).toDouble();
+	}
+	emit systemDataFound(data);
+}
+
 void FroniusSolarApi::processDeviceInfo(const QString &networkError)
 {
 	QVariantMap map;
@@ -207,6 +248,8 @@ void FroniusSolarApi::processRequest(const QString &networkError)
 		processCommonData(networkError);
 	} else if (mRequestType == "getThreePhasesInverterData") {
 		processThreePhasesData(networkError);
+	} else if (mRequestType == "getSystemData") {
+		processSystemData(networkError);
 	} else if (mRequestType == "getDeviceInfo") {
 		processDeviceInfo(networkError);
 	}
@@ -92,6 +92,30 @@ struct ThreePhasesInverterData : public SolarApiReply
 	double acVoltagePhase3;
 };
 
+struct SystemInverterValues
+{
+	SystemInverterValues():
+		acPower(0),
+		dayEnergy(0),
+		yearEnergy(0),
+		totalEnergy(0)
+	{}
+
+	double acPower;
+	double dayEnergy;
+	double yearEnergy;
+	double totalEnergy;
+};
+
+/*!
+ * @brief Power and energy of all inverters connected to the data manager.
+ * The key of `inverters` is the device ID of the inverter.
+ */
+struct SystemInverterData : public SolarApiReply
+{
+	QMap<int, SystemInverterValues> inverters;
+};
+
 struct DeviceInfoData : public SolarApiReply
 {
 	QMap<int, QString> serialInfo;
@@ -148,6 +172,14 @@ public:
 	 */
 	void getThreePhasesInverterDataAsync(int deviceId);
 
+	/*!
+	 * @brief retrieves power and energy from all inverters of the data manager
+	 * in a single request.
+	 * The systemDataFound signal will be emitted when the API call has been
+	 * handled, even if an error has occured.
+	 */
+	void getSystemDataAsync();
+
 	void getDeviceInfoAsync();
 
 signals:
@@ -170,6 +202,8 @@ signals:
 	 */
 	void threePhasesDataFound(const ThreePhasesInverterData &data);
 
+	void systemDataFound(const SystemInverterData &data);
+
 	void deviceInfoFound(const DeviceInfoData &data);
 
 private slots:
@@ -190,6 +224,8 @@ private:
 
 	void processThreePhasesData(const QString &networkError);
 
+	void processSystemData(const QString &networkError);
+
 	void processDeviceInfo(const QString &networkError);
 
 	void processReply(const QString &networkError, SolarApiReply &apiReply,
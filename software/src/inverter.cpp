@@ -19,6 +19,11 @@ Inverter::Inverter(VeQItem *root, const DeviceInfo &deviceInfo, int deviceInstan
 	mLimiterModel(createItem("Info/LimiterModel")),
 	mProductName(createItem("ProductName")),
 	mConnection(createItem("Mgmt/Connection")),
+	mPollInterval(createItem("Mgmt/PollInterval")),
+	mPollJitter(createItem("Mgmt/PollJitter")),
+	mPowerLimitWrites(createItem("Mgmt/PowerLimitWrites")),
+	mPowerLimitSuppressed(createItem("Mgmt/PowerLimitSuppressed")),
+	mPowerLimitLatency(createItem("Mgmt/PowerLimitLatency")),
 	mMeanPowerInfo(new BasicPowerInfo(root->itemGetOrCreate("Ac", false), this)),
 	mL1PowerInfo(new PowerInfo(root->itemGetOrCreate("Ac/L1", false), this)),
 	mL2PowerInfo(new PowerInfo(root->itemGetOrCreate("Ac/L2", false), this)),
@@ -293,3 +298,27 @@ void Inverter::setTrackerPower(int t, double p)
 	}
 	produceDouble(mTrackerPower[t], p, 0, "W");
 }
+
+void Inverter::setPollInterval(int interval)
+{
+	if (mPollInterval->getValue() == interval)
+		return;
+	produceValue(mPollInterval, interval, QString("%1 ms").arg(interval));
+}
+
+void Inverter::setPollJitter(int jitter)
+{
+	if (mPollJitter->getValue() == jitter)
+		return;
+	produceValue(mPollJitter, jitter, QString("%1 ms").arg(jitter));
+}
+
+void Inverter::setPowerLimitStats(int writes, int suppressed, int latency)
+{
+	if (mPowerLimitWrites->getValue() != writes)
+		produceValue(mPowerLimitWrites, writes);
+	if (mPowerLimitSuppressed->getValue() != suppressed)
+		produceValue(mPowerLimitSuppressed, suppressed);
+	if (mPowerLimitLatency->getValue() != latency)
+		produceValue(mPowerLimitLatency, latency, QString("%1 ms").arg(latency));
+}
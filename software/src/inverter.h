@@ -90,6 +90,22 @@ public:
 
 	void setTrackerPower(int t, double p);
 
+	/*!
+	 * Time between two poll cycles, in milliseconds.
+	 */
+	void setPollInterval(int interval);
+
+	/*!
+	 * Average delay of the poll cycles with respect to their schedule, in milliseconds.
+	 */
+	void setPollJitter(int jitter);
+
+	/*!
+	 * Number of power limit writes sent, number of requested limits that were not written, and
+	 * the time between sending the last write and its acknowledgement (in milliseconds).
+	 */
+	void setPowerLimitStats(int writes, int suppressed, int latency);
+
 signals:
 	void customNameChanged();
 
@@ -115,6 +131,11 @@ private:
 	VeQItem *mLimiterModel;
 	VeQItem *mProductName;
 	VeQItem *mConnection;
+	VeQItem *mPollInterval;
+	VeQItem *mPollJitter;
+	VeQItem *mPowerLimitWrites;
+	VeQItem *mPowerLimitSuppressed;
+	VeQItem *mPowerLimitLatency;
 
 	BasicPowerInfo *mMeanPowerInfo;
 	PowerInfo *mL1PowerInfo;
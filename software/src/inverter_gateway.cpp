@@ -3,14 +3,16 @@
 #include "abstract_detector.h"
 #include "settings.h"
 #include "fronius_udp_detector.h"
-
-static const int MaxSimultaneousRequests = 64;
+#include "neighbour_table.h"
+#include "tcp_probe.h"
 
 InverterGateway::InverterGateway(Settings *settings, QObject *parent) :
 	QObject(parent),
 	mSettings(settings),
+	mHostsScanned(0),
 	mTimer(new QTimer(this)),
 	mUdpDetector(new FroniusUdpDetector(this)),
+	mArpWarmUp(new ArpWarmUp(this)),
 	mAutoDetect(false),
 	mTriedFull(false),
 	mScanType(None)
@@ -19,6 +21,8 @@ InverterGateway::InverterGateway(Settings *settings, QObject *parent) :
 	mTimer->setInterval(60000);
 	connect(mTimer, SIGNAL(timeout()), this, SLOT(onTimer()));
 	connect(mUdpDetector, SIGNAL(finished()), this, SLOT(continueScan()));
+	connect(mArpWarmUp, SIGNAL(finished()), this, SLOT(onArpWarmUpFinished()));
+	mCache.load();
 }
 
 void InverterGateway::addDetector(AbstractDetector *detector) {
@@ -48,6 +52,18 @@ int InverterGateway::scanProgress() const
 	return mAutoDetect ? mAddressGenerator.progress(mActiveHosts.count()) : 100;
 }
 
+int InverterGateway::scanConcurrency() const
+{
+	return mConcurrency.limit();
+}
+
+double InverterGateway::scanRate() const
+{
+	if (!mScanClock.isValid())
+		return 0;
+	return mHostsScanned * 1000.0 / qMax<qint64>(1, mScanClock.elapsed());
+}
+
 void InverterGateway::initializeSettings()
 {
 	disconnect(mSettings, SIGNAL(portNumberChanged()), 0, 0);
@@ -75,11 +91,29 @@ void InverterGateway::scan(enum ScanType scanType)
 {
 	mScanType = scanType;
 	mDevicesFound.clear();
+	// Valid again once the sweep of this scan has started
+	mScanClock.invalidate();
 	setAutoDetect(mScanType == Full);
 
 	// Do a UDP scan if a full scan was requested, or on the periodic priority
 	// scan (but only if autoScan permitted).
 	mUdpDetector->reset();
+	// A full scan requested by the user ignores the negative results of earlier scans, so it
+	// also finds inverters on hosts that were not an inverter before. The full scan we fall back
+	// to after a TryPriority scan does use them.
+	mAddressGenerator.setScanCache(scanType == Full ? 0 : &mCache);
+	if (scanType == Full) {
+		// While the UDP detector is waiting for replies, make the kernel resolve the MAC
+		// addresses of all hosts in the subnets. The hosts that respond end up in the neighbour
+		// table, so they are scanned first. Warming up a large subnet takes longer than the UDP
+		// detection, so the table is read again when the warm-up is done. This is only done for
+		// small subnets, see ArpWarmUp.
+		LocalIpAddressGenerator generator;
+		QList<QHostAddress> addresses;
+		while (generator.hasNext() && addresses.size() <= ArpWarmUp::MaxAddresses)
+			addresses.append(generator.next());
+		mArpWarmUp->start(addresses);
+	}
 	if ((scanType == Full) || ((scanType == TryPriority) && mSettings->autoScan())) {
 		mUdpDetector->start();
 	} else {
@@ -99,16 +133,44 @@ void InverterGateway::continueScan()
 		}
 	}
 
+	// Recheck the inverters found by earlier scans, also after a restart
+	foreach (QHostAddress a, mCache.inverters()) {
+		if (!addresses.contains(a))
+			addresses.append(a);
+	}
+
 	// If priority scan and no known PV-inverters, then we're done
 	if (mScanType == Priority && addresses.isEmpty())
 		return;
 
 	qDebug() << "Starting IP scan (" << mScanType << ")";
 	mAddressGenerator.setPriorityAddresses(addresses);
+	mPriorityAddresses = QSet<QHostAddress>(addresses.begin(), addresses.end());
 	mAddressGenerator.setPriorityOnly(mScanType != Full);
-	mAddressGenerator.reset();
+	mNeighbours = NeighbourTable::read();
+	mAddressGenerator.reset(mNeighbours);
+	mScanClock.start();
+	mHostsScanned = 0;
+
+	scanNextHosts();
+}
+
+void InverterGateway::onArpWarmUpFinished()
+{
+	// Only needed if the sweep has started before the warm-up was done
+	if (mScanType != Full || !mScanClock.isValid())
+		return;
+	QHash<QHostAddress, QString> neighbours = NeighbourTable::read();
+	for (QHash<QHostAddress, QString>::const_iterator it = neighbours.begin();
+		 it != neighbours.end(); ++it)
+		mNeighbours.insert(it.key(), it.value());
+	mAddressGenerator.addNeighbours(neighbours);
+	scanNextHosts();
+}
 
-	while (mActiveHosts.size() < MaxSimultaneousRequests && mAddressGenerator.hasNext()) {
+void InverterGateway::scanNextHosts()
+{
+	while (mActiveHosts.size() < mConcurrency.limit() && mAddressGenerator.hasNext()) {
 		QString host = mAddressGenerator.next().toString();
 		qDebug() << "Starting scan for" << host;
 		scanHost(host);
@@ -117,11 +179,18 @@ void InverterGateway::continueScan()
 
 void InverterGateway::scanHost(QString hostName)
 {
-	HostScan *host = new HostScan(mDetectors, hostName);
+	// Probe the addresses from the network sweep only: known addresses are always scanned by
+	// the detectors, so an inverter that responds slowly is not missed.
+	bool probe = mScanType == Full && !mPriorityAddresses.contains(QHostAddress(hostName));
+	HostScan *host = new HostScan(mDetectors, hostName, probe);
+	// Most addresses of the sweep are empty. Only spend a second, slower probe on hosts the
+	// neighbour table lists as alive. A wrong negative result expires with the cache entry.
+	host->setConfirmNoResponse(mNeighbours.contains(QHostAddress(hostName)));
 	mActiveHosts.append(host);
 	connect(host, SIGNAL(finished()), this, SLOT(onDetectionDone()));
 	connect(host, SIGNAL(deviceFound(const DeviceInfo &)),
 			this, SLOT(onInverterFound(const DeviceInfo &)));
+	connect(host, SIGNAL(hostProbed(qint64, bool)), this, SLOT(onHostProbed(qint64, bool)));
 	host->scan();
 }
 
@@ -129,6 +198,7 @@ void InverterGateway::onInverterFound(const DeviceInfo &deviceInfo)
 {
 	QHostAddress addr(deviceInfo.hostName);
 	mDevicesFound.insert(addr);
+	mCache.setInverter(deviceInfo, mNeighbours.value(addr));
 
 	// If the found address is already in the list of manually configured
 	// addresses, do not append it to the list of discovered addresses.
@@ -148,15 +218,23 @@ void InverterGateway::onDetectionDone()
 	qDebug() << "Done scanning" << host->hostName();
 	mActiveHosts.removeOne(host);
 	host->deleteLater();
+	// Only hosts from the network sweep are probed, priority addresses are never marked negative
+	if (!host->hasFoundDevice() && host->probeResult() != HostScan::NotProbed) {
+		QHostAddress address(host->hostName());
+		mCache.setNoInverter(address, host->probeResult() == HostScan::Responded,
+							 mNeighbours.value(address));
+	}
+	++mHostsScanned;
 	updateScanProgress();
 
 	if (mScanType > None && mAddressGenerator.hasNext()) {
-		// Scan the next available host
-		scanHost(mAddressGenerator.next().toString());
+		// Scan the next available hosts
+		scanNextHosts();
 	} else if(mActiveHosts.size() == 0) {
 		// Scan is complete
 		enum ScanType scanType = mScanType;
 		mScanType = None;
+		mCache.save();
 
 		// Did we get what we came for? For full and priority scans, this is it.
 		// For TryPriority scans, we switch to a full scan if we're a few
@@ -187,6 +265,16 @@ void InverterGateway::onDetectionDone()
 	}
 }
 
+void InverterGateway::onHostProbed(qint64 rtt, bool lost)
+{
+	int limit = mConcurrency.limit();
+	mConcurrency.onHostProbed(rtt, lost);
+	if (mConcurrency.limit() != limit) {
+		qDebug() << "Scan concurrency:" << mConcurrency.limit() << "base RTT:"
+				 << mConcurrency.baseRtt() << "ms";
+	}
+}
+
 void InverterGateway::onPortNumberChanged()
 {
 	// If the port was changed, assume that the IP addresses did not, and
@@ -214,36 +302,136 @@ void InverterGateway::updateScanProgress()
 	emit scanProgressChanged();
 }
 
-HostScan::HostScan(QList<AbstractDetector *> detectors, QString hostname, QObject *parent) :
+HostScan::HostScan(QList<AbstractDetector *> detectors, QString hostname, bool probe,
+				   QObject *parent) :
 	QObject(parent),
 	mDetectors(detectors),
-	mHostname(hostname)
+	mHostname(hostname),
+	mProbe(probe),
+	mConfirmNoResponse(false),
+	mConfirming(false),
+	mProbeResult(NotProbed),
+	mFoundDevice(false)
 {
 }
 
 void HostScan::scan()
 {
-	while (mDetectors.size()) {
-		DetectorReply *reply = mDetectors.takeFirst()->start(mHostname, 15000);
-		if (reply != 0) {
-			connect(reply, SIGNAL(deviceFound(const DeviceInfo &)),
-				this, SLOT(onDeviceFound(const DeviceInfo &)));
-			connect(reply, SIGNAL(finished()), this, SLOT(continueScan()));
+	if (mProbe) {
+		mProbe = false;
+		foreach (AbstractDetector *d, mDetectors) {
+			quint16 port = d->tcpPort();
+			if (port != 0 && !mProbePorts.contains(port))
+				mProbePorts.append(port);
+		}
+		if (!mProbePorts.isEmpty()) {
+			startProbe(0);
 			return;
 		}
 	}
 
-	emit finished();
+	foreach (AbstractDetector *detector, mDetectors) {
+		DetectorReply *reply = detector->start(mHostname, 15000);
+		if (reply == 0)
+			continue;
+		connect(reply, SIGNAL(deviceFound(const DeviceInfo &)),
+			this, SLOT(onDeviceFound(const DeviceInfo &)));
+		connect(reply, SIGNAL(finished()), this, SLOT(onDetectorFinished()));
+		Run run;
+		run.reply = reply;
+		mRuns.append(run);
+	}
+	mDetectors.clear();
+	flush();
 }
 
-void HostScan::continueScan() {
+void HostScan::onDetectorFinished()
+{
 	DetectorReply *reply = static_cast<DetectorReply *>(sender());
 	reply->deleteLater();
-	scan(); // Try next detector
+	int index = indexOf(reply);
+	if (index < 0)
+		return;
+	mRuns[index].finished = true;
+	flush();
 }
 
 void HostScan::onDeviceFound(const DeviceInfo &deviceInfo)
 {
-	mDetectors.clear(); // Found an inverter on this host, we're done.
-	emit deviceFound(deviceInfo);
+	int index = indexOf(static_cast<DetectorReply *>(sender()));
+	if (index < 0)
+		return;
+	mRuns[index].devices.append(deviceInfo);
+	// Found an inverter on this host, detectors with a lower precedence are no longer needed.
+	cancelFrom(index + 1);
+	flush();
+}
+
+void HostScan::onProbeFinished()
+{
+	TcpProbe *probe = static_cast<TcpProbe *>(sender());
+	probe->deleteLater();
+	if (!mConfirming) {
+		emit hostProbed(probe->responseTime(),
+						probe->responseTime() >= 0 && probe->timedOutCount() > 0);
+		if (probe->responseTime() < 0 && mConfirmNoResponse) {
+			// A host that does not respond is skipped by the scans for a while, so make sure
+			// it was not just a lost packet.
+			mConfirming = true;
+			startProbe(TcpProbe::MaxTimeout);
+			return;
+		}
+	}
+	mProbeResult = probe->responseTime() >= 0 ? Responded : NoResponse;
+	QList<AbstractDetector *> detectors;
+	foreach (AbstractDetector *d, mDetectors) {
+		if (d->tcpPort() == 0 || probe->openPorts().contains(d->tcpPort()))
+			detectors.append(d);
+	}
+	mDetectors = detectors;
+	scan();
+}
+
+void HostScan::startProbe(int timeout)
+{
+	TcpProbe *probe = new TcpProbe(mHostname, mProbePorts, this);
+	probe->setTimeout(timeout);
+	connect(probe, SIGNAL(finished()), this, SLOT(onProbeFinished()));
+	probe->start();
+}
+
+int HostScan::indexOf(DetectorReply *reply) const
+{
+	for (int i=0; i<mRuns.size(); ++i) {
+		if (mRuns[i].reply == reply)
+			return i;
+	}
+	return -1;
+}
+
+void HostScan::cancelFrom(int index)
+{
+	while (mRuns.size() > index) {
+		Run run = mRuns.takeLast();
+		if (run.finished)
+			continue; // Already scheduled for deletion
+		disconnect(run.reply, 0, this, 0);
+		connect(run.reply, SIGNAL(finished()), run.reply, SLOT(deleteLater()));
+		run.reply->cancel();
+	}
+}
+
+void HostScan::flush()
+{
+	for (int i=0; i<mRuns.size(); ++i) {
+		Run &run = mRuns[i];
+		while (run.reported < run.devices.size()) {
+			const DeviceInfo deviceInfo = run.devices[run.reported++];
+			mFoundDevice = true;
+			emit deviceFound(deviceInfo);
+		}
+		if (!run.finished)
+			return;
+	}
+	emit finished();
 }
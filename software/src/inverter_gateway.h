@@ -1,13 +1,19 @@
 #ifndef INVERTER_GATEWAY_H
 #define INVERTER_GATEWAY_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QHostAddress>
 #include <QPointer>
 #include <QStringList>
 #include "defines.h"
 #include "local_ip_address_generator.h"
+#include "scan_cache.h"
+#include "scan_concurrency.h"
 
 class AbstractDetector;
+class ArpWarmUp;
+class DetectorReply;
 class FroniusUdpDetector;
 class QTimer;
 class Settings;
@@ -38,6 +44,16 @@ public:
 
 	int scanProgress() const;
 
+	/*!
+	 * Number of hosts that may be scanned at the same time.
+	 */
+	int scanConcurrency() const;
+
+	/*!
+	 * Number of hosts scanned per second during the current (or last) scan.
+	 */
+	double scanRate() const;
+
 	void initializeSettings();
 
 	virtual void startDetection();
@@ -58,6 +74,8 @@ private slots:
 
 	void onDetectionDone();
 
+	void onHostProbed(qint64 rtt, bool lost);
+
 	void onPortNumberChanged();
 
 	void onIpAddressesChanged();
@@ -66,6 +84,8 @@ private slots:
 
 	void continueScan();
 
+	void onArpWarmUpFinished();
+
 private:
 	enum ScanType
 	{
@@ -79,39 +99,108 @@ private:
 
 	void scanHost(QString hostName);
 
+	void scanNextHosts();
+
 	void scan(enum ScanType scanType);
 
 	QPointer<Settings> mSettings;
 	QSet<QHostAddress> mDevicesFound;
+	QSet<QHostAddress> mPriorityAddresses;
 	QList<HostScan *> mActiveHosts;
 	LocalIpAddressGenerator mAddressGenerator;
+	ScanConcurrency mConcurrency;
+	ScanCache mCache;
+	QHash<QHostAddress, QString> mNeighbours; // Read per scan, for the scan cache
+	QElapsedTimer mScanClock;
+	int mHostsScanned;
 	QList<AbstractDetector *> mDetectors;
 	QTimer *mTimer;
 	FroniusUdpDetector *mUdpDetector;
+	ArpWarmUp *mArpWarmUp;
 	bool mAutoDetect;
 	bool mTriedFull;
 	enum ScanType mScanType;
 };
 
+/*!
+ * Runs the detectors on a single host. All detectors are started at the same time. If more than
+ * one of them finds a device, the detector added first to the gateway takes precedence: its
+ * results are reported, and the detectors added after it are cancelled. Results of a detector are
+ * held back until all detectors with a higher precedence have finished without finding anything.
+ *
+ * If `probe` is set, the host is checked first by a `TcpProbe`, and only the detectors with an
+ * open TCP port are run. A host that does not respond to the probe is probed once more, with the
+ * maximum timeout, before it is reported as not responding.
+ */
 class HostScan: public QObject
 {
     Q_OBJECT
 public:
-	HostScan(QList<AbstractDetector *> detectors, QString hostname, QObject *parent = 0);
+	enum ProbeResult {
+		NotProbed,
+		NoResponse,
+		Responded
+	};
+
+	HostScan(QList<AbstractDetector *> detectors, QString hostname, bool probe = false,
+			 QObject *parent = 0);
 	QString hostName() { return mHostname; }
 	void scan();
+	ProbeResult probeResult() const { return mProbeResult; }
+	bool hasFoundDevice() const { return mFoundDevice; }
+	/*!
+	 * If set, a host that does not respond to the probe is probed again with a longer timeout
+	 * before it is reported as `NoResponse`. Used for hosts that are known to be alive.
+	 */
+	void setConfirmNoResponse(bool confirm) { mConfirmNoResponse = confirm; }
 
 signals:
 	void deviceFound(const DeviceInfo &deviceInfo);
+	void hostProbed(qint64 rtt, bool lost);
 	void finished();
 
 private slots:
-	void continueScan();
+	void onDetectorFinished();
 	void onDeviceFound(const DeviceInfo &deviceInfo);
+	void onProbeFinished();
 
 private:
+	struct Run {
+		Run():
+			reply(0),
+			reported(0),
+			finished(false)
+		{}
+		DetectorReply *reply;
+		QList<DeviceInfo> devices;
+		int reported; // Number of devices passed on with the deviceFound signal
+		bool finished;
+	};
+
+	int indexOf(DetectorReply *reply) const;
+
+	/*!
+	 * Cancels all detectors with a precedence lower than `index`.
+	 */
+	void cancelFrom(int index);
+
+	void startProbe(int timeout);
+
+	/*!
+	 * Reports the devices that can no longer be overruled by a detector with a higher
+	 * precedence, and emits `finished` when all detectors are done.
+	 */
+	void flush();
+
 	QList<AbstractDetector *> mDetectors;
+	QList<Run> mRuns; // In order of precedence
 	QString mHostname;
+	bool mProbe;
+	QList<quint16> mProbePorts;
+	bool mConfirmNoResponse;
+	bool mConfirming; // Running the second probe
+	ProbeResult mProbeResult;
+	bool mFoundDevice;
 };
 
 #endif // INVERTER_GATEWAY_H
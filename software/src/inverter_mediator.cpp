@@ -1,6 +1,7 @@
 #include <QRegularExpression>
 #include "products.h"
 #include "defines.h"
+#include "device_info_store.h"
 #include "inverter.h"
 #include "fronius_inverter.h"
 #include "gateway_interface.h"
@@ -58,6 +59,14 @@ bool InverterMediator::processNewInverter(const DeviceInfo &deviceInfo)
 		delete mInverter;
 		mInverter = 0;
 	}
+	// The inverter may have been started with the information stored before a restart, which
+	// is outdated if the inverter has been reconfigured or updated in the meantime.
+	if (mInverter != 0 && mDeviceInfo.retrievalMode == deviceInfo.retrievalMode &&
+			!DeviceInfoStore::isSameLayout(mDeviceInfo, deviceInfo)) {
+		qInfo() << "Inverter layout has changed @" << mInverter->location();
+		delete mInverter;
+		mInverter = 0;
+	}
 	mDeviceInfo = deviceInfo;
 	if (mInverter != 0) {
 		if (mInverter->hostName() != deviceInfo.hostName ||
@@ -90,6 +99,7 @@ void InverterMediator::onSettingsInitialized()
 	if (!mInverterSettings->isActive()) {
 		delete mInverter;
 		mInverter = 0;
+		emit deactivated();
 		return;
 	}
 
@@ -120,6 +130,7 @@ void InverterMediator::onIsActivatedChanged()
 	if (mInverterSettings->isActive()) {
 		mGateway->startDetection();
 	} else {
+		emit deactivated();
 		if (mInverter == 0)
 			return;
 		qInfo() << "Inverter deactivated:" << mInverter->location();
@@ -247,8 +258,10 @@ Inverter *InverterMediator::createInverter()
 	if (deviceInstance < 0)
 		return 0;
 
+	// Work on a copy, the unique ID is also the key of the stored device information
+	QString id = mDeviceInfo.uniqueId;
 	QString path = QString("pub/com.victronenergy.pvinverter.pv_%1").arg(
-		mDeviceInfo.uniqueId.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_"));
+		id.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_"));
 	VeQItem *root = VeQItems::getRoot()->itemGetOrCreate(path, false);
 	Inverter *inverter;
 	if (mDeviceInfo.deviceType != 0) {
@@ -28,6 +28,25 @@ public:
 	 */
 	bool processNewInverter(const DeviceInfo &deviceInfo);
 
+	const DeviceInfo &deviceInfo() const
+	{
+		return mDeviceInfo;
+	}
+
+	/*!
+	 * Returns true if data is being retrieved from the inverter.
+	 */
+	bool isAcquiring() const
+	{
+		return mInverter != 0;
+	}
+
+signals:
+	/*!
+	 * Emitted when the inverter has been deactivated in the settings.
+	 */
+	void deactivated();
+
 private slots:
 	void onSettingsInitialized();
 
@@ -15,7 +15,11 @@ InverterSettings::InverterSettings(VeQItem *root, QObject *parent) :
 	mL3Energy(connectItem("L3Energy", 0.0, 0.0, 1e6, SIGNAL(l3EnergyChanged()), true)),
 	mSerialNumber(connectItem("SerialNumber", "", 0, false)),
 	mLimiterSupported(connectItem("LimiterSupported", 0, 0)),
-	mEnableLimiter(connectItem("EnableLimiter", 0, SIGNAL(enableLimiterChanged())))
+	mEnableLimiter(connectItem("EnableLimiter", 0, SIGNAL(enableLimiterChanged()))),
+	mModbusMaxInFlight(connectItem("ModbusMaxInFlight", 1, SIGNAL(modbusMaxInFlightChanged()))),
+	mFastMode(connectItem("FastMode", 0, 0)),
+	mPowerLimitDeadband(connectItem("PowerLimitDeadband", 0.0, 0.0, 100.0, 0, false)),
+	mPowerLimitMinInterval(connectItem("PowerLimitMinInterval", 0, 0))
 {
 }
 
@@ -140,3 +144,23 @@ bool InverterSettings::enableLimiter() const
 {
 	return mEnableLimiter->getValue().toBool();
 }
+
+int InverterSettings::modbusMaxInFlight() const
+{
+	return qMax(1, mModbusMaxInFlight->getValue().toInt());
+}
+
+bool InverterSettings::fastMode() const
+{
+	return mFastMode->getValue().toBool();
+}
+
+double InverterSettings::powerLimitDeadband() const
+{
+	return mPowerLimitDeadband->getValue().toDouble();
+}
+
+int InverterSettings::powerLimitMinInterval() const
+{
+	return mPowerLimitMinInterval->getValue().toInt();
+}
@@ -48,6 +48,29 @@ public:
 
 	bool enableLimiter() const;
 
+	/*!
+	 * Maximum number of modbus requests that may be sent to the inverter before a reply on the
+	 * first one has been received. Default is 1 (strictly serial communication).
+	 */
+	int modbusMaxInFlight() const;
+
+	/*!
+	 * If set, the inverter is polled at a high rate while its power is being limited. Only the
+	 * AC power is read in most of those polls.
+	 */
+	bool fastMode() const;
+
+	/*!
+	 * A requested power limit is not written to the inverter if it differs less than this
+	 * from the last written limit. In percent of the maximum power.
+	 */
+	double powerLimitDeadband() const;
+
+	/*!
+	 * Minimum time between two power limit writes, in milliseconds.
+	 */
+	int powerLimitMinInterval() const;
+
 signals:
 	void phaseChanged();
 
@@ -65,6 +88,8 @@ signals:
 
 	void enableLimiterChanged();
 
+	void modbusMaxInFlightChanged();
+
 private:
 	VeQItem *mPhase;
 	VeQItem *mPhaseCount;
@@ -77,6 +102,10 @@ private:
 	VeQItem *mSerialNumber;
 	VeQItem *mLimiterSupported;
 	VeQItem *mEnableLimiter;
+	VeQItem *mModbusMaxInFlight;
+	VeQItem *mFastMode;
+	VeQItem *mPowerLimitDeadband;
+	VeQItem *mPowerLimitMinInterval;
 };
 
 #endif // INVERTERSETTINGS_H
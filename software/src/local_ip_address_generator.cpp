@@ -1,5 +1,7 @@
 #include <QNetworkInterface>
 #include "local_ip_address_generator.h"
+#include "neighbour_table.h"
+#include "scan_cache.h"
 
 Subnet::Subnet(LocalIpAddressGenerator *generator, quint32 first, quint32 last, quint32 localhost):
 	mGenerator(generator),
@@ -20,11 +22,21 @@ QHostAddress Subnet::next()
 {
 	quint32 current = mCurrent;
 	++mCurrent;
+	skipExceptions();
+	return QHostAddress(current);
+}
+
+void Subnet::skipExceptions()
+{
 	while ((mCurrent <= mLast) && (
-		(mCurrent == mLocalHost) || mGenerator->exceptions().contains(QHostAddress(mCurrent)))) {
+		(mCurrent == mLocalHost) || mGenerator->isException(QHostAddress(mCurrent)))) {
 		++mCurrent;
 	}
-	return QHostAddress(current);
+}
+
+bool Subnet::contains(quint32 address) const
+{
+	return address >= mFirst && address <= mLast && address != mLocalHost;
 }
 
 int Subnet::position() const
@@ -34,7 +46,9 @@ int Subnet::position() const
 
 LocalIpAddressGenerator::LocalIpAddressGenerator():
 	mPriorityOnly(false),
+	mCache(0),
 	mPriorityIndex(0),
+	mNeighbourIndex(0),
 	mSubnetIndex(0)
 {
 	reset();
@@ -49,6 +63,10 @@ QHostAddress LocalIpAddressGenerator::next()
 		return a;
 	}
 
+	// Then the hosts known to be alive
+	if (mNeighbourIndex < mNeighbours.size())
+		return mNeighbours[mNeighbourIndex++];
+
 	// Then traverse the subnets
 	while (mSubnetIndex < mSubnets.size()) {
 		if (mSubnets[mSubnetIndex].hasNext())
@@ -65,6 +83,8 @@ bool LocalIpAddressGenerator::hasNext() const
 	int idx = mSubnetIndex;
 	if (mPriorityIndex < mPriorityAddresses.size())
 		return true;
+	if (mNeighbourIndex < mNeighbours.size())
+		return true;
 	while (idx < mSubnets.size()) {
 		if (mSubnets[idx].hasNext())
 			return true;
@@ -74,10 +94,18 @@ bool LocalIpAddressGenerator::hasNext() const
 }
 
 void LocalIpAddressGenerator::reset()
+{
+	reset(NeighbourTable::read());
+}
+
+void LocalIpAddressGenerator::reset(const QHash<QHostAddress, QString> &neighbours)
 {
 	mPriorityIndex = 0;
+	mNeighbourIndex = 0;
 	mSubnetIndex = 0;
 	mSubnets.clear();
+	mNeighbours.clear();
+	mExceptions = QSet<QHostAddress>(mPriorityAddresses.begin(), mPriorityAddresses.end());
 	if (mPriorityOnly)
 		return;
 	foreach (QNetworkInterface iface, QNetworkInterface::allInterfaces()) {
@@ -115,14 +143,80 @@ void LocalIpAddressGenerator::reset()
 			}
 		}
 	}
+	updateNeighbours(neighbours);
+}
+
+void LocalIpAddressGenerator::addNeighbours(const QHash<QHostAddress, QString> &neighbours)
+{
+	if (mPriorityOnly)
+		return;
+	QHash<QHostAddress, QString> ahead;
+	for (QHash<QHostAddress, QString>::const_iterator it = neighbours.begin();
+		 it != neighbours.end(); ++it) {
+		quint32 a = it.key().toIPv4Address();
+		foreach (const Subnet &s, mSubnets) {
+			if (s.isAhead(a)) {
+				ahead.insert(it.key(), it.value());
+				break;
+			}
+		}
+	}
+	updateNeighbours(ahead);
+}
+
+void LocalIpAddressGenerator::updateNeighbours(const QHash<QHostAddress, QString> &neighbours)
+{
+	int added = 0;
+	int skipped = 0;
+	for (QHash<QHostAddress, QString>::const_iterator it = neighbours.begin();
+		 it != neighbours.end(); ++it) {
+		const QHostAddress &address = it.key();
+		if (mExceptions.contains(address) || !inSubnets(address))
+			continue;
+		mExceptions.insert(address);
+		// The MAC address is checked, because the address may have been handed out to another
+		// host since the negative result was stored.
+		if (mCache != 0 && mCache->isNegative(address, it.value())) {
+			++skipped;
+		} else {
+			mNeighbours.append(address);
+			++added;
+		}
+	}
+	if (mCache != 0) {
+		foreach (const QHostAddress &address, mCache->addresses()) {
+			if (!mExceptions.contains(address) && inSubnets(address) &&
+				mCache->isNegative(address)) {
+				mExceptions.insert(address);
+				++skipped;
+			}
+		}
+	}
+	if (added > 0)
+		qInfo() << "Scanning" << added << "hosts from the neighbour table first";
+	if (skipped > 0)
+		qInfo() << "Skipping" << skipped << "hosts without an inverter found by earlier scans";
+	// The subnets have been positioned on their first address before the neighbours were known
+	for (int i=0; i<mSubnets.size(); ++i)
+		mSubnets[i].skipExceptions();
+}
+
+bool LocalIpAddressGenerator::inSubnets(const QHostAddress &address) const
+{
+	quint32 a = address.toIPv4Address();
+	foreach (const Subnet &s, mSubnets) {
+		if (s.contains(a))
+			return true;
+	}
+	return false;
 }
 
 int LocalIpAddressGenerator::progress(int activeCount) const
 {
 	int total = 0;
 	int done = 0;
-	total += mPriorityAddresses.size();
-	done += mPriorityIndex;
+	total += mPriorityAddresses.size() + mNeighbours.size();
+	done += mPriorityIndex + mNeighbourIndex;
 	if (!mPriorityOnly) {
 		/*!
 		 * @todo EV correct for the fact that we skip localhost. This will
@@ -151,9 +245,9 @@ void LocalIpAddressGenerator::setPriorityOnly(bool p)
 
 const QSet<QHostAddress> LocalIpAddressGenerator::exceptions() const
 {
-	// We exclude scanning of the priorityAddresses when doing a sweep
+	// We exclude scanning of the priorityAddresses and neighbours when doing a sweep
 	// since they were already scanned.
-	return QSet<QHostAddress>(mPriorityAddresses.begin(), mPriorityAddresses.end());
+	return mExceptions;
 }
 
 void LocalIpAddressGenerator::setPriorityAddresses(
@@ -163,4 +257,11 @@ void LocalIpAddressGenerator::setPriorityAddresses(
 			mPriorityIndex >= mPriorityAddresses.size();
 	mPriorityAddresses = addresses;
 	mPriorityIndex = atEnd ? mPriorityAddresses.size() : 0;
+	foreach (const QHostAddress &a, mPriorityAddresses)
+		mExceptions.insert(a);
+}
+
+void LocalIpAddressGenerator::setScanCache(const ScanCache *cache)
+{
+	mCache = cache;
 }
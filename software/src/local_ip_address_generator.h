@@ -1,11 +1,13 @@
 #ifndef LOCAL_IP_ADDRESS_GENERATOR_H
 #define LOCAL_IP_ADDRESS_GENERATOR_H
 
+#include <QHash>
 #include <QHostAddress>
 #include <QList>
 #include <QSet>
 
 class LocalIpAddressGenerator;
+class ScanCache;
 
 class Subnet
 {
@@ -15,6 +17,16 @@ public:
 	QHostAddress next();
 	int size() const { return mLast - mFirst + 1; }
 	int position() const;
+	bool contains(quint32 address) const;
+	/*!
+	 * Returns true if `address` is in the subnet, and has not been returned by `next` yet.
+	 */
+	bool isAhead(quint32 address) const { return contains(address) && address >= mCurrent; }
+	/*!
+	 * Moves to the next address that should be scanned, skipping localhost and the exceptions
+	 * of the generator.
+	 */
+	void skipExceptions();
 private:
 	LocalIpAddressGenerator *mGenerator;
 	quint32 mFirst;
@@ -26,6 +38,10 @@ private:
 /*!
  * @brief An iterator like object, which enumerates all IP addresses within the
  * local subnet (except the IP address of the localhost).
+ *
+ * The priority addresses are returned first. If the generator is not limited to the priority
+ * addresses, they are followed by the hosts in the neighbour (ARP) table of the kernel, which
+ * are known to be alive, and finally the remaining addresses of the subnets.
  * Example:
  * @code
  * LocalIpAddressGenerator g;
@@ -58,6 +74,18 @@ public:
 	 */
 	void reset();
 
+	/*!
+	 * Same as `reset`, using `neighbours` (as returned by `NeighbourTable::read`) instead of
+	 * reading the neighbour table again.
+	 */
+	void reset(const QHash<QHostAddress, QString> &neighbours);
+
+	/*!
+	 * Moves the hosts from `neighbours` that have not been returned yet in front of the
+	 * remaining subnet addresses. Used when the neighbour table has been filled after `reset`.
+	 */
+	void addNeighbours(const QHash<QHostAddress, QString> &neighbours);
+
 	/*!
 	 * \brief Returns the percentage of work done.
 	 * \param Number of IP addresses currently under investigation (will be deducted from the
@@ -75,13 +103,36 @@ public:
 
 	void setPriorityAddresses(const QList<QHostAddress> &addresses);
 
+	/*!
+	 * If set, hosts with a negative result in `cache` are skipped (until the next `reset`). The
+	 * priority addresses are always returned.
+	 */
+	void setScanCache(const ScanCache *cache);
+
 	const QSet<QHostAddress> exceptions() const;
 
+	/*!
+	 * Returns true if `address` is not returned by the subnet sweep, because it is returned
+	 * before as a priority address or neighbour, or skipped because of the scan cache.
+	 */
+	bool isException(const QHostAddress &address) const
+	{
+		return mExceptions.contains(address);
+	}
+
 private:
+	void updateNeighbours(const QHash<QHostAddress, QString> &neighbours);
+
+	bool inSubnets(const QHostAddress &address) const;
+
 	bool mPriorityOnly;
 	QList<Subnet> mSubnets;
 	QList<QHostAddress> mPriorityAddresses;
+	QList<QHostAddress> mNeighbours;
+	QSet<QHostAddress> mExceptions;
+	const ScanCache *mCache;
 	int mPriorityIndex;
+	int mNeighbourIndex;
 	int mSubnetIndex;
 };
 
@@ -7,6 +7,8 @@
 #include <veutil/qt/ve_qitems_dbus.hpp>
 #include <veutil/qt/ve_qitem_exported_dbus_services.hpp>
 #include "dbus_fronius.h"
+#include "modbus_io_thread.h"
+#include "modbus_tcp_transport.h"
 #include "ve_service.h"
 
 void initDBus()
@@ -42,6 +44,8 @@ int main(int argc, char *argv[])
 
 	QString dbusAddress = "system";
 	bool debug = false;
+	bool ioThread = false;
+	bool nativeSockets = false;
 
 	while (!args.isEmpty()) {
 		QString arg = args.takeFirst();
@@ -56,6 +60,10 @@ int main(int argc, char *argv[])
 			qInfo() << "\t Enable debug logging";
 			qInfo() << "\t-b, --dbus";
 			qInfo() << "\t dbus address or 'session' or 'system'";
+			qInfo() << "\t-t, --io-thread";
+			qInfo() << "\t Handle modbus TCP traffic in a separate thread";
+			qInfo() << "\t-n, --native-sockets";
+			qInfo() << "\t Use native sockets and epoll for modbus TCP instead of QTcpSocket";
 			return 0;
 		}
 		if (arg == "-V" || arg == "--version") {
@@ -66,12 +74,21 @@ int main(int argc, char *argv[])
 		} else if (arg == "-b" || arg == "--dbus") {
 			if (!args.isEmpty())
 				dbusAddress = args.takeFirst();
+		} else if (arg == "-t" || arg == "--io-thread") {
+			ioThread = true;
+		} else if (arg == "-n" || arg == "--native-sockets") {
+			nativeSockets = true;
 		}
 	}
 
 	QLoggingCategory::defaultCategory()->setEnabled(QtDebugMsg, debug);
 	qSetMessagePattern("%{type} %{message}");
 
+	if (nativeSockets)
+		ModbusTcpTransport::setDefaultBackend(ModbusTcpTransport::NativeBackend);
+	if (ioThread)
+		ModbusIoThread::start();
+
 	VeQItemDbusProducer producer(VeQItems::getRoot(), "sub", true, false);
 	producer.setAutoCreateItems(false);
 	producer.open(dbusAddress);
@@ -5,3 +5,37 @@ ModbusClient::ModbusClient(QObject *parent):
 {
 
 }
+
+void ModbusClient::readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+										const ModbusCallback &callback)
+{
+	connectCallback(readHoldingRegisters(unitId, startReg, count), callback);
+}
+
+void ModbusClient::readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+									  const ModbusCallback &callback)
+{
+	connectCallback(readInputRegisters(unitId, startReg, count), callback);
+}
+
+void ModbusClient::writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+											  const ModbusCallback &callback)
+{
+	connectCallback(writeSingleHoldingRegister(unitId, reg, value), callback);
+}
+
+void ModbusClient::writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+												 const QVector<quint16> &values,
+												 const ModbusCallback &callback)
+{
+	connectCallback(writeMultipleHoldingRegisters(unitId, startReg, values), callback);
+}
+
+void ModbusClient::connectCallback(ModbusReply *reply, const ModbusCallback &callback)
+{
+	connect(reply, &ModbusReply::finished, reply, [reply, callback]() {
+		reply->deleteLater();
+		if (callback)
+			callback(reply->error(), reply->registers());
+	});
+}
@@ -1,9 +1,16 @@
 #ifndef MODBUS_CLIENT_H
 #define MODBUS_CLIENT_H
 
+#include <functional>
 #include <QObject>
+#include "modbus_reply.h"
 
-class ModbusReply;
+/*!
+ * Completion handler for the callback variants of the modbus requests. `registers` is only valid
+ * during the call.
+ */
+typedef std::function<void (ModbusReply::ExceptionCode error, const RegisterSpan &registers)>
+	ModbusCallback;
 
 class ModbusClient : public QObject
 {
@@ -20,9 +27,33 @@ public:
 	virtual ModbusReply *writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
 													   const QVector<quint16> &values) = 0;
 
+	/*!
+	 * Callback variants of the requests above. They do not create a `ModbusReply`, which saves
+	 * a QObject allocation and a signal/slot connection per request. The callback is called
+	 * exactly once, unless the client is destroyed before the request completes. An empty
+	 * callback may be passed if the result is not needed.
+	 *
+	 * The default implementation is a wrapper around the `ModbusReply` API.
+	 */
+	virtual void readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+									  const ModbusCallback &callback);
+
+	virtual void readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+									const ModbusCallback &callback);
+
+	virtual void writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+											const ModbusCallback &callback);
+
+	virtual void writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+											   const QVector<quint16> &values,
+											   const ModbusCallback &callback);
+
 	virtual int timeout() const = 0;
 
 	virtual void setTimeout(int t) = 0;
+
+private:
+	static void connectCallback(ModbusReply *reply, const ModbusCallback &callback);
 };
 
 #endif // MODBUS_CLIENT_H
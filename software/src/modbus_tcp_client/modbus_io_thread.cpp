@@ -0,0 +1,203 @@
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include "modbus_io_thread.h"
+#include "modbus_tcp_channel.h"
+#include "modbus_tcp_client.h"
+
+// Delay before retrying to pass events that did not fit in the queue.
+static const int OverflowRetryInterval = 10; // ms
+
+ModbusIoThread *ModbusIoThread::mInstance = 0;
+
+ModbusIoThread::ModbusIoThread(QObject *parent):
+	QObject(parent),
+	mThread(new QThread(this)),
+	mWorker(new ModbusIoWorker(this))
+{
+	mThread->setObjectName("modbus-io");
+	mWorker->moveToThread(mThread);
+	connect(mThread, SIGNAL(finished()), mWorker, SLOT(deleteLater()));
+	connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(onAboutToQuit()));
+	mThread->start();
+}
+
+ModbusIoThread::~ModbusIoThread()
+{
+	// In case the application did not quit through its event loop
+	onAboutToQuit();
+	mInstance = 0;
+}
+
+void ModbusIoThread::start()
+{
+	if (mInstance != 0)
+		return;
+	qInfo() << "Starting modbus I/O thread";
+	mInstance = new ModbusIoThread(QCoreApplication::instance());
+}
+
+void ModbusIoThread::stop()
+{
+	if (mInstance == 0)
+		return;
+	qInfo() << "Stopping modbus I/O thread";
+	// Drop the lingering connections, which refer to clients in the I/O thread
+	QHash<QString, ModbusTcpChannel::Connection>::iterator it =
+		ModbusTcpChannel::mConnections.begin();
+	while (it != ModbusTcpChannel::mConnections.end()) {
+		if (it->client == 0) {
+			Q_ASSERT(it->refCount == 0);
+			it = ModbusTcpChannel::mConnections.erase(it);
+		} else {
+			++it;
+		}
+	}
+	delete mInstance;
+}
+
+ModbusIoThread *ModbusIoThread::instance()
+{
+	return mInstance;
+}
+
+bool ModbusIoThread::post(const Command &command)
+{
+	if (!mCommands.push(command))
+		return false;
+	if (mCommandsPosted.testAndSetOrdered(0, 1))
+		QMetaObject::invokeMethod(mWorker, "processCommands", Qt::QueuedConnection);
+	return true;
+}
+
+bool ModbusIoThread::pushEvent(const Event &event)
+{
+	if (!mEvents.push(event))
+		return false;
+	if (mEventsPosted.testAndSetOrdered(0, 1))
+		QMetaObject::invokeMethod(this, "processEvents", Qt::QueuedConnection);
+	return true;
+}
+
+void ModbusIoThread::onAboutToQuit()
+{
+	mThread->quit();
+	mThread->wait();
+}
+
+void ModbusIoThread::processEvents()
+{
+	// Reset the flag before draining the queue, so an event pushed while we are busy triggers
+	// another call.
+	mEventsPosted.storeRelease(0);
+	Event event;
+	while (mEvents.pop(event))
+		ModbusTcpChannel::handleEvent(event);
+}
+
+ModbusIoWorker::ModbusIoWorker(ModbusIoThread *ioThread):
+	mIoThread(ioThread)
+{
+}
+
+void ModbusIoWorker::processCommands()
+{
+	mIoThread->mCommandsPosted.storeRelease(0);
+	ModbusIoThread::Command command;
+	while (mIoThread->mCommands.pop(command))
+		execute(command);
+}
+
+void ModbusIoWorker::execute(const ModbusIoThread::Command &command)
+{
+	ModbusTcpClient *client = mClients.value(command.connection);
+	switch (command.type) {
+	case ModbusIoThread::Command::Connect:
+		if (client == 0) {
+			int connection = command.connection;
+			client = new ModbusTcpClient(this);
+			connect(client, &ModbusTcpClient::connected, this, [this, connection]() {
+				ModbusIoThread::Event event;
+				event.type = ModbusIoThread::Event::Connected;
+				event.connection = connection;
+				pushEvent(event);
+			});
+			connect(client, &ModbusTcpClient::disconnected, this, [this, connection]() {
+				ModbusIoThread::Event event;
+				event.type = ModbusIoThread::Event::Disconnected;
+				event.connection = connection;
+				pushEvent(event);
+			});
+			mClients.insert(connection, client);
+		}
+		client->setTimeout(command.timeout);
+		client->connectToServer(command.hostName, command.tcpPort);
+		break;
+	case ModbusIoThread::Command::Send:
+	{
+		int connection = command.connection;
+		const ModbusTcpChannel *owner = command.owner;
+		quint32 requestId = command.requestId;
+		if (client == 0) {
+			pushResult(connection, owner, requestId, ModbusReply::TcpError, RegisterSpan());
+			break;
+		}
+		ModbusTcpClient::Transaction *t = client->createRequest(
+			command.function, command.unitId, command.startReg, command.count, command.values);
+		t->owner = owner;
+		t->timeout = command.timeout;
+		client->send(t, [this, connection, owner, requestId](ModbusReply::ExceptionCode error,
+															 const RegisterSpan &registers) {
+			pushResult(connection, owner, requestId, error, registers);
+		});
+		break;
+	}
+	case ModbusIoThread::Command::Cancel:
+		if (client != 0)
+			client->cancelTransactions(command.owner);
+		break;
+	case ModbusIoThread::Command::SetMaxInFlight:
+		if (client != 0)
+			client->setMaxInFlight(command.count);
+		break;
+	case ModbusIoThread::Command::Release:
+		delete mClients.take(command.connection);
+		break;
+	}
+}
+
+void ModbusIoWorker::pushResult(int connection, const ModbusTcpChannel *owner,
+								quint32 requestId, ModbusReply::ExceptionCode error,
+								const RegisterSpan &registers)
+{
+	ModbusIoThread::Event event;
+	event.connection = connection;
+	event.owner = owner;
+	event.requestId = requestId;
+	event.error = error;
+	event.registerCount = qMin(registers.size(), static_cast<int>(ModbusReply::MaxRegisters));
+	for (int i=0; i<event.registerCount; ++i)
+		event.registers[i] = registers[i];
+	pushEvent(event);
+}
+
+void ModbusIoWorker::pushEvent(const ModbusIoThread::Event &event)
+{
+	// Keep the order of the events: nothing goes into the queue while older events are waiting.
+	if (mOverflow.isEmpty() && mIoThread->pushEvent(event))
+		return;
+	if (mOverflow.isEmpty())
+		QTimer::singleShot(OverflowRetryInterval, this, SLOT(flushEvents()));
+	mOverflow.append(event);
+}
+
+void ModbusIoWorker::flushEvents()
+{
+	while (!mOverflow.isEmpty()) {
+		if (!mIoThread->pushEvent(mOverflow.first())) {
+			QTimer::singleShot(OverflowRetryInterval, this, SLOT(flushEvents()));
+			return;
+		}
+		mOverflow.removeFirst();
+	}
+}
@@ -0,0 +1,187 @@
+#ifndef MODBUS_IO_THREAD_H
+#define MODBUS_IO_THREAD_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVector>
+#include "modbus_reply.h"
+#include "spsc_queue.h"
+
+class ModbusIoWorker;
+class ModbusTcpChannel;
+class ModbusTcpClient;
+class QThread;
+
+/*!
+ * Runs the socket I/O of the modbus TCP connections in a separate thread.
+ *
+ * Once the thread has been started, `ModbusTcpChannel` no longer calls its `ModbusTcpClient`
+ * directly. Instead, the clients live in the I/O thread and the channels post commands (connect,
+ * send a request, cancel) to it. Replies and connection state changes come back as events, which
+ * are handled in the main thread. Both directions use a lock-free single producer, single
+ * consumer queue, so neither thread ever waits for the other.
+ *
+ * Only the socket I/O and the transaction timeouts run in the I/O thread. The updaters, and the
+ * `PollScheduler` that starts their poll cycles, still run in the main thread. Each request of a
+ * poll cycle is sent when the main thread has handled the reply on the previous one, so a slow
+ * D-Bus call (like a localsettings write) in the main thread still delays the polls.
+ *
+ * The registers of a reply are stored in the event itself, so passing a result to the main
+ * thread does not allocate memory.
+ */
+class ModbusIoThread : public QObject
+{
+	Q_OBJECT
+public:
+	struct Command
+	{
+		enum Type {
+			Connect,
+			Send,
+			Cancel, // Cancels all requests sent by `owner`
+			SetMaxInFlight,
+			Release // Closes the connection
+		};
+
+		Command():
+			type(Connect),
+			connection(0),
+			owner(0),
+			requestId(0),
+			function(0),
+			unitId(0),
+			startReg(0),
+			count(0),
+			timeout(0),
+			tcpPort(0)
+		{
+		}
+
+		Type type;
+		int connection;
+		const ModbusTcpChannel *owner; // Only used as a key, never dereferenced in the I/O thread
+		quint32 requestId;
+		quint8 function;
+		quint8 unitId;
+		quint16 startReg;
+		quint16 count; // Number of registers to read, or the in-flight window
+		int timeout;
+		QString hostName;
+		quint16 tcpPort;
+		QVector<quint16> values;
+	};
+
+	struct Event
+	{
+		enum Type {
+			Connected,
+			Disconnected,
+			Result
+		};
+
+		Event():
+			type(Result),
+			connection(0),
+			owner(0),
+			requestId(0),
+			error(ModbusReply::NoException),
+			registerCount(0)
+		{
+		}
+
+		RegisterSpan registerSpan() const
+		{
+			return RegisterSpan(registers, registerCount);
+		}
+
+		Type type;
+		int connection;
+		const ModbusTcpChannel *owner;
+		quint32 requestId;
+		ModbusReply::ExceptionCode error;
+		int registerCount;
+		quint16 registers[ModbusReply::MaxRegisters];
+	};
+
+	// Must be a power of 2
+	static const int QueueCapacity = 1024;
+
+	/*!
+	 * Starts the I/O thread. Connections opened after this call use it.
+	 */
+	static void start();
+
+	/*!
+	 * Stops the I/O thread. Connections opened after this call use a client in the main thread.
+	 * Must only be called when no channels are open.
+	 */
+	static void stop();
+
+	/*!
+	 * Returns the I/O thread, or 0 if it has not been started.
+	 */
+	static ModbusIoThread *instance();
+
+	/*!
+	 * Passes a command to the I/O thread. Must be called from the main thread. Returns false if
+	 * the command queue is full.
+	 */
+	bool post(const Command &command);
+
+private slots:
+	void onAboutToQuit();
+
+	void processEvents();
+
+private:
+	friend class ModbusIoWorker;
+
+	explicit ModbusIoThread(QObject *parent = 0);
+
+	~ModbusIoThread() override;
+
+	/*!
+	 * Called by the worker in the I/O thread.
+	 */
+	bool pushEvent(const Event &event);
+
+	QThread *mThread;
+	ModbusIoWorker *mWorker;
+	SpscQueue<Command, QueueCapacity> mCommands;
+	SpscQueue<Event, QueueCapacity> mEvents;
+	QAtomicInt mCommandsPosted; // Set if processCommands has been invoked, but not yet started
+	QAtomicInt mEventsPosted;
+	static ModbusIoThread *mInstance;
+};
+
+/*!
+ * Owns the modbus clients in the I/O thread and executes the commands posted to it.
+ */
+class ModbusIoWorker : public QObject
+{
+	Q_OBJECT
+public:
+	explicit ModbusIoWorker(ModbusIoThread *ioThread);
+
+public slots:
+	void processCommands();
+
+private slots:
+	void flushEvents();
+
+private:
+	void execute(const ModbusIoThread::Command &command);
+
+	void pushResult(int connection, const ModbusTcpChannel *owner, quint32 requestId,
+					ModbusReply::ExceptionCode error, const RegisterSpan &registers);
+
+	void pushEvent(const ModbusIoThread::Event &event);
+
+	ModbusIoThread *mIoThread;
+	QHash<int, ModbusTcpClient *> mClients;
+	QList<ModbusIoThread::Event> mOverflow; // Events that did not fit in the queue
+};
+
+#endif // MODBUS_IO_THREAD_H
@@ -3,6 +3,7 @@
 
 ModbusReply::ModbusReply(QObject *parent) :
 	QObject(parent),
+	mRegisterCount(0),
 	mError(NoException)
 {
 }
@@ -16,29 +17,39 @@ QString ModbusReply::toString() const
 		QMetaEnum metaEnum = mo.enumerator(index);
 		s += QString("Error: %2\t").arg(metaEnum.valueToKey(mError));
 	}
-	if (mRegisters.isEmpty())
+	if (mRegisterCount == 0)
 		return s;
 	s += "Registers: [";
-	int i = 0;
-	foreach (quint16 v, mRegisters) {
+	for (int i=0; i<mRegisterCount; ++i) {
 		s += QString::number(i);
 		s += ':';
 		s += "0x";
-		s += QString::number(v, 16).toUpper();
+		s += QString::number(mRegisters[i], 16).toUpper();
 		s += ", ";
-		++i;
 	}
 	s.remove(s.size() - 2, 2);
 	s += ']';
 	return s;
 }
 
-void ModbusReply::setResult(const QVector<quint16> &registers)
+void ModbusReply::setResult(const RegisterSpan &registers)
 {
 	if (isFinished())
 		return;
-	Q_ASSERT(mRegisters.isEmpty());
-	mRegisters = registers;
+	Q_ASSERT(registers.size() <= MaxRegisters);
+	int count = qMin(registers.size(), static_cast<int>(MaxRegisters));
+	for (int i=0; i<count; ++i)
+		mRegisters[i] = registers[i];
+	setRegisterCount(count);
+}
+
+void ModbusReply::setRegisterCount(int count)
+{
+	if (isFinished())
+		return;
+	Q_ASSERT(mRegisterCount == 0);
+	Q_ASSERT(count >= 0 && count <= MaxRegisters);
+	mRegisterCount = count;
 	mError = NoException;
 	onFinished();
 	Q_ASSERT(isFinished());
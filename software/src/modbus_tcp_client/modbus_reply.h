@@ -5,6 +5,7 @@
 #include <QVector>
 #include <QDebug>
 #include <QTextStream>
+#include "register_span.h"
 
 class ModbusReply : public QObject
 {
@@ -31,9 +32,16 @@ public:
 
 	Q_ENUMS(ExceptionCode)
 
-	QVector<quint16> registers() const
+	// Maximum number of registers in a single modbus read
+	static const int MaxRegisters = 125;
+
+	/*!
+	 * Returns the registers received. The result refers to storage inside the reply, so it
+	 * must not be used after the reply has been deleted.
+	 */
+	RegisterSpan registers() const
 	{
-		return mRegisters;
+		return RegisterSpan(mRegisters, mRegisterCount);
 	}
 
 	ExceptionCode error() const
@@ -53,12 +61,27 @@ protected:
 
 	virtual void onFinished() = 0;
 
-	void setResult(const QVector<quint16> &registers);
+	void setResult(const RegisterSpan &registers);
 
 	void setResult(ExceptionCode error);
 
+	/*!
+	 * Storage for the result registers, to be filled by the client before calling
+	 * `setRegisterCount`. Has room for `MaxRegisters` values.
+	 */
+	quint16 *registerBuffer()
+	{
+		return mRegisters;
+	}
+
+	/*!
+	 * Finishes the reply with the first `count` registers from `registerBuffer`.
+	 */
+	void setRegisterCount(int count);
+
 private:
-	QVector<quint16> mRegisters;
+	quint16 mRegisters[MaxRegisters];
+	int mRegisterCount;
 	ExceptionCode mError;
 };
 
@@ -44,6 +44,11 @@ public:
 	virtual ModbusReply *writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
 													   const QVector<quint16> &values);
 
+	using ModbusClient::readHoldingRegisters;
+	using ModbusClient::readInputRegisters;
+	using ModbusClient::writeSingleHoldingRegister;
+	using ModbusClient::writeMultipleHoldingRegisters;
+
 	virtual int timeout() const;
 
 	virtual void setTimeout(int t);
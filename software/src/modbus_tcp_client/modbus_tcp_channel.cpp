@@ -0,0 +1,384 @@
+#include <QTimer>
+#include "modbus_tcp_channel.h"
+
+QHash<QString, ModbusTcpChannel::Connection> ModbusTcpChannel::mConnections;
+int ModbusTcpChannel::mLastConnectionId = 0;
+quint32 ModbusTcpChannel::mLastRequestId = 0;
+
+ModbusTcpChannel::ModbusTcpChannel(const QString &hostName, quint16 tcpPort, const QString &key,
+								   QObject *parent):
+	ModbusClient(parent),
+	mHostName(hostName),
+	mTcpPort(tcpPort),
+	mKey(key),
+	mClient(connection().client),
+	mTimeout(1000)
+{
+	if (mClient == 0) {
+		connection().channels.append(this);
+		return;
+	}
+	mTimeout = mClient->timeout();
+	connect(mClient, SIGNAL(connected()), this, SIGNAL(connected()));
+	connect(mClient, SIGNAL(disconnected()), this, SIGNAL(disconnected()));
+}
+
+ModbusTcpChannel *ModbusTcpChannel::open(const QString &hostName, quint16 tcpPort,
+										 QObject *parent)
+{
+	QString k = key(hostName, tcpPort);
+	Connection &c = mConnections[k];
+	if (c.id == 0) {
+		c.id = ++mLastConnectionId;
+		if (ModbusIoThread::instance() == 0)
+			c.client = new ModbusTcpClient();
+	}
+	++c.refCount;
+	return new ModbusTcpChannel(hostName, tcpPort, k, parent);
+}
+
+ModbusTcpChannel::~ModbusTcpChannel()
+{
+	if (mClient == 0) {
+		Connection &c = connection();
+		c.channels.removeOne(this);
+		ModbusIoThread::Command command;
+		command.type = ModbusIoThread::Command::Cancel;
+		command.connection = c.id;
+		command.owner = this;
+		ModbusIoThread::instance()->post(command);
+		// Replies are children of the channel and will be deleted after this destructor.
+		foreach (const PendingRequest &request, mRequests) {
+			if (request.reply != 0)
+				request.reply->detach();
+		}
+	} else {
+		disconnect(mClient, 0, this, 0);
+		mClient->cancelTransactions(this);
+	}
+	release(mKey);
+}
+
+ModbusTcpChannel::Connection &ModbusTcpChannel::connection() const
+{
+	QHash<QString, Connection>::iterator it = mConnections.find(mKey);
+	Q_ASSERT(it != mConnections.end());
+	return *it;
+}
+
+QString ModbusTcpChannel::key(const QString &hostName, quint16 tcpPort)
+{
+	return QString("%1:%2").arg(hostName).arg(tcpPort);
+}
+
+void ModbusTcpChannel::release(const QString &key)
+{
+	QHash<QString, Connection>::iterator it = mConnections.find(key);
+	Q_ASSERT(it != mConnections.end() && it->refCount > 0);
+	if (--it->refCount > 0)
+		return;
+	quint32 generation = ++it->generation;
+	QObject *context = it->client;
+	if (context == 0)
+		context = ModbusIoThread::instance();
+	QTimer::singleShot(LingerTime, context, [key, generation]() {
+		QHash<QString, Connection>::iterator it = mConnections.find(key);
+		if (it == mConnections.end() || it->refCount > 0 || it->generation != generation)
+			return;
+		if (it->client == 0) {
+			ModbusIoThread::Command command;
+			command.type = ModbusIoThread::Command::Release;
+			command.connection = it->id;
+			ModbusIoThread::instance()->post(command);
+		} else {
+			it->client->deleteLater();
+		}
+		mConnections.erase(it);
+	});
+}
+
+void ModbusTcpChannel::connectToServer()
+{
+	Connection &c = connection();
+	QAbstractSocket::SocketState state = mClient == 0 ? c.state : mClient->state();
+	switch (state) {
+	case QAbstractSocket::ConnectedState:
+		QMetaObject::invokeMethod(this, "connected", Qt::QueuedConnection);
+		break;
+	case QAbstractSocket::UnconnectedState:
+		if (mClient == 0) {
+			ModbusIoThread::Command command;
+			command.type = ModbusIoThread::Command::Connect;
+			command.connection = c.id;
+			command.hostName = mHostName;
+			command.tcpPort = mTcpPort;
+			command.timeout = mTimeout;
+			if (ModbusIoThread::instance()->post(command)) {
+				c.state = QAbstractSocket::ConnectingState;
+			} else {
+				QMetaObject::invokeMethod(this, "disconnected", Qt::QueuedConnection);
+			}
+			break;
+		}
+		// The connection timeout is a property of the client
+		mClient->setTimeout(mTimeout);
+		mClient->connectToServer(mHostName, mTcpPort);
+		break;
+	default:
+		// Connection in progress, we will receive the connected or disconnected signal.
+		break;
+	}
+}
+
+bool ModbusTcpChannel::isConnected() const
+{
+	if (mClient == 0)
+		return connection().state == QAbstractSocket::ConnectedState;
+	return mClient->isConnected();
+}
+
+QString ModbusTcpChannel::hostName() const
+{
+	return mHostName;
+}
+
+quint16 ModbusTcpChannel::portName() const
+{
+	return mTcpPort;
+}
+
+ModbusReply *ModbusTcpChannel::readHoldingRegisters(quint8 unitId, quint16 startReg,
+													quint16 count)
+{
+	return sendWithReply(ModbusTcpClient::ReadHoldingRegisters, unitId, startReg, count,
+						 QVector<quint16>());
+}
+
+ModbusReply *ModbusTcpChannel::readInputRegisters(quint8 unitId, quint16 startReg,
+												  quint16 count)
+{
+	return sendWithReply(ModbusTcpClient::ReadInputRegisters, unitId, startReg, count,
+						 QVector<quint16>());
+}
+
+ModbusReply *ModbusTcpChannel::writeSingleHoldingRegister(quint8 unitId, quint16 reg,
+														  quint16 value)
+{
+	return sendWithReply(ModbusTcpClient::WriteSingleRegister, unitId, reg, 1,
+						 QVector<quint16>() << value);
+}
+
+ModbusReply *ModbusTcpChannel::writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+															 const QVector<quint16> &values)
+{
+	return sendWithReply(ModbusTcpClient::WriteMultipleRegisters, unitId, startReg,
+						 static_cast<quint16>(values.size()), values);
+}
+
+void ModbusTcpChannel::readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+											const ModbusCallback &callback)
+{
+	send(ModbusTcpClient::ReadHoldingRegisters, unitId, startReg, count, QVector<quint16>(),
+		 callback);
+}
+
+void ModbusTcpChannel::readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+										  const ModbusCallback &callback)
+{
+	send(ModbusTcpClient::ReadInputRegisters, unitId, startReg, count, QVector<quint16>(),
+		 callback);
+}
+
+void ModbusTcpChannel::writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+												  const ModbusCallback &callback)
+{
+	send(ModbusTcpClient::WriteSingleRegister, unitId, reg, 1, QVector<quint16>() << value,
+		 callback);
+}
+
+void ModbusTcpChannel::writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+													 const QVector<quint16> &values,
+													 const ModbusCallback &callback)
+{
+	send(ModbusTcpClient::WriteMultipleRegisters, unitId, startReg,
+		 static_cast<quint16>(values.size()), values, callback);
+}
+
+int ModbusTcpChannel::timeout() const
+{
+	return mTimeout;
+}
+
+void ModbusTcpChannel::setTimeout(int t)
+{
+	mTimeout = t;
+}
+
+int ModbusTcpChannel::maxInFlight() const
+{
+	if (mClient == 0)
+		return connection().maxInFlight;
+	return mClient->maxInFlight();
+}
+
+void ModbusTcpChannel::setMaxInFlight(int n)
+{
+	if (mClient != 0) {
+		mClient->setMaxInFlight(n);
+		return;
+	}
+	Connection &c = connection();
+	c.maxInFlight = qBound(1, n, ModbusTcpClient::PendingTableSize - 1);
+	ModbusIoThread::Command command;
+	command.type = ModbusIoThread::Command::SetMaxInFlight;
+	command.connection = c.id;
+	command.count = static_cast<quint16>(c.maxInFlight);
+	ModbusIoThread::instance()->post(command);
+}
+
+ModbusTcpClient::Transaction *ModbusTcpChannel::adopt(ModbusTcpClient::Transaction *t)
+{
+	t->owner = this;
+	t->timeout = mTimeout;
+	return t;
+}
+
+void ModbusTcpChannel::post(quint32 requestId, int function, quint8 unitId, quint16 startReg,
+							quint16 count, const QVector<quint16> &values,
+							const PendingRequest &request)
+{
+	ModbusIoThread::Command command;
+	command.type = ModbusIoThread::Command::Send;
+	command.connection = connection().id;
+	command.owner = this;
+	command.requestId = requestId;
+	command.function = static_cast<quint8>(function);
+	command.unitId = unitId;
+	command.startReg = startReg;
+	command.count = count;
+	command.timeout = mTimeout;
+	command.values = values;
+	mRequests.insert(requestId, request);
+	if (!ModbusIoThread::instance()->post(command)) {
+		qWarning() << "Modbus I/O queue full, dropping request to" << mKey;
+		QTimer::singleShot(0, this, [this, requestId]() {
+			complete(requestId, ModbusReply::TcpError, RegisterSpan());
+		});
+	}
+}
+
+void ModbusTcpChannel::send(int function, quint8 unitId, quint16 startReg, quint16 count,
+							const QVector<quint16> &values, const ModbusCallback &callback)
+{
+	if (mClient == 0) {
+		PendingRequest request;
+		request.callback = callback;
+		post(++mLastRequestId, function, unitId, startReg, count, values, request);
+		return;
+	}
+	mClient->send(adopt(mClient->createRequest(function, unitId, startReg, count, values)),
+				  callback);
+}
+
+ModbusReply *ModbusTcpChannel::sendWithReply(int function, quint8 unitId, quint16 startReg,
+											 quint16 count, const QVector<quint16> &values)
+{
+	if (mClient == 0) {
+		quint32 requestId = ++mLastRequestId;
+		PendingRequest request;
+		request.reply = new Reply(this, requestId);
+		post(requestId, function, unitId, startReg, count, values, request);
+		return request.reply;
+	}
+	return mClient->sendWithReply(
+		adopt(mClient->createRequest(function, unitId, startReg, count, values)), this);
+}
+
+void ModbusTcpChannel::complete(quint32 requestId, ModbusReply::ExceptionCode error,
+								const RegisterSpan &registers)
+{
+	QHash<quint32, PendingRequest>::iterator it = mRequests.find(requestId);
+	if (it == mRequests.end())
+		return;
+	PendingRequest request = *it;
+	mRequests.erase(it);
+	if (request.reply != 0)
+		request.reply->setResult(error, registers);
+	else if (request.callback)
+		request.callback(error, registers);
+}
+
+void ModbusTcpChannel::handleEvent(const ModbusIoThread::Event &event)
+{
+	QHash<QString, Connection>::iterator it = mConnections.begin();
+	while (it != mConnections.end() && it->id != event.connection)
+		++it;
+	if (it == mConnections.end())
+		return;
+	switch (event.type) {
+	case ModbusIoThread::Event::Connected:
+	case ModbusIoThread::Event::Disconnected:
+	{
+		bool connected = event.type == ModbusIoThread::Event::Connected;
+		it->state = connected ? QAbstractSocket::ConnectedState :
+								QAbstractSocket::UnconnectedState;
+		// Handlers may delete channels, and with them the connection
+		QString k = it.key();
+		QList<ModbusTcpChannel *> channels = it->channels;
+		foreach (ModbusTcpChannel *channel, channels) {
+			QHash<QString, Connection>::iterator c = mConnections.find(k);
+			if (c == mConnections.end() || !c->channels.contains(channel))
+				continue;
+			if (connected)
+				emit channel->connected();
+			else
+				emit channel->disconnected();
+		}
+		break;
+	}
+	case ModbusIoThread::Event::Result:
+		// The owner may have been deleted after the request was sent. In that case it is no
+		// longer listed, or a new channel has been created at the same address, which does not
+		// know the request ID.
+		foreach (ModbusTcpChannel *channel, it->channels) {
+			if (channel == event.owner) {
+				channel->complete(event.requestId, event.error, event.registerSpan());
+				break;
+			}
+		}
+		break;
+	}
+}
+
+ModbusTcpChannel::Reply::Reply(ModbusTcpChannel *channel, quint32 requestId):
+	ModbusReply(channel),
+	mChannel(channel),
+	mRequestId(requestId),
+	mFinished(false)
+{
+}
+
+ModbusTcpChannel::Reply::~Reply()
+{
+	// Deleting an unfinished reply drops the result. The request itself stays on the wire.
+	if (mChannel != 0 && !mFinished)
+		mChannel->mRequests.remove(mRequestId);
+}
+
+void ModbusTcpChannel::Reply::setResult(ExceptionCode error, const RegisterSpan &registers)
+{
+	if (error == NoException)
+		ModbusReply::setResult(registers);
+	else
+		ModbusReply::setResult(error);
+}
+
+bool ModbusTcpChannel::Reply::isFinished() const
+{
+	return mFinished;
+}
+
+void ModbusTcpChannel::Reply::onFinished()
+{
+	mFinished = true;
+}
@@ -0,0 +1,200 @@
+#ifndef MODBUS_TCP_CHANNEL_H
+#define MODBUS_TCP_CHANNEL_H
+
+#include <QHash>
+#include "modbus_client.h"
+#include "modbus_io_thread.h"
+#include "modbus_tcp_client.h"
+
+/*!
+ * Reference to a modbus TCP connection shared by all users of the same host and port.
+ *
+ * Channels are created with `open`, which looks up the connection in a process-wide registry
+ * keyed by host:port, and creates it if it does not exist yet. This way multiple unit IDs on the
+ * same device (like the inverters behind a Fronius data manager) use a single socket, which also
+ * helps with devices that only accept one connection (SolarEdge).
+ *
+ * A connection stays open for `LingerTime` milliseconds after the last channel has been
+ * destroyed. This allows the updater that is created after a successful detection to take over
+ * the connection of the detector, instead of reconnecting.
+ *
+ * Each channel has its own timeout. Deleting a channel cancels the requests sent through it, so
+ * callbacks are never called after the channel is gone.
+ *
+ * If the `ModbusIoThread` has been started, the client of a connection lives in the I/O thread.
+ * The channel then posts its requests to that thread, and keeps track of the connection state
+ * and the pending requests itself.
+ */
+class ModbusTcpChannel : public ModbusClient
+{
+	Q_OBJECT
+public:
+	static const int LingerTime = 10000; // ms
+
+	static ModbusTcpChannel *open(const QString &hostName, quint16 tcpPort,
+								  QObject *parent = 0);
+
+	~ModbusTcpChannel() override;
+
+	/*!
+	 * Opens the shared connection if it is not open yet. If the connection has already been
+	 * established, `connected` is emitted from the event loop.
+	 */
+	void connectToServer();
+
+	bool isConnected() const;
+
+	QString hostName() const;
+
+	quint16 portName() const;
+
+	using ModbusClient::readHoldingRegisters;
+	using ModbusClient::readInputRegisters;
+	using ModbusClient::writeSingleHoldingRegister;
+	using ModbusClient::writeMultipleHoldingRegisters;
+
+	ModbusReply *readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count) override;
+
+	ModbusReply *readInputRegisters(quint8 unitId, quint16 startReg, quint16 count) override;
+
+	ModbusReply *writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value) override;
+
+	ModbusReply *writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+											   const QVector<quint16> &values) override;
+
+	void readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+							  const ModbusCallback &callback) override;
+
+	void readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+							const ModbusCallback &callback) override;
+
+	void writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+									const ModbusCallback &callback) override;
+
+	void writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+									   const QVector<quint16> &values,
+									   const ModbusCallback &callback) override;
+
+	int timeout() const override;
+
+	void setTimeout(int t) override;
+
+	/*!
+	 * The in-flight window is a property of the connection, so it applies to all channels
+	 * sharing it.
+	 */
+	int maxInFlight() const;
+
+	void setMaxInFlight(int n);
+
+signals:
+	void connected();
+
+	void disconnected();
+
+private:
+	friend class ModbusIoThread;
+
+	struct Connection
+	{
+		Connection():
+			client(0),
+			id(0),
+			refCount(0),
+			generation(0),
+			state(QAbstractSocket::UnconnectedState),
+			maxInFlight(1)
+		{
+		}
+
+		ModbusTcpClient *client; // Only set if the client lives in the main thread
+		int id;
+		int refCount;
+		quint32 generation; // Incremented on every release, used to validate linger timeouts
+		// Used when the client lives in the I/O thread
+		QAbstractSocket::SocketState state;
+		int maxInFlight;
+		QList<ModbusTcpChannel *> channels;
+	};
+
+	/*!
+	 * Adapter for the QObject API, used when the client lives in the I/O thread.
+	 */
+	class Reply : public ModbusReply
+	{
+	public:
+		Reply(ModbusTcpChannel *channel, quint32 requestId);
+
+		~Reply() override;
+
+		void setResult(ExceptionCode error, const RegisterSpan &registers);
+
+		void detach()
+		{
+			mChannel = 0;
+		}
+
+		bool isFinished() const override;
+
+	private:
+		void onFinished() override;
+
+		ModbusTcpChannel *mChannel;
+		quint32 mRequestId;
+		bool mFinished;
+	};
+
+	struct PendingRequest
+	{
+		PendingRequest():
+			reply(0)
+		{
+		}
+
+		ModbusCallback callback;
+		Reply *reply;
+	};
+
+	ModbusTcpChannel(const QString &hostName, quint16 tcpPort, const QString &key,
+					 QObject *parent);
+
+	Connection &connection() const;
+
+	/*!
+	 * Marks `t` as sent through this channel.
+	 */
+	ModbusTcpClient::Transaction *adopt(ModbusTcpClient::Transaction *t);
+
+	/*!
+	 * Sends a request through the I/O thread.
+	 */
+	void post(quint32 requestId, int function, quint8 unitId, quint16 startReg, quint16 count,
+			  const QVector<quint16> &values, const PendingRequest &request);
+
+	void send(int function, quint8 unitId, quint16 startReg, quint16 count,
+			  const QVector<quint16> &values, const ModbusCallback &callback);
+
+	ModbusReply *sendWithReply(int function, quint8 unitId, quint16 startReg, quint16 count,
+							   const QVector<quint16> &values);
+
+	void complete(quint32 requestId, ModbusReply::ExceptionCode error,
+				  const RegisterSpan &registers);
+
+	static void handleEvent(const ModbusIoThread::Event &event);
+
+	static QString key(const QString &hostName, quint16 tcpPort);
+
+	static void release(const QString &key);
+
+	QString mHostName;
+	quint16 mTcpPort;
+	QString mKey;
+	ModbusTcpClient *mClient; // 0 if the client lives in the I/O thread
+	int mTimeout;
+	QHash<quint32, PendingRequest> mRequests;
+	static QHash<QString, Connection> mConnections;
+	static int mLastConnectionId;
+	static quint32 mLastRequestId;
+};
+
+#endif // MODBUS_TCP_CHANNEL_H
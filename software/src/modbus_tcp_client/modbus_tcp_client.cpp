@@ -1,72 +1,116 @@
 #include <QHostAddress>
-#include <QTcpSocket>
 #include <QTimer>
 #include "crc16.h"
 #include "modbus_tcp_client.h"
 #include "modbus_reply.h"
 
+// Number of consecutive successful transactions before the in-flight window is widened by one.
+static const int WindowProbeCount = 10;
+
+QSet<QString> ModbusTcpClient::mSerialOnlyEndpoints;
+QHash<QString, int> ModbusTcpClient::mConcurrencyErrors;
+
 ModbusTcpClient::ModbusTcpClient(QObject *parent):
+	ModbusTcpClient(ModbusTcpTransport::create(), parent)
+{
+}
+
+ModbusTcpClient::ModbusTcpClient(ModbusTcpTransport *transport, QObject *parent):
 	ModbusClient(parent),
-	mSocket(new QTcpSocket(this)),
+	mPendingCount(0),
+	mSocket(transport),
 	mTimeout(1000),
-	mConnectTimerId(0),
+	mMaxInFlight(1),
+	mWindow(1),
+	mSuccessCount(0),
 	mTransactionId(0)
 {
-	mSocket->socketOption(QAbstractSocket::LowDelayOption);
+	mSocket->setParent(this);
 	connect(mSocket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
 	connect(mSocket, SIGNAL(connected()), this, SLOT(onConnected()));
 	connect(mSocket, SIGNAL(disconnected()), this, SIGNAL(disconnected()));
 	connect(mSocket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)),
 			this, SLOT(onSocketErrorReceived(QAbstractSocket::SocketError)));
+	for (int i=0; i<PendingTableSize; ++i)
+		mPending[i] = 0;
+}
+
+ModbusTcpClient::~ModbusTcpClient()
+{
+	// Replies are children of the client, so they will be deleted after this destructor. Make
+	// sure they do not refer to the transactions, which are released with the pool.
+	foreach (Transaction *t, mQueue) {
+		if (t->reply != 0)
+			t->reply->detach();
+	}
+	for (int i=0; i<PendingTableSize; ++i) {
+		if (mPending[i] != 0 && mPending[i]->reply != 0)
+			mPending[i]->reply->detach();
+	}
 }
 
 void ModbusTcpClient::connectToServer(const QString &hostName, quint16 tcpPort)
 {
 	mHostName = hostName;
 	mTcpPort = tcpPort;
-	mConnectTimerId = startTimer(mTimeout);
+	startTimeout(mTimeout);
 	mSocket->connectToHost(hostName, tcpPort);
 }
 
 bool ModbusTcpClient::isConnected() const
 {
-	return mSocket->state() == QTcpSocket::ConnectedState;
+	return mSocket->state() == QAbstractSocket::ConnectedState;
+}
+
+QAbstractSocket::SocketState ModbusTcpClient::state() const
+{
+	return mSocket->state();
 }
 
 ModbusReply *ModbusTcpClient::readInputRegisters(quint8 unitId, quint16 startReg, quint16 count)
 {
-	return readRegisters(ReadInputRegisters, unitId, startReg, count);
+	return sendWithReply(createReadRequest(ReadInputRegisters, unitId, startReg, count), this);
 }
 
 ModbusReply *ModbusTcpClient::readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count)
 {
-	return readRegisters(ReadHoldingRegisters, unitId, startReg, count);
+	return sendWithReply(createReadRequest(ReadHoldingRegisters, unitId, startReg, count), this);
 }
 
 ModbusReply *ModbusTcpClient::writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value)
 {
-	QByteArray frame = createFrame(WriteSingleRegister, unitId, 4);
-	frame.append(static_cast<char>(msb(reg)));
-	frame.append(static_cast<char>(lsb(reg)));
-	frame.append(static_cast<char>(msb(value)));
-	frame.append(static_cast<char>(lsb(value)));
-	return sendFrame(frame);
+	return sendWithReply(createWriteSingleRequest(unitId, reg, value), this);
 }
 
 ModbusReply *ModbusTcpClient::writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
 															const QVector<quint16> &values)
 {
-	QByteArray frame = createFrame(WriteMultipleRegisters, unitId, 5 + 2 * values.size());
-	frame.append(static_cast<char>(msb(startReg)));
-	frame.append(static_cast<char>(lsb(startReg)));
-	frame.append(static_cast<char>(msb(values.size())));
-	frame.append(static_cast<char>(lsb(values.size())));
-	frame.append(static_cast<char>(values.size() * 2));
-	foreach (quint16 value, values) {
-		frame.append(static_cast<char>(msb(value)));
-		frame.append(static_cast<char>(lsb(value)));
-	}
-	return sendFrame(frame);
+	return sendWithReply(createWriteMultipleRequest(unitId, startReg, values), this);
+}
+
+void ModbusTcpClient::readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+										   const ModbusCallback &callback)
+{
+	send(createReadRequest(ReadHoldingRegisters, unitId, startReg, count), callback);
+}
+
+void ModbusTcpClient::readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+										 const ModbusCallback &callback)
+{
+	send(createReadRequest(ReadInputRegisters, unitId, startReg, count), callback);
+}
+
+void ModbusTcpClient::writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+												 const ModbusCallback &callback)
+{
+	send(createWriteSingleRequest(unitId, reg, value), callback);
+}
+
+void ModbusTcpClient::writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+													const QVector<quint16> &values,
+													const ModbusCallback &callback)
+{
+	send(createWriteMultipleRequest(unitId, startReg, values), callback);
 }
 
 QString ModbusTcpClient::hostName() const
@@ -89,189 +133,468 @@ void ModbusTcpClient::setTimeout(int t)
 	mTimeout = t;
 }
 
-void ModbusTcpClient::timerEvent(QTimerEvent *event)
+int ModbusTcpClient::maxInFlight() const
 {
-	Q_UNUSED(event)
-	Q_ASSERT(mConnectTimerId > 0);
-	if (mConnectTimerId == 0)
-		return;
-	killTimer(mConnectTimerId);
-	mConnectTimerId = 0;
+	return mMaxInFlight;
+}
+
+void ModbusTcpClient::setMaxInFlight(int n)
+{
+	mMaxInFlight = qBound(1, n, PendingTableSize - 1);
+	mWindow = qMin(mWindow, mMaxInFlight);
+	mSuccessCount = 0;
+	sendPending();
+}
+
+bool ModbusTcpClient::isSerialOnly() const
+{
+	return mSerialOnlyEndpoints.contains(endpoint());
+}
+
+void ModbusTcpClient::onTimeout()
+{
+	// Connection timeout. The requests will not be sent, so do not let them wait for their own
+	// timeout.
 	mSocket->disconnectFromHost();
+	failTransactions();
 	emit disconnected();
 }
 
 void ModbusTcpClient::onConnected()
 {
-	if (mConnectTimerId > 0) {
-		killTimer(mConnectTimerId);
-		mConnectTimerId = 0;
-	}
+	stopTimeout();
+	// Earlier errors may have been caused by the connection problem we just recovered from, so
+	// probe the in-flight window again.
+	mSerialOnlyEndpoints.remove(endpoint());
+	mConcurrencyErrors.remove(endpoint());
+	mWindow = 1;
+	mSuccessCount = 0;
 	emit connected();
 }
 
 void ModbusTcpClient::onReadyRead()
 {
-	mBuffer.append(mSocket->read(mSocket->bytesAvailable()));
-	for (;;) {
-		if (mBuffer.size() < 6)
-			return;
-		int length = toUInt16(mBuffer, 4) + 6;
-		if (mBuffer.size() < length)
-			return;
-		quint16 transactionId = toUInt16(mBuffer, 0);
-		Q_ASSERT(toUInt16(mBuffer, 2) == 0);
-		// quint8 unitId = static_cast<quint8>(mBuffer[6]);
-		quint8 functionCode = static_cast<quint8>(mBuffer[7]);
-		if ((functionCode & 0x80) == 0) {
-			switch (functionCode) {
-			case ReadHoldingRegisters:
-			case ReadInputRegisters:
-				if (mBuffer.size() > 8) {
-					quint8 payloadSize = static_cast<quint8>(mBuffer[8]);
-					int i0 = 9;
-					int i1 = i0 + payloadSize;
-					if (i1 == length) {
-						QVector<quint16> values;
-						for (; i0 < i1; i0 += 2)
-							values.append(toUInt16(mBuffer, i0));
-						setFinished(transactionId, values);
-						break;
-					}
-				}
-				setFinished(transactionId, ModbusReply::ParseError);
+	// Frames are parsed in place. After all complete frames have been consumed, less than one
+	// frame remains in the buffer, so there is always room for more data.
+	while (mBuffer.readFrom(mSocket) > 0) {
+		for (;;) {
+			if (mBuffer.size() < 6)
 				break;
-			case WriteSingleRegister:
-				if (mBuffer.size() > 11) {
-					// quint16 startReg = toUInt16(mBuffer, 8);
-					quint16 value = toUInt16(mBuffer, 10);
-					QVector<quint16> values;
-					values.append(value);
-					setFinished(transactionId, values);
-					break;
-				}
-				setFinished(transactionId, ModbusReply::ParseError);
+			int length = mBuffer.toUInt16(4) + 6;
+			if (length > MaxAduSize) {
+				// Not a valid MBAP header, so we have lost track of the frame boundaries.
+				qWarning() << "Invalid modbus frame length from" << endpoint();
+				mBuffer.clear();
 				break;
-			case WriteMultipleRegisters:
-				if (mBuffer.size() == 12) {
-					// quint16 startReg = toUInt16(mBuffer, 8);
-					// quint16 regCount = toUInt16(mBuffer, 10);
-					setFinished(transactionId, QVector<quint16>());
+			}
+			if (mBuffer.size() < length)
+				break;
+			parseFrame(length);
+			mBuffer.skip(length);
+		}
+	}
+}
+
+void ModbusTcpClient::parseFrame(int length)
+{
+	quint16 transactionId = mBuffer.toUInt16(0);
+	Q_ASSERT(mBuffer.toUInt16(2) == 0);
+	// quint8 unitId = mBuffer.at(6);
+	if (length < 8) {
+		setError(transactionId, ModbusReply::ParseError);
+		return;
+	}
+	quint8 functionCode = mBuffer.at(7);
+	Transaction *pending = pendingTransaction(transactionId);
+	if (pending != 0 && pending->function != (functionCode & 0x7F)) {
+		// The reply does not belong to the request with this transaction ID. The device
+		// probably got confused by multiple requests being on the wire.
+		onConcurrencyError();
+		setError(transactionId, ModbusReply::ParseError);
+	} else if ((functionCode & 0x80) == 0) {
+		switch (functionCode) {
+		case ReadHoldingRegisters:
+		case ReadInputRegisters:
+			if (length > 8) {
+				quint8 payloadSize = mBuffer.at(8);
+				if (9 + payloadSize == length) {
+					setFinished(transactionId, 9, payloadSize / 2);
 					break;
 				}
-				setFinished(transactionId, ModbusReply::ParseError);
+			}
+			setError(transactionId, ModbusReply::ParseError);
+			break;
+		case WriteSingleRegister:
+			if (length > 11) {
+				// quint16 startReg = mBuffer.toUInt16(8);
+				// Value written at offset 10
+				setFinished(transactionId, 10, 1);
 				break;
 			}
-		} else {
-			if (mBuffer.size() > 8) {
-				quint8 error = static_cast<quint8>(mBuffer[8]);
-				setFinished(transactionId, error);
-			} else {
-				setFinished(transactionId, ModbusReply::ParseError);
+			setError(transactionId, ModbusReply::ParseError);
+			break;
+		case WriteMultipleRegisters:
+			if (length == 12) {
+				// quint16 startReg = mBuffer.toUInt16(8);
+				// quint16 regCount = mBuffer.toUInt16(10);
+				setFinished(transactionId, 0, 0);
+				break;
 			}
+			setError(transactionId, ModbusReply::ParseError);
+			break;
+		}
+	} else {
+		if (length > 8) {
+			quint8 error = mBuffer.at(8);
+			setError(transactionId, error);
+		} else {
+			setError(transactionId, ModbusReply::ParseError);
 		}
-		mBuffer.remove(0, length);
 	}
 }
 
-void ModbusTcpClient::onReplyDestroyed()
-{
-	Reply *reply = static_cast<Reply *>(sender());
-	mPendingReplies.remove(reply->transactionId());
-}
-
 void ModbusTcpClient::onSocketErrorReceived(QAbstractSocket::SocketError error)
 {
 	Q_UNUSED(error)
-	foreach (Reply *reply, mPendingReplies)
-		reply->setResult(ModbusReply::TcpError);
-	mPendingReplies.clear();
+	stopTimeout();
+	failTransactions();
 	emit disconnected();
 }
 
-ModbusReply *ModbusTcpClient::sendFrame(const QByteArray &frame)
+void ModbusTcpClient::failTransactions()
 {
-	Reply *reply = new Reply(mTransactionId, mTimeout, this);
-	mPendingReplies[mTransactionId] = reply;
-	mSocket->write(frame);
-	connect(reply, SIGNAL(destroyed()), this, SLOT(onReplyDestroyed()));
-	return reply;
+	QList<Transaction *> transactions;
+	for (int i=0; i<PendingTableSize; ++i) {
+		if (mPending[i] != 0) {
+			transactions.append(mPending[i]);
+			mPending[i] = 0;
+		}
+	}
+	mPendingCount = 0;
+	transactions.append(mQueue);
+	mQueue.clear();
+	foreach (Transaction *t, transactions)
+		complete(t, ModbusReply::TcpError);
 }
 
-ModbusTcpClient::Reply *ModbusTcpClient::popReply(quint16 transactionId)
+ModbusTcpClient::Transaction *ModbusTcpClient::createTransaction(FunctionCode function,
+																 quint8 unitId, int pduSize)
 {
-	QHash<quint16, Reply *>::Iterator it = mPendingReplies.find(transactionId);
-	if (it == mPendingReplies.end())
-		return 0;
-	Reply *reply = it.value();
-	mPendingReplies.erase(it);
-	disconnect(reply);
+	Transaction *t = mPool.allocate();
+	t->client = this;
+	t->timeout = mTimeout;
+	t->transactionId = ++mTransactionId;
+	t->function = function;
+	t->frameSize = 0;
+	t->appendWord(mTransactionId);
+	t->appendWord(0); // Protocol ID
+	t->appendWord(static_cast<quint16>(pduSize + 2));
+	t->appendByte(unitId);
+	t->appendByte(function);
+	return t;
+}
+
+ModbusTcpClient::Transaction *ModbusTcpClient::createReadRequest(FunctionCode function,
+																 quint8 unitId, quint16 startReg,
+																 quint16 count)
+{
+	Transaction *t = createTransaction(function, unitId, 4);
+	t->appendWord(startReg);
+	t->appendWord(count);
+	return t;
+}
+
+ModbusTcpClient::Transaction *ModbusTcpClient::createWriteSingleRequest(quint8 unitId,
+																		quint16 reg,
+																		quint16 value)
+{
+	Transaction *t = createTransaction(WriteSingleRegister, unitId, 4);
+	t->appendWord(reg);
+	t->appendWord(value);
+	return t;
+}
+
+ModbusTcpClient::Transaction *ModbusTcpClient::createWriteMultipleRequest(
+	quint8 unitId, quint16 startReg, const QVector<quint16> &values)
+{
+	Q_ASSERT(values.size() <= 123);
+	Transaction *t = createTransaction(WriteMultipleRegisters, unitId, 5 + 2 * values.size());
+	t->appendWord(startReg);
+	t->appendWord(static_cast<quint16>(values.size()));
+	t->appendByte(static_cast<quint8>(values.size() * 2));
+	foreach (quint16 value, values)
+		t->appendWord(value);
+	return t;
+}
+
+ModbusTcpClient::Transaction *ModbusTcpClient::createRequest(int function, quint8 unitId,
+															 quint16 startReg, quint16 count,
+															 const QVector<quint16> &values)
+{
+	switch (function) {
+	case ReadHoldingRegisters:
+	case ReadInputRegisters:
+		return createReadRequest(static_cast<FunctionCode>(function), unitId, startReg, count);
+	case WriteSingleRegister:
+		Q_ASSERT(!values.isEmpty());
+		return createWriteSingleRequest(unitId, startReg, values.value(0));
+	default:
+		Q_ASSERT(function == WriteMultipleRegisters);
+		return createWriteMultipleRequest(unitId, startReg, values);
+	}
+}
+
+void ModbusTcpClient::send(Transaction *t, const ModbusCallback &callback)
+{
+	t->callback = callback;
+	t->state = Transaction::Queued;
+	mQueue.append(t);
+	sendPending();
+}
+
+ModbusReply *ModbusTcpClient::sendWithReply(Transaction *t, QObject *parent)
+{
+	Reply *reply = new Reply(t, this, parent);
+	t->reply = reply;
+	send(t, ModbusCallback());
 	return reply;
 }
 
-ModbusReply *ModbusTcpClient::readRegisters(FunctionCode function, quint8 unitId, quint16 startReg,
-											quint16 count)
+void ModbusTcpClient::sendPending()
 {
-	QByteArray frame = createFrame(function, unitId, 4);
-	frame.append(static_cast<char>(msb(startReg)));
-	frame.append(static_cast<char>(lsb(startReg)));
-	frame.append(static_cast<char>(msb(count)));
-	frame.append(static_cast<char>(lsb(count)));
-	return sendFrame(frame);
+	int window = isSerialOnly() ? 1 : mWindow;
+	while (!mQueue.isEmpty() && mPendingCount < window) {
+		Transaction *t = mQueue.first();
+		Transaction *&slot = mPending[t->transactionId & (PendingTableSize - 1)];
+		// The slot may still be taken by a slow transaction issued 256 requests ago.
+		if (slot != 0)
+			break;
+		mQueue.removeFirst();
+		slot = t;
+		++mPendingCount;
+		t->state = Transaction::Sent;
+		t->startTimeout(t->timeout);
+		mSocket->write(reinterpret_cast<const char *>(t->frame), t->frameSize);
+	}
 }
 
-QByteArray ModbusTcpClient::createFrame(ModbusTcpClient::FunctionCode function, quint8 unitId,
-										quint8 count)
+ModbusTcpClient::Transaction *ModbusTcpClient::pendingTransaction(quint16 transactionId) const
 {
-	++mTransactionId;
-	QByteArray frame;
-	frame.append(static_cast<char>(msb(mTransactionId)));
-	frame.append(static_cast<char>(lsb(mTransactionId)));
-	frame.append(static_cast<char>(0));
-	frame.append(static_cast<char>(0));
-	frame.append(static_cast<char>(0));
-	frame.append(static_cast<char>(count + 2));
-	frame.append(static_cast<char>(unitId));
-	frame.append(static_cast<char>(function));
-	return frame;
+	Transaction *t = mPending[transactionId & (PendingTableSize - 1)];
+	if (t == 0 || t->transactionId != transactionId)
+		return 0;
+	return t;
 }
 
-void ModbusTcpClient::setFinished(quint16 transactionId, const QVector<quint16> &values)
+ModbusTcpClient::Transaction *ModbusTcpClient::popTransaction(quint16 transactionId)
 {
-	Reply *reply = popReply(transactionId);
-	if (reply != 0)
-		reply->setResult(values);
+	Transaction *t = pendingTransaction(transactionId);
+	if (t == 0)
+		return 0;
+	mPending[transactionId & (PendingTableSize - 1)] = 0;
+	--mPendingCount;
+	return t;
 }
 
-void ModbusTcpClient::setFinished(quint16 transactionId, int error)
+void ModbusTcpClient::complete(Transaction *t, ModbusReply::ExceptionCode error,
+							   const RegisterSpan &registers)
 {
-	Reply *reply = popReply(transactionId);
+	// Release the record before calling back, so it can be reused by requests sent from the
+	// callback.
+	Reply *reply = t->reply;
+	ModbusCallback callback;
+	callback.swap(t->callback);
+	mPool.release(t);
 	if (reply != 0)
-		reply->setResult(static_cast<ModbusReply::ExceptionCode>(error));
+		reply->setResult(error, registers);
+	else if (callback)
+		callback(error, registers);
+}
+
+void ModbusTcpClient::cancel(Transaction *t)
+{
+	switch (t->state) {
+	case Transaction::Queued:
+		mQueue.removeOne(t);
+		mPool.release(t);
+		break;
+	case Transaction::Sent:
+		popTransaction(t->transactionId);
+		mPool.release(t);
+		sendPending();
+		break;
+	case Transaction::Free:
+		break;
+	}
+}
+
+void ModbusTcpClient::cancelTransactions(const ModbusTcpChannel *owner)
+{
+	QList<Transaction *> transactions;
+	foreach (Transaction *t, mQueue) {
+		if (t->owner == owner)
+			transactions.append(t);
+	}
+	for (int i=0; i<PendingTableSize; ++i) {
+		if (mPending[i] != 0 && mPending[i]->owner == owner)
+			transactions.append(mPending[i]);
+	}
+	foreach (Transaction *t, transactions) {
+		if (t->reply != 0)
+			t->reply->detach();
+		cancel(t);
+	}
+}
+
+void ModbusTcpClient::onTransactionTimeout(Transaction *t)
+{
+	// A timeout while other requests were also on the wire suggests that the device drops
+	// concurrent transactions.
+	if (mPendingCount > 1)
+		onConcurrencyError();
+	mSuccessCount = 0;
+	popTransaction(t->transactionId);
+	complete(t, ModbusReply::Timeout);
+	sendPending();
+}
+
+void ModbusTcpClient::onConcurrencyError()
+{
+	// All requests that were on the wire together tend to fail together. Only the first one
+	// counts, the others find the window already closed.
+	bool concurrent = mWindow > 1;
+	mWindow = 1;
+	mSuccessCount = 0;
+	if (!concurrent || mMaxInFlight < 2 || isSerialOnly())
+		return;
+	if (++mConcurrencyErrors[endpoint()] < MaxConcurrencyErrors) {
+		qDebug() << "Concurrent modbus transactions failed on" << endpoint()
+				 << "resetting the in-flight window";
+		return;
+	}
+	qWarning() << "Device at" << endpoint()
+			   << "does not handle concurrent modbus transactions, using serial mode";
+	mSerialOnlyEndpoints.insert(endpoint());
 }
 
-ModbusTcpClient::Reply::Reply(quint16 transactionId, int timeout, QObject *parent):
+QString ModbusTcpClient::endpoint() const
+{
+	return QString("%1:%2").arg(mHostName).arg(mTcpPort);
+}
+
+void ModbusTcpClient::setFinished(quint16 transactionId, int offset, int count)
+{
+	Transaction *t = popTransaction(transactionId);
+	if (t == 0)
+		return;
+	if (mWindow < mMaxInFlight && !isSerialOnly() && ++mSuccessCount >= WindowProbeCount) {
+		++mWindow;
+		mSuccessCount = 0;
+	}
+	count = qMin(count, static_cast<int>(ModbusReply::MaxRegisters));
+	for (int i=0; i<count; ++i)
+		mRegisters[i] = mBuffer.toUInt16(offset + 2 * i);
+	complete(t, ModbusReply::NoException, RegisterSpan(mRegisters, count));
+	sendPending();
+}
+
+void ModbusTcpClient::setError(quint16 transactionId, int error)
+{
+	Transaction *t = popTransaction(transactionId);
+	if (t == 0)
+		return;
+	complete(t, static_cast<ModbusReply::ExceptionCode>(error));
+	sendPending();
+}
+
+ModbusTcpClient::Transaction::Transaction():
+	client(0),
+	reply(0),
+	owner(0),
+	nextFree(0),
+	transactionId(0),
+	function(0),
+	state(Free),
+	timeout(0),
+	frameSize(0)
+{
+}
+
+void ModbusTcpClient::Transaction::onTimeout()
+{
+	client->onTransactionTimeout(this);
+}
+
+ModbusTcpClient::TransactionPool::TransactionPool():
+	mFreeList(0)
+{
+}
+
+ModbusTcpClient::TransactionPool::~TransactionPool()
+{
+	foreach (Transaction *slab, mSlabs)
+		delete[] slab;
+}
+
+ModbusTcpClient::Transaction *ModbusTcpClient::TransactionPool::allocate()
+{
+	if (mFreeList == 0) {
+		Transaction *slab = new Transaction[SlabSize];
+		mSlabs.append(slab);
+		for (int i=0; i<SlabSize; ++i) {
+			slab[i].nextFree = mFreeList;
+			mFreeList = &slab[i];
+		}
+	}
+	Transaction *t = mFreeList;
+	mFreeList = t->nextFree;
+	t->nextFree = 0;
+	return t;
+}
+
+void ModbusTcpClient::TransactionPool::release(Transaction *t)
+{
+	Q_ASSERT(t->state != Transaction::Free);
+	t->stopTimeout();
+	t->state = Transaction::Free;
+	t->reply = 0;
+	t->owner = 0;
+	t->callback = nullptr;
+	t->nextFree = mFreeList;
+	mFreeList = t;
+}
+
+ModbusTcpClient::Reply::Reply(Transaction *transaction, ModbusTcpClient *client,
+							  QObject *parent):
 	ModbusReply(parent),
-	mTimerId(startTimer(timeout)),
-	mTransactionId(transactionId)
+	mClient(client),
+	mTransaction(transaction),
+	mFinished(false)
 {
 }
 
-bool ModbusTcpClient::Reply::isFinished() const
+ModbusTcpClient::Reply::~Reply()
 {
-	return mTimerId == 0;
+	// Deleting an unfinished reply cancels the request
+	if (mTransaction != 0)
+		mClient->cancel(mTransaction);
 }
 
-void ModbusTcpClient::Reply::onFinished()
+void ModbusTcpClient::Reply::setResult(ExceptionCode error, const RegisterSpan &registers)
+{
+	mTransaction = 0;
+	if (error == NoException)
+		ModbusReply::setResult(registers);
+	else
+		ModbusReply::setResult(error);
+}
+
+bool ModbusTcpClient::Reply::isFinished() const
 {
-	Q_ASSERT(mTimerId > 0);
-	killTimer(mTimerId);
-	mTimerId = 0;
+	return mFinished;
 }
 
-void ModbusTcpClient::Reply::timerEvent(QTimerEvent *event)
+void ModbusTcpClient::Reply::onFinished()
 {
-	Q_UNUSED(event)
-	Q_ASSERT(mTimerId > 0);
-	setResult(Timeout);
+	mFinished = true;
 }
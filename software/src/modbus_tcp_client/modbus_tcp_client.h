@@ -2,24 +2,65 @@
 #define MODBUSTCPCLIENT_H
 
 #include <QAbstractSocket>
+#include <QHash>
+#include <QList>
 #include <QObject>
+#include <QSet>
 #include "modbus_client.h"
+#include "crc16.h"
 #include "modbus_reply.h"
+#include "modbus_tcp_transport.h"
+#include "ring_buffer.h"
+#include "timer_wheel.h"
 
+class ModbusTcpChannel;
 class QTimer;
 
-class ModbusTcpClient: public ModbusClient
+/*!
+ * Modbus TCP client.
+ *
+ * Requests are queued and written to the socket as long as the number of unanswered requests
+ * does not exceed the in-flight window. By default the window is 1, so a request is not sent
+ * before the reply on the previous one has been received (or has timed out). If the window is
+ * enlarged using `setMaxInFlight`, the client starts with a single request and widens the window
+ * step by step after a number of successful transactions. If the device appears to mishandle
+ * concurrent transactions (a reply that does not match its request, or a timeout while multiple
+ * requests were pending) the window drops back to 1. A single error may also be caused by a
+ * network problem, so only after `MaxConcurrencyErrors` of these errors the client falls back to
+ * strictly serial mode for this host and port. The errors are forgotten, and the window is
+ * probed again, after the next successful connect.
+ *
+ * Requests may be sent using the `ModbusReply` API or with a completion callback. The latter
+ * does not allocate any QObjects: the transaction records come from a pool owned by the client.
+ *
+ * Unless a transport is passed to the constructor, the socket is created by
+ * `ModbusTcpTransport::create`, so the backend can be selected with
+ * `ModbusTcpTransport::setDefaultBackend`.
+ */
+class ModbusTcpClient: public ModbusClient, private TimerWheel::Entry
 {
 	Q_OBJECT
 public:
 	static const quint16 DefaultTcpPort = 502;
 
+	// Number of errors in concurrent transactions before an endpoint is put in serial mode
+	static const int MaxConcurrencyErrors = 3;
+
 	ModbusTcpClient(QObject *parent = 0);
 
+	/*!
+	 * Creates a client that talks through `transport`, which becomes a child of the client.
+	 */
+	explicit ModbusTcpClient(ModbusTcpTransport *transport, QObject *parent = 0);
+
+	~ModbusTcpClient() override;
+
 	void connectToServer(const QString &hostName, quint16 tcpPort = DefaultTcpPort);
 
 	bool isConnected() const;
 
+	QAbstractSocket::SocketState state() const;
+
 	ModbusReply *readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count) override;
 
 	ModbusReply *readInputRegisters(quint8 unitId, quint16 startReg, quint16 count) override;
@@ -29,6 +70,19 @@ public:
 	ModbusReply *writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
 													   const QVector<quint16> &values) override;
 
+	void readHoldingRegisters(quint8 unitId, quint16 startReg, quint16 count,
+							  const ModbusCallback &callback) override;
+
+	void readInputRegisters(quint8 unitId, quint16 startReg, quint16 count,
+							const ModbusCallback &callback) override;
+
+	void writeSingleHoldingRegister(quint8 unitId, quint16 reg, quint16 value,
+									const ModbusCallback &callback) override;
+
+	void writeMultipleHoldingRegisters(quint8 unitId, quint16 startReg,
+									   const QVector<quint16> &values,
+									   const ModbusCallback &callback) override;
+
 	QString hostName() const;
 
 	quint16 portName() const;
@@ -37,24 +91,40 @@ public:
 
 	void setTimeout(int t) override;
 
+	/*!
+	 * Maximum number of requests that may be on the wire at the same time.
+	 */
+	int maxInFlight() const;
+
+	void setMaxInFlight(int n);
+
+	/*!
+	 * Number of requests currently allowed on the wire. This value is between 1 and
+	 * `maxInFlight` and grows while the device handles concurrent transactions correctly.
+	 */
+	int window() const
+	{
+		return mWindow;
+	}
+
+	bool isSerialOnly() const;
+
 signals:
 	void connected();
 
 	void disconnected();
 
-protected:
-	virtual void timerEvent(QTimerEvent *event) override;
-
 private slots:
 	void onConnected();
 
 	void onReadyRead();
 
-	void onReplyDestroyed();
-
 	void onSocketErrorReceived(QAbstractSocket::SocketError error);
 
 private:
+	friend class ModbusTcpChannel;
+	friend class ModbusIoWorker;
+
 	enum FunctionCode
 	{
 		ReadCoils						= 1,
@@ -73,49 +143,187 @@ private:
 		EncapsulatedInterfaceTransport	= 43,
 	};
 
-	class Reply : public ModbusReply {
+	// Maximum size of a modbus TCP frame (MBAP header + PDU)
+	static const int MaxAduSize = 260;
+
+	// Size of the pending transaction table. Must be a power of 2 and larger than the maximum
+	// in-flight window.
+	static const int PendingTableSize = 256;
+
+	// Number of transaction records allocated at once by the transaction pool
+	static const int SlabSize = 16;
+
+	class Reply;
+
+	/*!
+	 * A single request/response exchange. Records are taken from a pool owned by the client, so
+	 * sending a request does not allocate memory once the pool has grown large enough.
+	 */
+	class Transaction : public TimerWheel::Entry {
 	public:
-		Reply(quint16 transactionId, int timeout, QObject *parent = 0);
+		enum State {
+			Free,
+			Queued,
+			Sent
+		};
+
+		Transaction();
+
+		using TimerWheel::Entry::startTimeout;
+		using TimerWheel::Entry::stopTimeout;
 
-		quint16 transactionId() const
+		void appendByte(quint8 b)
 		{
-			return mTransactionId;
+			Q_ASSERT(frameSize < MaxAduSize);
+			frame[frameSize++] = b;
 		}
 
-		using ModbusReply::setResult;
+		void appendWord(quint16 w)
+		{
+			appendByte(msb(w));
+			appendByte(lsb(w));
+		}
 
-		bool isFinished() const override;
+		void onTimeout() override;
+
+		ModbusTcpClient *client;
+		ModbusCallback callback;
+		Reply *reply; // Set if the request was sent using the QObject API
+		const ModbusTcpChannel *owner; // Set if the request was sent through a channel
+		Transaction *nextFree;
+		quint16 transactionId;
+		quint8 function;
+		State state;
+		int timeout;
+		int frameSize;
+		quint8 frame[MaxAduSize];
+	};
+
+	/*!
+	 * Slab allocator for transaction records.
+	 */
+	class TransactionPool {
+	public:
+		TransactionPool();
+
+		~TransactionPool();
 
-		void timerEvent(QTimerEvent *event) override;
+		Transaction *allocate();
+
+		void release(Transaction *t);
+
+	private:
+		Q_DISABLE_COPY(TransactionPool)
+
+		QList<Transaction *> mSlabs;
+		Transaction *mFreeList;
+	};
+
+	/*!
+	 * Adapter for the QObject API.
+	 */
+	class Reply : public ModbusReply {
+	public:
+		Reply(Transaction *transaction, ModbusTcpClient *client, QObject *parent);
+
+		~Reply() override;
+
+		void setResult(ExceptionCode error, const RegisterSpan &registers);
+
+		/*!
+		 * Called when the transaction is released without a result (the client is being
+		 * destroyed).
+		 */
+		void detach()
+		{
+			mTransaction = 0;
+		}
+
+		bool isFinished() const override;
 
 	private:
 		void onFinished() override;
 
-		int mTimerId;
-		quint16 mTransactionId;
+		ModbusTcpClient *mClient;
+		Transaction *mTransaction;
+		bool mFinished;
 	};
 
-	ModbusReply *readRegisters(FunctionCode function, quint8 unitId, quint16 startReg,
-							   quint16 count);
+	Transaction *createTransaction(FunctionCode function, quint8 unitId, int pduSize);
+
+	Transaction *createReadRequest(FunctionCode function, quint8 unitId, quint16 startReg,
+								   quint16 count);
+
+	Transaction *createWriteSingleRequest(quint8 unitId, quint16 reg, quint16 value);
+
+	Transaction *createWriteMultipleRequest(quint8 unitId, quint16 startReg,
+											const QVector<quint16> &values);
+
+	/*!
+	 * Creates a request for one of the functions above. For `WriteSingleRegister` the value is
+	 * the first element of `values`, `count` is only used by the reads.
+	 */
+	Transaction *createRequest(int function, quint8 unitId, quint16 startReg, quint16 count,
+							   const QVector<quint16> &values);
+
+	void send(Transaction *t, const ModbusCallback &callback);
+
+	ModbusReply *sendWithReply(Transaction *t, QObject *parent);
+
+	void sendPending();
+
+	Transaction *pendingTransaction(quint16 transactionId) const;
+
+	Transaction *popTransaction(quint16 transactionId);
+
+	void complete(Transaction *t, ModbusReply::ExceptionCode error,
+				  const RegisterSpan &registers = RegisterSpan());
+
+	void cancel(Transaction *t);
+
+	/*!
+	 * Cancels all queued and pending requests sent through `owner`.
+	 */
+	void cancelTransactions(const ModbusTcpChannel *owner);
+
+	/*!
+	 * Completes all queued and pending requests with `TcpError`.
+	 */
+	void failTransactions();
+
+	void onTransactionTimeout(Transaction *t);
+
+	void onTimeout() override;
 
-	ModbusReply *sendFrame(const QByteArray &payload);
+	/*!
+	 * Called when the device appears to have mishandled concurrent transactions.
+	 */
+	void onConcurrencyError();
 
-	Reply *popReply(quint16 transactionId);
+	QString endpoint() const;
 
-	QByteArray createFrame(FunctionCode function, quint8 unitId, quint8 count);
+	void parseFrame(int length);
 
-	void setFinished(quint16 transactionId, const QVector<quint16> &values);
+	void setFinished(quint16 transactionId, int offset, int count);
 
-	void setFinished(quint16 transactionId, int error);
+	void setError(quint16 transactionId, int error);
 
-	QHash<quint16, Reply *> mPendingReplies;
-	QAbstractSocket *mSocket;
+	Transaction *mPending[PendingTableSize]; // Indexed by the lower bits of the transaction ID
+	int mPendingCount;
+	QList<Transaction *> mQueue;
+	TransactionPool mPool;
+	ModbusTcpTransport *mSocket;
 	int mTimeout;
-	int mConnectTimerId;
-	QByteArray mBuffer;
+	int mMaxInFlight;
+	int mWindow;
+	int mSuccessCount;
+	RingBuffer mBuffer;
 	QString mHostName;
 	quint16 mTcpPort;
 	quint16 mTransactionId;
+	quint16 mRegisters[ModbusReply::MaxRegisters]; // Decoded registers of the current frame
+	static QSet<QString> mSerialOnlyEndpoints; // Devices that mishandle concurrent transactions
+	static QHash<QString, int> mConcurrencyErrors; // Errors since the last connect, per endpoint
 };
 
 #endif // MODBUSTCPCLIENT_H
@@ -0,0 +1,391 @@
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QPointer>
+#include <QSocketNotifier>
+#include <QTcpSocket>
+#include <QThreadStorage>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "modbus_tcp_transport.h"
+
+ModbusTcpTransport::Backend ModbusTcpTransport::mDefaultBackend = ModbusTcpTransport::QtBackend;
+
+ModbusTcpTransport::ModbusTcpTransport(QObject *parent):
+	QObject(parent)
+{
+}
+
+ModbusTcpTransport *ModbusTcpTransport::create(QObject *parent)
+{
+	return create(mDefaultBackend, parent);
+}
+
+ModbusTcpTransport *ModbusTcpTransport::create(Backend backend, QObject *parent)
+{
+	if (backend == NativeBackend)
+		return new NativeTcpTransport(parent);
+	return new QtTcpTransport(parent);
+}
+
+QtTcpTransport::QtTcpTransport(QObject *parent):
+	ModbusTcpTransport(parent),
+	mSocket(new QTcpSocket(this))
+{
+	connect(mSocket, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+	connect(mSocket, SIGNAL(connected()), this, SLOT(onConnected()));
+	connect(mSocket, SIGNAL(disconnected()), this, SIGNAL(disconnected()));
+	connect(mSocket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)),
+			this, SIGNAL(errorOccurred(QAbstractSocket::SocketError)));
+}
+
+void QtTcpTransport::connectToHost(const QString &hostName, quint16 port)
+{
+	mSocket->connectToHost(hostName, port);
+}
+
+void QtTcpTransport::disconnectFromHost()
+{
+	mSocket->disconnectFromHost();
+}
+
+QAbstractSocket::SocketState QtTcpTransport::state() const
+{
+	return mSocket->state();
+}
+
+qint64 QtTcpTransport::read(char *data, qint64 maxSize)
+{
+	return mSocket->read(data, maxSize);
+}
+
+qint64 QtTcpTransport::write(const char *data, qint64 size)
+{
+	return mSocket->write(data, size);
+}
+
+void QtTcpTransport::onConnected()
+{
+	// Socket options are ignored by QAbstractSocket until the native socket has been created,
+	// so this cannot be done in the constructor.
+	mSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+	emit connected();
+}
+
+static QAbstractSocket::SocketError toSocketError(int error)
+{
+	switch (error) {
+	case ECONNREFUSED:
+		return QAbstractSocket::ConnectionRefusedError;
+	case ETIMEDOUT:
+		return QAbstractSocket::SocketTimeoutError;
+	case EHOSTUNREACH:
+	case ENETUNREACH:
+	case ENETDOWN:
+		return QAbstractSocket::NetworkError;
+	case ECONNRESET:
+	case EPIPE:
+		return QAbstractSocket::RemoteHostClosedError;
+	default:
+		return QAbstractSocket::UnknownSocketError;
+	}
+}
+
+NativeTcpTransport::NativeTcpTransport(QObject *parent):
+	ModbusTcpTransport(parent),
+	mFd(-1),
+	mId(0),
+	mPort(0),
+	mLookupId(-1),
+	mState(QAbstractSocket::UnconnectedState),
+	mReadFailed(false),
+	mDeferredError(QAbstractSocket::UnknownSocketError)
+{
+}
+
+NativeTcpTransport::~NativeTcpTransport()
+{
+	close();
+}
+
+void NativeTcpTransport::connectToHost(const QString &hostName, quint16 port)
+{
+	close();
+	mPort = port;
+	QHostAddress address;
+	if (address.setAddress(hostName)) {
+		connectToAddress(address);
+		return;
+	}
+	mState = QAbstractSocket::HostLookupState;
+	mLookupId = QHostInfo::lookupHost(hostName, this, SLOT(onHostFound(QHostInfo)));
+}
+
+void NativeTcpTransport::disconnectFromHost()
+{
+	bool wasConnected = mState == QAbstractSocket::ConnectedState;
+	close();
+	if (wasConnected)
+		emit disconnected();
+}
+
+QAbstractSocket::SocketState NativeTcpTransport::state() const
+{
+	return mState;
+}
+
+qint64 NativeTcpTransport::read(char *data, qint64 maxSize)
+{
+	if (mFd < 0 || mReadFailed)
+		return -1;
+	for (;;) {
+		ssize_t n = ::recv(mFd, data, static_cast<size_t>(maxSize), 0);
+		if (n > 0)
+			return n;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		// Connection closed by the peer (n == 0) or reset. This is reported by `onEvents` once
+		// the client has handled the data received before.
+		mReadFailed = true;
+		return -1;
+	}
+}
+
+qint64 NativeTcpTransport::write(const char *data, qint64 size)
+{
+	if (mState == QAbstractSocket::UnconnectedState)
+		return -1;
+	qint64 sent = 0;
+	if (mState == QAbstractSocket::ConnectedState && mWriteBuffer.isEmpty()) {
+		// Errors other than EAGAIN are reported by epoll as well, so they are handled in
+		// `onEvents`.
+		ssize_t n = ::send(mFd, data, static_cast<size_t>(size), MSG_NOSIGNAL);
+		if (n > 0)
+			sent = n;
+	}
+	// Like QAbstractSocket, data written while the connection is being set up is sent once it
+	// has been established.
+	if (sent < size)
+		mWriteBuffer.append(data + sent, static_cast<int>(size - sent));
+	return size;
+}
+
+void NativeTcpTransport::onHostFound(const QHostInfo &info)
+{
+	mLookupId = -1;
+	if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+		setError(QAbstractSocket::HostNotFoundError);
+		return;
+	}
+	connectToAddress(info.addresses().first());
+}
+
+void NativeTcpTransport::connectToAddress(const QHostAddress &address)
+{
+	sockaddr_storage storage;
+	memset(&storage, 0, sizeof(storage));
+	socklen_t size = 0;
+	if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+		sockaddr_in6 *addr = reinterpret_cast<sockaddr_in6 *>(&storage);
+		addr->sin6_family = AF_INET6;
+		addr->sin6_port = htons(mPort);
+		Q_IPV6ADDR ip = address.toIPv6Address();
+		memcpy(&addr->sin6_addr, &ip, sizeof(ip));
+		size = sizeof(sockaddr_in6);
+	} else {
+		sockaddr_in *addr = reinterpret_cast<sockaddr_in *>(&storage);
+		addr->sin_family = AF_INET;
+		addr->sin_port = htons(mPort);
+		addr->sin_addr.s_addr = htonl(address.toIPv4Address());
+		size = sizeof(sockaddr_in);
+	}
+	mFd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (mFd < 0) {
+		setDeferredError(QAbstractSocket::SocketResourceError);
+		return;
+	}
+	int one = 1;
+	::setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	// Connect before the socket is added to the epoll set: an unconnected socket is reported as
+	// hung up.
+	if (::connect(mFd, reinterpret_cast<sockaddr *>(&storage), size) < 0 &&
+		errno != EINPROGRESS) {
+		setDeferredError(toSocketError(errno));
+		return;
+	}
+	mState = QAbstractSocket::ConnectingState;
+	// The connection is established when the socket becomes writable. If that happened already,
+	// epoll reports it as soon as the socket has been added.
+	if (!EpollPoller::instance()->add(this))
+		setDeferredError(QAbstractSocket::SocketResourceError);
+}
+
+void NativeTcpTransport::onEvents(quint32 events)
+{
+	QPointer<NativeTcpTransport> self(this);
+	if (mState == QAbstractSocket::ConnectingState) {
+		if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) == 0)
+			return;
+		int error = 0;
+		socklen_t size = sizeof(error);
+		if (::getsockopt(mFd, SOL_SOCKET, SO_ERROR, &error, &size) < 0)
+			error = errno;
+		if (error != 0) {
+			setError(toSocketError(error));
+			return;
+		}
+		mState = QAbstractSocket::ConnectedState;
+		emit connected();
+		if (self.isNull() || mState != QAbstractSocket::ConnectedState)
+			return;
+	}
+	if (mState != QAbstractSocket::ConnectedState)
+		return;
+	if ((events & EPOLLOUT) != 0 && !flush()) {
+		setError(toSocketError(errno));
+		return;
+	}
+	if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0) {
+		// Edge triggered: the client reads until no more data is available.
+		emit readyRead();
+		if (self.isNull() || mState != QAbstractSocket::ConnectedState)
+			return;
+	}
+	if (mReadFailed || (events & (EPOLLHUP | EPOLLERR)) != 0) {
+		int error = 0;
+		socklen_t size = sizeof(error);
+		::getsockopt(mFd, SOL_SOCKET, SO_ERROR, &error, &size);
+		setError(error == 0 ? QAbstractSocket::RemoteHostClosedError : toSocketError(error));
+	}
+}
+
+bool NativeTcpTransport::flush()
+{
+	while (!mWriteBuffer.isEmpty()) {
+		ssize_t n = ::send(mFd, mWriteBuffer.constData(), static_cast<size_t>(mWriteBuffer.size()),
+						   MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		mWriteBuffer.remove(0, static_cast<int>(n));
+	}
+	return true;
+}
+
+void NativeTcpTransport::close()
+{
+	if (mLookupId >= 0) {
+		QHostInfo::abortHostLookup(mLookupId);
+		mLookupId = -1;
+	}
+	if (mFd >= 0) {
+		if (mId != 0)
+			EpollPoller::instance()->remove(this);
+		::close(mFd);
+		mFd = -1;
+	}
+	mState = QAbstractSocket::UnconnectedState;
+	mReadFailed = false;
+	mWriteBuffer.clear();
+}
+
+void NativeTcpTransport::setError(QAbstractSocket::SocketError error)
+{
+	bool wasConnected = mState == QAbstractSocket::ConnectedState;
+	close();
+	// Same order as QAbstractSocket: the error first, then the state change.
+	QPointer<NativeTcpTransport> self(this);
+	emit errorOccurred(error);
+	if (wasConnected && !self.isNull())
+		emit disconnected();
+}
+
+void NativeTcpTransport::setDeferredError(QAbstractSocket::SocketError error)
+{
+	close();
+	mDeferredError = error;
+	QMetaObject::invokeMethod(this, "onDeferredError", Qt::QueuedConnection);
+}
+
+void NativeTcpTransport::onDeferredError()
+{
+	emit errorOccurred(mDeferredError);
+}
+
+EpollPoller::EpollPoller(QObject *parent):
+	QObject(parent),
+	mFd(epoll_create1(EPOLL_CLOEXEC)),
+	mNotifier(0),
+	mLastId(0)
+{
+	if (mFd < 0) {
+		qWarning() << "Could not create epoll set:" << strerror(errno);
+		return;
+	}
+	mNotifier = new QSocketNotifier(mFd, QSocketNotifier::Read, this);
+	connect(mNotifier, SIGNAL(activated(QSocketDescriptor, QSocketNotifier::Type)),
+			this, SLOT(onActivated()));
+}
+
+EpollPoller::~EpollPoller()
+{
+	if (mFd >= 0)
+		::close(mFd);
+}
+
+EpollPoller *EpollPoller::instance()
+{
+	static QThreadStorage<EpollPoller *> pollers;
+	if (!pollers.hasLocalData())
+		pollers.setLocalData(new EpollPoller());
+	return pollers.localData();
+}
+
+bool EpollPoller::add(NativeTcpTransport *transport)
+{
+	if (mFd < 0)
+		return false;
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.u64 = ++mLastId;
+	if (epoll_ctl(mFd, EPOLL_CTL_ADD, transport->mFd, &event) < 0)
+		return false;
+	transport->mId = mLastId;
+	mTransports.insert(mLastId, transport);
+	return true;
+}
+
+void EpollPoller::remove(NativeTcpTransport *transport)
+{
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	epoll_ctl(mFd, EPOLL_CTL_DEL, transport->mFd, &event);
+	mTransports.remove(transport->mId);
+	transport->mId = 0;
+}
+
+void EpollPoller::onActivated()
+{
+	epoll_event events[MaxEvents];
+	for (;;) {
+		int n = epoll_wait(mFd, events, MaxEvents, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		for (int i=0; i<n; ++i) {
+			NativeTcpTransport *transport = mTransports.value(events[i].data.u64);
+			if (transport != 0)
+				transport->onEvents(events[i].events);
+		}
+		if (n < MaxEvents)
+			break;
+	}
+}
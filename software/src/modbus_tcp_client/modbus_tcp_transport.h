@@ -0,0 +1,198 @@
+#ifndef MODBUS_TCP_TRANSPORT_H
+#define MODBUS_TCP_TRANSPORT_H
+
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+
+class QHostAddress;
+class QHostInfo;
+class QSocketNotifier;
+class QTcpSocket;
+
+/*!
+ * Byte stream used by `ModbusTcpClient` to talk to a device.
+ *
+ * There are two backends:
+ * - `QtBackend` uses a `QTcpSocket`.
+ * - `NativeBackend` uses a non-blocking socket, watched by an edge-triggered epoll set. There is
+ *   one epoll set per thread, which is watched by a single `QSocketNotifier`. This avoids the
+ *   overhead of the `QAbstractSocket` state machine and its internal buffering, which becomes
+ *   noticeable when a lot of connections are opened at the same time (eg. while scanning the
+ *   network for devices).
+ *
+ * The signals have the same meaning as those of `QAbstractSocket`.
+ */
+class ModbusTcpTransport : public QObject
+{
+	Q_OBJECT
+public:
+	enum Backend {
+		QtBackend,
+		NativeBackend
+	};
+
+	/*!
+	 * Creates a transport using the default backend.
+	 */
+	static ModbusTcpTransport *create(QObject *parent = 0);
+
+	static ModbusTcpTransport *create(Backend backend, QObject *parent = 0);
+
+	static Backend defaultBackend()
+	{
+		return mDefaultBackend;
+	}
+
+	/*!
+	 * Sets the backend used by `create`. Should be called before any transport has been
+	 * created.
+	 */
+	static void setDefaultBackend(Backend backend)
+	{
+		mDefaultBackend = backend;
+	}
+
+	virtual void connectToHost(const QString &hostName, quint16 port) = 0;
+
+	virtual void disconnectFromHost() = 0;
+
+	virtual QAbstractSocket::SocketState state() const = 0;
+
+	/*!
+	 * Reads at most `maxSize` bytes.
+	 * @returns The number of bytes read (0 if no data is available), or -1 on error.
+	 */
+	virtual qint64 read(char *data, qint64 maxSize) = 0;
+
+	virtual qint64 write(const char *data, qint64 size) = 0;
+
+signals:
+	void connected();
+
+	void disconnected();
+
+	void readyRead();
+
+	void errorOccurred(QAbstractSocket::SocketError error);
+
+protected:
+	explicit ModbusTcpTransport(QObject *parent = 0);
+
+private:
+	static Backend mDefaultBackend;
+};
+
+class QtTcpTransport : public ModbusTcpTransport
+{
+	Q_OBJECT
+public:
+	explicit QtTcpTransport(QObject *parent = 0);
+
+	void connectToHost(const QString &hostName, quint16 port) override;
+
+	void disconnectFromHost() override;
+
+	QAbstractSocket::SocketState state() const override;
+
+	qint64 read(char *data, qint64 maxSize) override;
+
+	qint64 write(const char *data, qint64 size) override;
+
+private slots:
+	void onConnected();
+
+private:
+	QTcpSocket *mSocket;
+};
+
+class EpollPoller;
+
+class NativeTcpTransport : public ModbusTcpTransport
+{
+	Q_OBJECT
+public:
+	explicit NativeTcpTransport(QObject *parent = 0);
+
+	~NativeTcpTransport() override;
+
+	void connectToHost(const QString &hostName, quint16 port) override;
+
+	void disconnectFromHost() override;
+
+	QAbstractSocket::SocketState state() const override;
+
+	qint64 read(char *data, qint64 maxSize) override;
+
+	qint64 write(const char *data, qint64 size) override;
+
+private slots:
+	void onHostFound(const QHostInfo &info);
+
+	void onDeferredError();
+
+private:
+	friend class EpollPoller;
+
+	void connectToAddress(const QHostAddress &address);
+
+	/*!
+	 * Called by the poller with the events reported by `epoll_wait`.
+	 */
+	void onEvents(quint32 events);
+
+	bool flush();
+
+	void close();
+
+	void setError(QAbstractSocket::SocketError error);
+
+	/*!
+	 * Reports an error from the event loop. Used for errors detected while `connectToHost` is
+	 * being called, because QAbstractSocket does not report those synchronously either.
+	 */
+	void setDeferredError(QAbstractSocket::SocketError error);
+
+	int mFd;
+	quint64 mId; // Key of this transport in the poller
+	quint16 mPort;
+	int mLookupId;
+	QAbstractSocket::SocketState mState;
+	bool mReadFailed; // Set if the connection has been closed or reset while reading
+	QAbstractSocket::SocketError mDeferredError;
+	QByteArray mWriteBuffer; // Data that could not be sent immediately
+};
+
+/*!
+ * Epoll set of the current thread, shared by all `NativeTcpTransport` objects in the thread.
+ */
+class EpollPoller : public QObject
+{
+	Q_OBJECT
+public:
+	static const int MaxEvents = 64;
+
+	~EpollPoller() override;
+
+	static EpollPoller *instance();
+
+	bool add(NativeTcpTransport *transport);
+
+	void remove(NativeTcpTransport *transport);
+
+private slots:
+	void onActivated();
+
+private:
+	explicit EpollPoller(QObject *parent = 0);
+
+	int mFd;
+	QSocketNotifier *mNotifier;
+	quint64 mLastId;
+	// Transports are looked up by ID, because a transport may be deleted (and its file
+	// descriptor reused) while the events of a single epoll_wait call are being processed.
+	QHash<quint64, NativeTcpTransport *> mTransports;
+};
+
+#endif // MODBUS_TCP_TRANSPORT_H
@@ -0,0 +1,114 @@
+#ifndef REGISTER_SPAN_H
+#define REGISTER_SPAN_H
+
+#include <QDebug>
+#include <QVector>
+
+/*!
+ * Read-only view on a sequence of modbus registers.
+ *
+ * The span does not own the registers. It is only valid as long as the storage it refers to,
+ * which is usually the `ModbusReply` it was obtained from. A span may be created implicitly from
+ * a `QVector<quint16>`, so functions taking a span also accept vectors.
+ */
+class RegisterSpan
+{
+public:
+	RegisterSpan():
+		mData(0),
+		mSize(0)
+	{
+	}
+
+	RegisterSpan(const quint16 *data, int size):
+		mData(data),
+		mSize(size)
+	{
+	}
+
+	RegisterSpan(const QVector<quint16> &values):
+		mData(values.constData()),
+		mSize(values.size())
+	{
+	}
+
+	const quint16 *data() const
+	{
+		return mData;
+	}
+
+	int size() const
+	{
+		return mSize;
+	}
+
+	bool isEmpty() const
+	{
+		return mSize == 0;
+	}
+
+	const quint16 *begin() const
+	{
+		return mData;
+	}
+
+	const quint16 *end() const
+	{
+		return mData + mSize;
+	}
+
+	quint16 operator[](int i) const
+	{
+		Q_ASSERT(i >= 0 && i < mSize);
+		return mData[i];
+	}
+
+	/*!
+	 * Returns a span on a part of this span. Like `QVector::mid`, the result is truncated if
+	 * it would extend beyond the end of this span. If `count` is -1, all registers starting at
+	 * `pos` are returned.
+	 */
+	RegisterSpan mid(int pos, int count = -1) const
+	{
+		if (pos < 0 || pos >= mSize)
+			return RegisterSpan();
+		if (count < 0 || pos + count > mSize)
+			count = mSize - pos;
+		return RegisterSpan(mData + pos, count);
+	}
+
+	QVector<quint16> toVector() const
+	{
+		QVector<quint16> result(mSize);
+		for (int i=0; i<mSize; ++i)
+			result[i] = mData[i];
+		return result;
+	}
+
+	bool operator==(const RegisterSpan &other) const
+	{
+		if (mSize != other.mSize)
+			return false;
+		for (int i=0; i<mSize; ++i) {
+			if (mData[i] != other.mData[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool operator!=(const RegisterSpan &other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	const quint16 *mData;
+	int mSize;
+};
+
+inline QDebug operator<<(QDebug str, const RegisterSpan &values)
+{
+	return str << values.toVector();
+}
+
+#endif // REGISTER_SPAN_H
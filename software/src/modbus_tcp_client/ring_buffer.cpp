@@ -0,0 +1,18 @@
+#include "ring_buffer.h"
+
+RingBuffer::RingBuffer():
+	mRead(0),
+	mWrite(0)
+{
+}
+
+void RingBuffer::skip(int count)
+{
+	Q_ASSERT(count >= 0 && count <= size());
+	mRead += static_cast<unsigned int>(count);
+	if (mRead == mWrite) {
+		// Keep frames contiguous in mData where possible
+		mRead = 0;
+		mWrite = 0;
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <QtGlobal>
+
+/*!
+ * Fixed size byte buffer used to collect incoming modbus frames.
+ *
+ * Data is appended at the write cursor and consumed at the read cursor. Consuming a frame only
+ * moves the read cursor, so unlike `QByteArray::remove` no data is shifted and no memory is
+ * allocated after construction.
+ */
+class RingBuffer
+{
+public:
+	// Must be a power of 2
+	static const int Capacity = 4096;
+
+	RingBuffer();
+
+	int size() const
+	{
+		return static_cast<int>(mWrite - mRead);
+	}
+
+	int freeSpace() const
+	{
+		return Capacity - size();
+	}
+
+	/*!
+	 * Returns the byte at `offset`, relative to the read cursor.
+	 */
+	quint8 at(int offset) const
+	{
+		Q_ASSERT(offset >= 0 && offset < size());
+		return mData[(mRead + offset) & (Capacity - 1)];
+	}
+
+	/*!
+	 * Returns the big endian 16 bit value at `offset`, relative to the read cursor.
+	 */
+	quint16 toUInt16(int offset) const
+	{
+		return static_cast<quint16>((at(offset) << 8) | at(offset + 1));
+	}
+
+	/*!
+	 * Reads as much data from `device` as fits into the free space of the buffer. `device` may
+	 * be a `QIODevice` or a `ModbusTcpTransport`: anything with a `read(char *, qint64)` that
+	 * returns the number of bytes read, or -1 on error.
+	 * @returns The number of bytes read, or -1 on error.
+	 */
+	template<class Device>
+	qint64 readFrom(Device *device)
+	{
+		qint64 total = 0;
+		// The free space may be split in two parts: from the write cursor to the end of mData,
+		// and from the start of mData to the read cursor.
+		while (freeSpace() > 0) {
+			unsigned int start = mWrite & (Capacity - 1);
+			int count = qMin(freeSpace(), static_cast<int>(Capacity - start));
+			qint64 n = device->read(reinterpret_cast<char *>(mData + start), count);
+			if (n < 0)
+				return total > 0 ? total : -1;
+			mWrite += static_cast<unsigned int>(n);
+			total += n;
+			if (n < count)
+				break;
+		}
+		return total;
+	}
+
+	/*!
+	 * Moves the read cursor `count` bytes forward.
+	 */
+	void skip(int count);
+
+	void clear()
+	{
+		mRead = 0;
+		mWrite = 0;
+	}
+
+private:
+	// The cursors are not wrapped, only their position in mData is. Since Capacity is a power of
+	// 2, this remains correct when the cursors overflow.
+	quint8 mData[Capacity];
+	unsigned int mRead;
+	unsigned int mWrite;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,62 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <QAtomicInt>
+
+/*!
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * `push` is only called by the producer, `pop` only by the consumer. The head is only written
+ * by the consumer and the tail only by the producer, so no locks or compare-and-swap loops are
+ * needed. One slot is always kept empty to tell a full queue from an empty one.
+ */
+template<typename T, int Capacity>
+class SpscQueue
+{
+	Q_STATIC_ASSERT((Capacity & (Capacity - 1)) == 0);
+
+public:
+	SpscQueue():
+		mHead(0),
+		mTail(0)
+	{
+	}
+
+	/*!
+	 * Returns false if the queue is full.
+	 */
+	bool push(const T &value)
+	{
+		int tail = mTail.loadRelaxed();
+		int next = (tail + 1) & (Capacity - 1);
+		if (next == mHead.loadAcquire())
+			return false;
+		mItems[tail] = value;
+		mTail.storeRelease(next);
+		return true;
+	}
+
+	/*!
+	 * Returns false if the queue is empty.
+	 */
+	bool pop(T &value)
+	{
+		int head = mHead.loadRelaxed();
+		if (head == mTail.loadAcquire())
+			return false;
+		value = mItems[head];
+		// Drop the reference to any shared data now, instead of when the slot is reused.
+		mItems[head] = T();
+		mHead.storeRelease((head + 1) & (Capacity - 1));
+		return true;
+	}
+
+private:
+	Q_DISABLE_COPY(SpscQueue)
+
+	T mItems[Capacity];
+	QAtomicInt mHead;
+	QAtomicInt mTail;
+};
+
+#endif // SPSC_QUEUE_H
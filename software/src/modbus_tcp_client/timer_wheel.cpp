@@ -0,0 +1,114 @@
+#include <QThreadStorage>
+#include <QTimer>
+#include "timer_wheel.h"
+
+TimerWheel::Entry::Entry():
+	mWheel(0),
+	mDeadline(0)
+{
+}
+
+TimerWheel::Entry::~Entry()
+{
+	stopTimeout();
+}
+
+void TimerWheel::Entry::startTimeout(int timeout)
+{
+	stopTimeout();
+	TimerWheel::instance()->schedule(this, timeout);
+}
+
+void TimerWheel::Entry::stopTimeout()
+{
+	if (mWheel != 0)
+		mWheel->cancel(this);
+}
+
+TimerWheel::TimerWheel(QObject *parent):
+	QObject(parent),
+	mTimer(new QTimer(this)),
+	mCurrentTick(0),
+	mCount(0)
+{
+	for (int i=0; i<SlotCount; ++i)
+		mSlots[i].mNext = mSlots[i].mPrev = &mSlots[i];
+	mTimer->setInterval(TickInterval);
+	connect(mTimer, SIGNAL(timeout()), this, SLOT(onTick()));
+	mClock.start();
+}
+
+TimerWheel *TimerWheel::instance()
+{
+	static QThreadStorage<TimerWheel *> wheels;
+	if (!wheels.hasLocalData())
+		wheels.setLocalData(new TimerWheel());
+	return wheels.localData();
+}
+
+void TimerWheel::schedule(Entry *entry, int timeout)
+{
+	Q_ASSERT(entry->mWheel == 0);
+	quint64 now = static_cast<quint64>(mClock.elapsed()) / TickInterval;
+	if (mCount == 0) {
+		mCurrentTick = now;
+		mTimer->start();
+	}
+	// Round up, and add one tick because we may be anywhere within the current tick.
+	entry->mDeadline = now + static_cast<quint64>(qMax(0, timeout) + TickInterval - 1) / TickInterval + 1;
+	entry->mWheel = this;
+	link(&mSlots[entry->mDeadline & (SlotCount - 1)], entry);
+	++mCount;
+}
+
+void TimerWheel::cancel(Entry *entry)
+{
+	Q_ASSERT(entry->mWheel == this);
+	unlink(entry);
+	entry->mWheel = 0;
+	--mCount;
+	if (mCount == 0)
+		mTimer->stop();
+}
+
+void TimerWheel::onTick()
+{
+	quint64 now = static_cast<quint64>(mClock.elapsed()) / TickInterval;
+	while (mCurrentTick < now && mCount > 0) {
+		++mCurrentTick;
+		// Move expired entries to a separate list first, because the callbacks may schedule or
+		// cancel other entries.
+		Node expired;
+		expired.mNext = expired.mPrev = &expired;
+		Node *slot = &mSlots[mCurrentTick & (SlotCount - 1)];
+		for (Node *node = slot->mNext; node != slot;) {
+			Node *next = node->mNext;
+			if (static_cast<Entry *>(node)->mDeadline <= mCurrentTick) {
+				unlink(node);
+				link(&expired, node);
+			}
+			node = next;
+		}
+		while (expired.mNext != &expired) {
+			Entry *entry = static_cast<Entry *>(expired.mNext);
+			cancel(entry);
+			entry->onTimeout();
+		}
+	}
+}
+
+void TimerWheel::link(Node *list, Node *node)
+{
+	node->mPrev = list->mPrev;
+	node->mNext = list;
+	list->mPrev->mNext = node;
+	list->mPrev = node;
+}
+
+void TimerWheel::unlink(Node *node)
+{
+	node->mPrev->mNext = node->mNext;
+	node->mNext->mPrev = node->mPrev;
+	node->mNext = 0;
+	node->mPrev = 0;
+}
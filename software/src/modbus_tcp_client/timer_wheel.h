@@ -0,0 +1,108 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <QElapsedTimer>
+#include <QObject>
+
+class QTimer;
+
+/*!
+ * Hashed timer wheel, used for the timeouts of modbus transactions.
+ *
+ * There is one wheel per thread. All timeouts in a thread share a single `QTimer`, which only
+ * runs while at least one timeout is scheduled. Timeouts are rounded up to a multiple of
+ * `TickInterval`, which is good enough for modbus timeouts (typically 1 second or more).
+ *
+ * Scheduling and cancelling a timeout is O(1) and does not allocate memory: the bookkeeping is
+ * stored in the `Entry` objects themselves.
+ */
+class TimerWheel : public QObject
+{
+	Q_OBJECT
+public:
+	class Node
+	{
+	public:
+		Node():
+			mNext(0),
+			mPrev(0)
+		{
+		}
+
+	private:
+		friend class TimerWheel;
+
+		Node *mNext;
+		Node *mPrev;
+	};
+
+	/*!
+	 * Base class for objects with a timeout. The timeout is cancelled automatically when the
+	 * entry is destroyed.
+	 */
+	class Entry : private Node
+	{
+	public:
+		Entry();
+
+		virtual ~Entry();
+
+		bool isTimeoutActive() const
+		{
+			return mWheel != 0;
+		}
+
+	protected:
+		/*!
+		 * Schedules `onTimeout` to be called after `timeout` milliseconds. Cancels a timeout
+		 * scheduled earlier.
+		 */
+		void startTimeout(int timeout);
+
+		void stopTimeout();
+
+		virtual void onTimeout() = 0;
+
+	private:
+		friend class TimerWheel;
+
+		TimerWheel *mWheel;
+		quint64 mDeadline;
+	};
+
+	static const int TickInterval = 100; // ms
+
+	static const int SlotCount = 64; // Must be a power of 2
+
+	/*!
+	 * Returns the timer wheel of the current thread.
+	 */
+	static TimerWheel *instance();
+
+	int count() const
+	{
+		return mCount;
+	}
+
+private slots:
+	void onTick();
+
+private:
+	explicit TimerWheel(QObject *parent = 0);
+
+	void schedule(Entry *entry, int timeout);
+
+	void cancel(Entry *entry);
+
+	static void link(Node *list, Node *node);
+
+	static void unlink(Node *node);
+
+	Node mSlots[SlotCount];
+	QTimer *mTimer;
+	QElapsedTimer mClock;
+	quint64 mCurrentTick;
+	int mCount;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,72 @@
+#include <QFile>
+#include <QStringList>
+#include <QTimer>
+#include <QUdpSocket>
+#include "neighbour_table.h"
+
+// Set in the flags column of /proc/net/arp if the MAC address has been resolved
+static const int ArpComplete = 0x02;
+
+QHash<QHostAddress, QString> NeighbourTable::read()
+{
+	QHash<QHostAddress, QString> result;
+	QFile file("/proc/net/arp");
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return result;
+	// Format: IP address, HW type, Flags, HW address, Mask, Device. The first line is a header.
+	file.readLine();
+	for (;;) {
+		QByteArray line = file.readLine();
+		if (line.isEmpty())
+			break;
+		QList<QByteArray> fields = line.simplified().split(' ');
+		if (fields.size() < 4)
+			continue;
+		bool ok = false;
+		int flags = fields[2].toInt(&ok, 16);
+		if (!ok || (flags & ArpComplete) == 0 || fields[3] == "00:00:00:00:00:00")
+			continue;
+		QHostAddress address;
+		if (address.setAddress(QString::fromLatin1(fields[0])))
+			result.insert(address, QString::fromLatin1(fields[3]));
+	}
+	return result;
+}
+
+ArpWarmUp::ArpWarmUp(QObject *parent):
+	QObject(parent),
+	mIndex(0),
+	mSocket(0),
+	mTimer(new QTimer(this))
+{
+	mTimer->setInterval(BatchInterval);
+	connect(mTimer, SIGNAL(timeout()), this, SLOT(sendBatch()));
+}
+
+void ArpWarmUp::start(const QList<QHostAddress> &addresses)
+{
+	if (addresses.size() > MaxAddresses) {
+		qInfo() << "Subnets too large, skipping ARP warm-up";
+		return;
+	}
+	if (mSocket == 0)
+		mSocket = new QUdpSocket(this);
+	mAddresses = addresses;
+	mIndex = 0;
+	mTimer->start();
+	sendBatch();
+}
+
+void ArpWarmUp::sendBatch()
+{
+	if (mIndex >= mAddresses.size()) {
+		mTimer->stop();
+		mAddresses.clear();
+		mIndex = 0;
+		emit finished();
+		return;
+	}
+	int end = qMin(mIndex + BatchSize, static_cast<int>(mAddresses.size()));
+	for (; mIndex < end; ++mIndex)
+		mSocket->writeDatagram(QByteArray(), mAddresses[mIndex], DiscardPort);
+}
@@ -0,0 +1,70 @@
+#ifndef NEIGHBOUR_TABLE_H
+#define NEIGHBOUR_TABLE_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+
+class QTimer;
+class QUdpSocket;
+
+/*!
+ * Access to the IPv4 neighbour (ARP) table of the kernel.
+ */
+class NeighbourTable
+{
+public:
+	/*!
+	 * Returns the addresses of the hosts with a complete ARP entry, ie. hosts that have been seen
+	 * on the network recently, with their MAC address.
+	 */
+	static QHash<QHostAddress, QString> read();
+};
+
+/*!
+ * Fills the neighbour table, by sending an empty UDP datagram (to the discard port) to each
+ * address. The datagrams themselves are not important: sending them makes the kernel resolve the
+ * MAC address of each host.
+ *
+ * Every address without a host creates an incomplete neighbour entry, which lives until the
+ * kernel gives up resolving it (3 ARP requests, one per second by default). The datagrams are
+ * sent in small batches, one batch per ARP retransmit interval, so there are never more than
+ * about 3 * `BatchSize` incomplete entries. That is well below the size of the neighbour table
+ * (gc_thresh3 is 1024 by default), so no entries of live hosts are pushed out. Larger subnets
+ * are not warmed up at all, because that would take too long at this rate.
+ *
+ * Live hosts answer the first ARP request, so they are in the neighbour table one batch interval
+ * after their datagram has been sent. `finished` is emitted at that time for the last batch.
+ */
+class ArpWarmUp : public QObject
+{
+	Q_OBJECT
+public:
+	static const quint16 DiscardPort = 9;
+	static const int BatchSize = 64;
+	static const int BatchInterval = 1000; // ms, the default ARP retransmit time
+	static const int MaxAddresses = 1024;
+
+	explicit ArpWarmUp(QObject *parent = 0);
+
+	/*!
+	 * Starts sending datagrams to `addresses`. Does nothing if there are more than
+	 * `MaxAddresses`.
+	 */
+	void start(const QList<QHostAddress> &addresses);
+
+signals:
+	void finished();
+
+private slots:
+	void sendBatch();
+
+private:
+	QList<QHostAddress> mAddresses;
+	int mIndex;
+	QUdpSocket *mSocket;
+	QTimer *mTimer;
+};
+
+#endif // NEIGHBOUR_TABLE_H
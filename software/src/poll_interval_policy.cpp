@@ -0,0 +1,55 @@
+#include <qnumeric.h>
+#include <QtGlobal>
+#include "poll_interval_policy.h"
+
+// Relative power change per cycle (of the maximum power) above which the power is considered to
+// be fluctuating.
+static const double FluctuationThreshold = 0.02;
+
+// Weight of the latest sample in the moving average of the power variation.
+static const double VariationWeight = 0.3;
+
+PollIntervalPolicy::PollIntervalPolicy():
+	mDeviceState(DeviceUnknown),
+	mFastModeEnabled(false),
+	mLimiterHoldTime(LimiterHoldTime),
+	mLastPower(qQNaN()),
+	mVariation(0)
+{
+}
+
+void PollIntervalPolicy::onPowerLimitRequested()
+{
+	mLimiterClock.start();
+}
+
+void PollIntervalPolicy::addPowerSample(double power, double maxPower)
+{
+	if (!qIsFinite(power) || !qIsFinite(maxPower) || maxPower <= 0) {
+		mLastPower = qQNaN();
+		return;
+	}
+	if (qIsFinite(mLastPower)) {
+		double change = qAbs(power - mLastPower) / maxPower;
+		mVariation = VariationWeight * change + (1 - VariationWeight) * mVariation;
+	}
+	mLastPower = power;
+}
+
+bool PollIntervalPolicy::isLimiterActive() const
+{
+	return mLimiterClock.isValid() && mLimiterClock.elapsed() < mLimiterHoldTime;
+}
+
+int PollIntervalPolicy::interval() const
+{
+	if (isFastMode())
+		return FastModeInterval;
+	if (isLimiterActive() || mDeviceState == DeviceThrottled)
+		return FastInterval;
+	if (mDeviceState == DeviceSleeping)
+		return SleepInterval;
+	if (mVariation > FluctuationThreshold)
+		return FluctuatingInterval;
+	return NormalInterval;
+}
@@ -0,0 +1,89 @@
+#ifndef POLL_INTERVAL_POLICY_H
+#define POLL_INTERVAL_POLICY_H
+
+#include <QElapsedTimer>
+
+/*!
+ * Chooses the time between two poll cycles of an inverter.
+ *
+ * The interval depends on what the inverter is doing:
+ * - While a power limit is being controlled (the limit was changed recently, or the inverter
+ *   reports that it is throttling) we poll fast, so the control loop sees the effect of the
+ *   limit as soon as possible.
+ * - While the inverter is sleeping or in standby (typically at night) we poll slowly.
+ * - Otherwise we poll at the normal rate, or a bit faster if the power has been fluctuating
+ *   during the last few cycles.
+ *
+ * If fast mode is enabled, the interval drops to `FastModeInterval` while the limiter is active.
+ * Fast mode switches itself off again when no power limit has been requested for
+ * `limiterHoldTime` milliseconds.
+ */
+class PollIntervalPolicy
+{
+public:
+	enum DeviceState {
+		DeviceUnknown,
+		DeviceProducing,
+		DeviceSleeping,
+		DeviceThrottled
+	};
+
+	static const int FastModeInterval = 200; // ms
+	static const int FastInterval = 250; // ms
+	static const int FluctuatingInterval = 500; // ms
+	static const int NormalInterval = 1000; // ms
+	static const int SleepInterval = 10000; // ms
+
+	// Default time after the last power limit request during which the limiter is considered
+	// active
+	static const int LimiterHoldTime = 10000; // ms
+
+	PollIntervalPolicy();
+
+	void setDeviceState(DeviceState state)
+	{
+		mDeviceState = state;
+	}
+
+	void setFastModeEnabled(bool enabled)
+	{
+		mFastModeEnabled = enabled;
+	}
+
+	void setLimiterHoldTime(int holdTime)
+	{
+		mLimiterHoldTime = holdTime;
+	}
+
+	/*!
+	 * Returns true if fast mode is enabled and the limiter is active.
+	 */
+	bool isFastMode() const
+	{
+		return mFastModeEnabled && isLimiterActive();
+	}
+
+	bool isLimiterActive() const;
+
+	/*!
+	 * Should be called whenever a new power limit is requested.
+	 */
+	void onPowerLimitRequested();
+
+	/*!
+	 * Should be called once per poll cycle with the total AC power of the inverter.
+	 */
+	void addPowerSample(double power, double maxPower);
+
+	int interval() const;
+
+private:
+	DeviceState mDeviceState;
+	bool mFastModeEnabled;
+	int mLimiterHoldTime;
+	QElapsedTimer mLimiterClock;
+	double mLastPower;
+	double mVariation; // Moving average of the relative power change per cycle
+};
+
+#endif // POLL_INTERVAL_POLICY_H
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <QDebug>
+#include <QTimer>
+#include "poll_scheduler.h"
+
+// Weight of the latest sample in the moving average of the poll jitter.
+static const double JitterWeight = 0.2;
+
+PollScheduler::Entry::Entry():
+	mDue(0),
+	mLastDue(-1),
+	mActiveSince(0),
+	mJitter(0),
+	mScheduled(false),
+	mActive(false)
+{
+}
+
+PollScheduler::Entry::~Entry()
+{
+	PollScheduler::instance()->remove(this);
+}
+
+void PollScheduler::Entry::schedulePoll(const QString &endpoint, int interval)
+{
+	PollScheduler::instance()->schedule(this, endpoint, interval);
+}
+
+void PollScheduler::Entry::cancelPoll()
+{
+	PollScheduler::instance()->cancel(this);
+}
+
+PollScheduler::PollScheduler(QObject *parent):
+	QObject(parent),
+	mTimer(new QTimer(this)),
+	mPollTimeout(PollTimeout)
+{
+	mTimer->setSingleShot(true);
+	connect(mTimer, SIGNAL(timeout()), this, SLOT(onTimer()));
+	mClock.start();
+}
+
+PollScheduler *PollScheduler::instance()
+{
+	static PollScheduler *scheduler = new PollScheduler();
+	return scheduler;
+}
+
+void PollScheduler::add(Entry *entry)
+{
+	if (!mEntries.contains(entry))
+		mEntries.append(entry);
+}
+
+void PollScheduler::remove(Entry *entry)
+{
+	finish(entry);
+	mEntries.removeOne(entry);
+	updateTimer();
+}
+
+void PollScheduler::schedule(Entry *entry, const QString &endpoint, int interval)
+{
+	add(entry);
+	finish(entry);
+	qint64 t = now();
+	if (entry->mLastDue < 0) {
+		// First poll of this device. Put it in a different slot of the cycle than the devices
+		// already polled on the same endpoint.
+		int position = 0;
+		foreach (Entry *e, mEntries) {
+			if (e != entry && e->mEndpoint == endpoint)
+				++position;
+		}
+		entry->mDue = t + static_cast<qint64>(interval) * position / (position + 1);
+	} else {
+		// Fixed rate: the next poll is due one interval after the previous one was due, not
+		// after it has finished.
+		entry->mDue = qMax(entry->mLastDue + interval, t);
+	}
+	entry->mEndpoint = endpoint;
+	entry->mScheduled = true;
+	updateTimer();
+}
+
+void PollScheduler::cancel(Entry *entry)
+{
+	entry->mScheduled = false;
+	finish(entry);
+	updateTimer();
+}
+
+void PollScheduler::finish(Entry *entry)
+{
+	if (!entry->mActive)
+		return;
+	entry->mActive = false;
+	EndpointState &s = mEndpoints[entry->mActiveEndpoint];
+	if (s.activePolls > 0)
+		--s.activePolls;
+	entry->mActiveEndpoint.clear();
+	updateTimer();
+}
+
+qint64 PollScheduler::nextStartTime(const QString &endpoint) const
+{
+	QHash<QString, EndpointState>::const_iterator it = mEndpoints.find(endpoint);
+	if (it == mEndpoints.end())
+		return 0;
+	if (it->activePolls >= MaxConcurrentPolls)
+		return -1;
+	return it->lastStart + MinPollSpacing;
+}
+
+void PollScheduler::onTimer()
+{
+	qint64 t = now();
+	foreach (Entry *e, mEntries) {
+		if (e->mActive && t - e->mActiveSince >= mPollTimeout) {
+			qWarning() << "Poll on" << e->mActiveEndpoint << "did not finish in time";
+			finish(e);
+		}
+	}
+
+	QList<Entry *> due;
+	foreach (Entry *e, mEntries) {
+		if (e->mScheduled && e->mDue <= t)
+			due.append(e);
+	}
+	std::stable_sort(due.begin(), due.end(), [](const Entry *a, const Entry *b) {
+		return a->mDue < b->mDue;
+	});
+	foreach (Entry *e, due) {
+		// A previous poll may have removed or rescheduled this entry
+		if (!mEntries.contains(e) || !e->mScheduled || e->mDue > t)
+			continue;
+		qint64 start = nextStartTime(e->mEndpoint);
+		if (start < 0 || start > t)
+			continue;
+		EndpointState &s = mEndpoints[e->mEndpoint];
+		++s.activePolls;
+		s.lastStart = t;
+		e->mScheduled = false;
+		e->mActive = true;
+		e->mActiveEndpoint = e->mEndpoint;
+		e->mActiveSince = t;
+		e->mLastDue = e->mDue;
+		e->mJitter = JitterWeight * (t - e->mDue) + (1 - JitterWeight) * e->mJitter;
+		e->onPoll();
+	}
+	updateTimer();
+}
+
+void PollScheduler::updateTimer()
+{
+	qint64 next = -1;
+	foreach (Entry *e, mEntries) {
+		qint64 time = -1;
+		if (e->mActive)
+			time = e->mActiveSince + mPollTimeout;
+		if (e->mScheduled) {
+			qint64 start = nextStartTime(e->mEndpoint);
+			if (start >= 0) {
+				start = qMax(start, e->mDue);
+				time = time < 0 ? start : qMin(time, start);
+			}
+		}
+		if (time >= 0 && (next < 0 || time < next))
+			next = time;
+	}
+	if (next < 0) {
+		mTimer->stop();
+		return;
+	}
+	mTimer->start(static_cast<int>(qMax<qint64>(0, next - now())));
+}
@@ -0,0 +1,142 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class QTimer;
+
+/*!
+ * Central scheduler for the poll cycles of all inverters.
+ *
+ * Instead of running a timer per device, updaters derive from `PollScheduler::Entry` and ask the
+ * scheduler for their next poll. Polls are started at a fixed rate, so they do not drift into
+ * bursts, and devices registering on the same endpoint are placed in different slots of the
+ * poll cycle.
+ *
+ * Polls are grouped by endpoint (the host name of the device or data manager). At most
+ * `MaxConcurrentPolls` polls run on the same endpoint at a time, and two polls on the same
+ * endpoint start at least `MinPollSpacing` milliseconds apart. A poll that is due while its
+ * endpoint is busy is postponed.
+ */
+class PollScheduler : public QObject
+{
+	Q_OBJECT
+public:
+	static const int MaxConcurrentPolls = 1;
+
+	static const int MinPollSpacing = 50; // ms
+
+	// Default time after which a poll that has not been finished no longer counts against the
+	// budget of its endpoint.
+	static const int PollTimeout = 30000; // ms
+
+	class Entry
+	{
+	public:
+		Entry();
+
+		virtual ~Entry();
+
+		bool isPollScheduled() const
+		{
+			return mScheduled;
+		}
+
+		/*!
+		 * Moving average of the time between the moment a poll was due and the moment it
+		 * actually started, in milliseconds.
+		 */
+		int pollJitter() const
+		{
+			return qRound(mJitter);
+		}
+
+	protected:
+		/*!
+		 * Schedules the next call to `onPoll`, `interval` milliseconds after the previous poll
+		 * was due. This also marks the current poll as finished, which releases the budget it
+		 * took from its endpoint.
+		 */
+		void schedulePoll(const QString &endpoint, int interval);
+
+		/*!
+		 * Removes the scheduled poll, if any. Like `schedulePoll`, this marks the current poll as
+		 * finished.
+		 */
+		void cancelPoll();
+
+		virtual void onPoll() = 0;
+
+	private:
+		friend class PollScheduler;
+
+		QString mEndpoint; // Endpoint of the scheduled poll
+		QString mActiveEndpoint; // Endpoint of the poll in progress
+		qint64 mDue;
+		qint64 mLastDue;
+		qint64 mActiveSince;
+		double mJitter;
+		bool mScheduled;
+		bool mActive;
+	};
+
+	static PollScheduler *instance();
+
+	void setPollTimeout(int timeout)
+	{
+		mPollTimeout = timeout;
+		updateTimer();
+	}
+
+private slots:
+	void onTimer();
+
+private:
+	struct EndpointState
+	{
+		EndpointState():
+			activePolls(0),
+			lastStart(-MinPollSpacing)
+		{
+		}
+
+		int activePolls;
+		qint64 lastStart;
+	};
+
+	explicit PollScheduler(QObject *parent = 0);
+
+	void add(Entry *entry);
+
+	void remove(Entry *entry);
+
+	void schedule(Entry *entry, const QString &endpoint, int interval);
+
+	void cancel(Entry *entry);
+
+	void finish(Entry *entry);
+
+	qint64 now() const
+	{
+		return mClock.elapsed();
+	}
+
+	/*!
+	 * Returns the earliest moment a poll may start on `endpoint`, or -1 if the endpoint is
+	 * busy until a poll finishes.
+	 */
+	qint64 nextStartTime(const QString &endpoint) const;
+
+	void updateTimer();
+
+	QList<Entry *> mEntries;
+	QHash<QString, EndpointState> mEndpoints;
+	QTimer *mTimer;
+	QElapsedTimer mClock;
+	int mPollTimeout;
+};
+
+#endif // POLL_SCHEDULER_H
@@ -6,6 +6,12 @@ BasicPowerInfo::BasicPowerInfo(VeQItem *root, QObject *parent) :
 	mPower(createItem("Power")),
 	mTotalEnergy(createItem("Energy/Forward"))
 {
+	PublishPolicy powerPolicy;
+	powerPolicy.deadband = 1; // W
+	setPublishPolicy(mPower, powerPolicy);
+	PublishPolicy energyPolicy;
+	energyPolicy.roundToPrecision = true;
+	setPublishPolicy(mTotalEnergy, energyPolicy);
 }
 
 double BasicPowerInfo::power() const
@@ -39,6 +45,12 @@ PowerInfo::PowerInfo(VeQItem *root, QObject *parent) :
 	mCurrent(createItem("Current")),
 	mVoltage(createItem("Voltage"))
 {
+	PublishPolicy currentPolicy;
+	currentPolicy.roundToPrecision = true;
+	setPublishPolicy(mCurrent, currentPolicy);
+	PublishPolicy voltagePolicy;
+	voltagePolicy.deadband = 0.1; // V
+	setPublishPolicy(mVoltage, voltagePolicy);
 }
 
 double PowerInfo::current() const
@@ -0,0 +1,90 @@
+#include <qnumeric.h>
+#include <QtGlobal>
+#include "power_limit_stage.h"
+
+PowerLimitStage::PowerLimitStage():
+	mDeadband(0),
+	mMinWriteInterval(0),
+	mKeepAliveInterval(KeepAliveInterval),
+	mRequested(qQNaN()),
+	mWritten(qQNaN()),
+	mInProgress(qQNaN()),
+	mWriteInProgress(false),
+	mWriteCount(0),
+	mSuppressedCount(0),
+	mWriteLatency(0)
+{
+}
+
+void PowerLimitStage::request(double powerLimit)
+{
+	double reference = mWriteInProgress ? mInProgress : mWritten;
+	// The end points are never suppressed by the deadband, otherwise a value close to zero
+	// would be kept when full curtailment is requested (or a value close to full power when
+	// the limit is lifted).
+	bool endPoint = powerLimit <= 0 || powerLimit >= 1;
+	if (qIsFinite(reference) &&
+		(powerLimit == reference || (!endPoint && qAbs(powerLimit - reference) <= mDeadband))) {
+		// The latest value wins, so a pending request is dropped as well
+		mRequested = qQNaN();
+		++mSuppressedCount;
+		return;
+	}
+	mRequested = powerLimit;
+}
+
+bool PowerLimitStage::takeWrite(double *powerLimit)
+{
+	if (mWriteInProgress)
+		return false;
+	bool hasRequest = qIsFinite(mRequested);
+	bool keepAlive = qIsFinite(mWritten) && mLastWrite.isValid() &&
+		mLastWrite.elapsed() >= mKeepAliveInterval;
+	if (!hasRequest && !keepAlive)
+		return false;
+	if (hasRequest && mLastWrite.isValid() && mLastWrite.elapsed() < mMinWriteInterval)
+		return false;
+	mInProgress = hasRequest ? mRequested : mWritten;
+	mRequested = qQNaN();
+	mWriteInProgress = true;
+	mLastWrite.start();
+	++mWriteCount;
+	*powerLimit = mInProgress;
+	return true;
+}
+
+void PowerLimitStage::onWriteCompleted(bool success)
+{
+	if (!mWriteInProgress)
+		return;
+	mWriteInProgress = false;
+	if (!qIsFinite(mInProgress)) {
+		// The stage has been reset while the write was in progress
+	} else if (success) {
+		mWritten = mInProgress;
+		mWriteLatency = static_cast<int>(mLastWrite.elapsed());
+	} else if (!qIsFinite(mRequested)) {
+		// Try again, unless a newer value has been requested in the mean time
+		mRequested = mInProgress;
+		mWritten = qQNaN();
+	}
+	mInProgress = qQNaN();
+}
+
+void PowerLimitStage::reset()
+{
+	mRequested = qQNaN();
+	mWritten = qQNaN();
+	mInProgress = qQNaN();
+	mLastWrite.invalidate();
+}
+
+void PowerLimitStage::resend()
+{
+	if (!qIsFinite(mRequested))
+		mRequested = mWriteInProgress ? mInProgress : mWritten;
+	mWritten = qQNaN();
+	mInProgress = qQNaN();
+	mWriteInProgress = false;
+	mLastWrite.invalidate();
+}
@@ -0,0 +1,107 @@
+#ifndef POWER_LIMIT_STAGE_H
+#define POWER_LIMIT_STAGE_H
+
+#include <QElapsedTimer>
+
+/*!
+ * Decides when a requested power limit is actually written to the inverter.
+ *
+ * The control loop may request a new limit many times a second, often with (almost) the same
+ * value. Requests are handled as follows:
+ * - A request within `deadband` of the last written value is suppressed, unless it requests
+ *   0 or 1, which are always passed on when they differ from the last written value.
+ * - Only the latest request is kept. If a write is pending, a new request replaces it, or
+ *   cancels it if the new request is suppressed.
+ * - Two writes are at least `minWriteInterval` milliseconds apart.
+ * - The last value is written again after `keepAliveInterval` milliseconds, even if no new
+ *   value has been requested, so the inverter does not fall back to full power while the
+ *   control loop is still active.
+ * - A failed write is retried, unless a newer value has been requested in the mean time.
+ *
+ * Power limits are fractions of the maximum power (0 to 1).
+ */
+class PowerLimitStage
+{
+public:
+	// Must be well below the timeout written to the inverter together with the limit
+	static const int KeepAliveInterval = 30000; // ms
+
+	PowerLimitStage();
+
+	void setDeadband(double deadband)
+	{
+		mDeadband = deadband;
+	}
+
+	void setMinWriteInterval(int interval)
+	{
+		mMinWriteInterval = interval;
+	}
+
+	void setKeepAliveInterval(int interval)
+	{
+		mKeepAliveInterval = interval;
+	}
+
+	void request(double powerLimit);
+
+	/*!
+	 * Returns true if a write should be sent now. In that case `powerLimit` is set to the value
+	 * to be written, and the write is considered to be in progress until `onWriteCompleted` is
+	 * called.
+	 */
+	bool takeWrite(double *powerLimit);
+
+	void onWriteCompleted(bool success);
+
+	/*!
+	 * Forgets the last written value, so the next request is always written and no keep-alive
+	 * writes are sent.
+	 */
+	void reset();
+
+	/*!
+	 * Must be called when the connection to the inverter has been (re)established or lost. The
+	 * state of the inverter is unknown, and a write in progress will not complete. The last
+	 * value requested is written again with the next `takeWrite`.
+	 */
+	void resend();
+
+	int writeCount() const
+	{
+		return mWriteCount;
+	}
+
+	/*!
+	 * Number of requests that were dropped because they were within the deadband. Requests
+	 * replaced by a newer request before they were written are not counted.
+	 */
+	int suppressedCount() const
+	{
+		return mSuppressedCount;
+	}
+
+	/*!
+	 * Time between sending the last successful write and receiving its acknowledgement, in
+	 * milliseconds.
+	 */
+	int writeLatency() const
+	{
+		return mWriteLatency;
+	}
+
+private:
+	double mDeadband;
+	int mMinWriteInterval;
+	int mKeepAliveInterval;
+	double mRequested; // NaN if there is no pending request
+	double mWritten; // NaN if unknown
+	double mInProgress;
+	bool mWriteInProgress;
+	QElapsedTimer mLastWrite;
+	int mWriteCount;
+	int mSuppressedCount;
+	int mWriteLatency;
+};
+
+#endif // POWER_LIMIT_STAGE_H
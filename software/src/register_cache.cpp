@@ -0,0 +1,46 @@
+#include <cstring>
+#include "register_cache.h"
+
+RegisterCache::RegisterCache():
+	mValid(false)
+{
+}
+
+bool RegisterCache::update(const RegisterSpan &values)
+{
+	int size = values.size();
+	if (mValid && mValues.size() == size &&
+		memcmp(mValues.constData(), values.data(), size * sizeof(quint16)) == 0) {
+		mDirty.fill(false);
+		return false;
+	}
+	if (!mValid || mValues.size() != size) {
+		mValues = values.toVector();
+		mDirty.fill(true, size);
+		mValid = true;
+		return true;
+	}
+	quint16 *data = mValues.data();
+	for (int i=0; i<size; ++i) {
+		mDirty.setBit(i, data[i] != values[i]);
+		data[i] = values[i];
+	}
+	return true;
+}
+
+bool RegisterCache::isDirty(int index, int count) const
+{
+	int end = qMin(index + count, mDirty.size());
+	for (int i=qMax(0, index); i<end; ++i) {
+		if (mDirty.testBit(i))
+			return true;
+	}
+	return false;
+}
+
+void RegisterCache::clear()
+{
+	mValues.clear();
+	mDirty.clear();
+	mValid = false;
+}
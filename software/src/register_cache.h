@@ -0,0 +1,41 @@
+#ifndef REGISTER_CACHE_H
+#define REGISTER_CACHE_H
+
+#include <QBitArray>
+#include <QVector>
+#include "register_span.h"
+
+/*!
+ * Keeps the last register block read from a model and tracks which registers have changed.
+ *
+ * `update` compares a new block with the previous one and marks the registers that differ as
+ * dirty. Parsers use `isDirty` to skip converting and publishing fields whose registers
+ * (including their scale factors) did not change. After `clear` all registers of the next block
+ * are dirty.
+ */
+class RegisterCache
+{
+public:
+	RegisterCache();
+
+	/*!
+	 * Stores `values` and computes the dirty mask. Returns false if the block is identical to the
+	 * previous one.
+	 */
+	bool update(const RegisterSpan &values);
+
+	/*!
+	 * Returns true if any of the `count` registers starting at `index` changed during the last
+	 * update.
+	 */
+	bool isDirty(int index, int count = 1) const;
+
+	void clear();
+
+private:
+	QVector<quint16> mValues;
+	QBitArray mDirty;
+	bool mValid;
+};
+
+#endif // REGISTER_CACHE_H
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include "register_planner.h"
+
+RegisterPlanner::RegisterPlanner(int maxGap):
+	mMaxGap(maxGap)
+{
+}
+
+void RegisterPlanner::add(quint16 start, quint16 count, const ModbusCallback &consumer)
+{
+	Q_ASSERT(count > 0 && count <= ModbusReply::MaxRegisters);
+	Range range;
+	range.start = start;
+	range.count = count;
+	range.consumer = consumer;
+	mRanges.append(range);
+}
+
+QList<RegisterPlanner::Block> RegisterPlanner::plan() const
+{
+	QList<Range> ranges = mRanges;
+	std::stable_sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) {
+		return a.start < b.start;
+	});
+	// Walking the sorted ranges and starting a new block whenever the next range does not fit
+	// yields the minimal number of blocks.
+	QList<Block> blocks;
+	foreach (const Range &r, ranges) {
+		int end = r.start + r.count;
+		if (!blocks.isEmpty() && mMaxGap >= 0) {
+			Block &b = blocks.last();
+			int blockEnd = b.start + b.count;
+			int newEnd = qMax(blockEnd, end);
+			if (r.start - blockEnd <= mMaxGap && newEnd - b.start <= ModbusReply::MaxRegisters) {
+				b.count = static_cast<quint16>(newEnd - b.start);
+				b.ranges.append(r);
+				continue;
+			}
+		}
+		Block b;
+		b.start = r.start;
+		b.count = r.count;
+		b.ranges.append(r);
+		blocks.append(b);
+	}
+	return blocks;
+}
+
+void RegisterPlanner::dispatch(const Block &block, ModbusReply::ExceptionCode error,
+							   const RegisterSpan &values)
+{
+	foreach (const Range &r, block.ranges) {
+		if (!r.consumer)
+			continue;
+		if (error != ModbusReply::NoException)
+			r.consumer(error, RegisterSpan());
+		else
+			r.consumer(error, values.mid(r.start - block.start, r.count));
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef REGISTER_PLANNER_H
+#define REGISTER_PLANNER_H
+
+#include <QList>
+#include "modbus_client.h"
+
+/*!
+ * Combines the register ranges needed during a poll cycle into as few modbus reads as possible.
+ *
+ * Each consumer adds the range it needs together with a callback. `plan` sorts the ranges and
+ * merges them into blocks of at most `ModbusReply::MaxRegisters` registers. Ranges are only
+ * merged if the number of unused registers between them does not exceed `maxGap`. After a block
+ * has been read, `dispatch` hands every consumer the part of the block it asked for.
+ */
+class RegisterPlanner
+{
+public:
+	struct Range
+	{
+		quint16 start;
+		quint16 count;
+		ModbusCallback consumer;
+	};
+
+	struct Block
+	{
+		quint16 start;
+		quint16 count;
+		QList<Range> ranges;
+	};
+
+	static const int DefaultMaxGap = 16;
+
+	explicit RegisterPlanner(int maxGap = DefaultMaxGap);
+
+	int maxGap() const
+	{
+		return mMaxGap;
+	}
+
+	/*!
+	 * Sets the maximum number of unused registers read to combine two ranges. A negative value
+	 * disables merging, so every range is read separately.
+	 */
+	void setMaxGap(int maxGap)
+	{
+		mMaxGap = maxGap;
+	}
+
+	void add(quint16 start, quint16 count, const ModbusCallback &consumer);
+
+	void clear()
+	{
+		mRanges.clear();
+	}
+
+	bool isEmpty() const
+	{
+		return mRanges.isEmpty();
+	}
+
+	QList<Block> plan() const;
+
+	/*!
+	 * Passes the result of reading `block` to the consumers of its ranges. If the device returned
+	 * fewer registers than requested, the consumers get whatever part of their range is present.
+	 */
+	static void dispatch(const Block &block, ModbusReply::ExceptionCode error,
+						 const RegisterSpan &values);
+
+private:
+	QList<Range> mRanges;
+	int mMaxGap;
+};
+
+#endif // REGISTER_PLANNER_H
@@ -0,0 +1,196 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include "scan_cache.h"
+
+static const int FormatVersion = 1;
+
+static QString resultName(ScanCache::Result result)
+{
+	switch (result) {
+	case ScanCache::Inverter:
+		return "inverter";
+	case ScanCache::NoInverter:
+		return "no-inverter";
+	default:
+		return "no-response";
+	}
+}
+
+ScanCache::ScanCache(const QString &fileName):
+	mFileName(fileName),
+	mDirty(false)
+{
+}
+
+QString ScanCache::defaultFileName()
+{
+	return "/data/var/lib/dbus-fronius/scan-cache.json";
+}
+
+void ScanCache::load()
+{
+	mRecords.clear();
+	mDirty = false;
+	QFile file(mFileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+	if (root.value("version").toInt() != FormatVersion)
+		return;
+	foreach (const QJsonValue &v, root.value("hosts").toArray()) {
+		QJsonObject o = v.toObject();
+		QHostAddress address;
+		if (!address.setAddress(o.value("address").toString()))
+			continue;
+		Record r;
+		r.macAddress = o.value("mac").toString();
+		QString result = o.value("result").toString();
+		if (result == resultName(Inverter))
+			r.result = Inverter;
+		else if (result == resultName(NoInverter))
+			r.result = NoInverter;
+		else
+			r.result = NoResponse;
+		r.protocol = o.value("protocol").toInt();
+		r.port = o.value("port").toInt();
+		r.unitId = o.value("unitId").toInt();
+		r.lastSeen = static_cast<qint64>(o.value("lastSeen").toDouble());
+		r.expires = static_cast<qint64>(o.value("expires").toDouble());
+		mRecords.insert(address, r);
+	}
+	removeExpired();
+	qInfo() << "Loaded" << mRecords.size() << "scan results from" << mFileName;
+}
+
+void ScanCache::save()
+{
+	removeExpired();
+	if (!mDirty)
+		return;
+	QJsonArray hosts;
+	for (QHash<QHostAddress, Record>::const_iterator it = mRecords.begin();
+		 it != mRecords.end(); ++it) {
+		const Record &r = it.value();
+		QJsonObject o;
+		o.insert("address", it.key().toString());
+		o.insert("mac", r.macAddress);
+		o.insert("result", resultName(r.result));
+		if (r.result == Inverter) {
+			o.insert("protocol", r.protocol);
+			o.insert("port", r.port);
+			o.insert("unitId", r.unitId);
+		}
+		o.insert("lastSeen", static_cast<double>(r.lastSeen));
+		o.insert("expires", static_cast<double>(r.expires));
+		hosts.append(o);
+	}
+	QJsonObject root;
+	root.insert("version", FormatVersion);
+	root.insert("hosts", hosts);
+
+	QDir().mkpath(QFileInfo(mFileName).absolutePath());
+	QSaveFile file(mFileName);
+	if (!file.open(QIODevice::WriteOnly) ||
+		file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 ||
+		!file.commit()) {
+		qWarning() << "Could not write scan results to" << mFileName;
+		return;
+	}
+	mDirty = false;
+}
+
+void ScanCache::setInverter(const DeviceInfo &deviceInfo, const QString &macAddress)
+{
+	QHostAddress address(deviceInfo.hostName);
+	if (address.isNull())
+		return;
+	Record &r = mRecords[address];
+	r.macAddress = macAddress;
+	r.result = Inverter;
+	r.protocol = deviceInfo.retrievalMode;
+	r.port = deviceInfo.retrievalMode == ProtocolFroniusSolarApi ?
+		deviceInfo.port : deviceInfo.modbusPort;
+	r.unitId = deviceInfo.networkId;
+	r.lastSeen = QDateTime::currentMSecsSinceEpoch();
+	r.expires = 0;
+	mDirty = true;
+}
+
+void ScanCache::setNoInverter(const QHostAddress &address, bool responded,
+							  const QString &macAddress)
+{
+	Record r;
+	r.macAddress = macAddress;
+	r.result = responded ? NoInverter : NoResponse;
+	r.lastSeen = QDateTime::currentMSecsSinceEpoch();
+	if (responded)
+		r.expires = r.lastSeen + NoInverterTtl;
+	else
+		r.expires = r.lastSeen + NoResponseTtl;
+	mRecords.insert(address, r);
+	mDirty = true;
+}
+
+bool ScanCache::isNegative(const QHostAddress &address, const QString &macAddress) const
+{
+	QHash<QHostAddress, Record>::const_iterator it = mRecords.find(address);
+	if (it == mRecords.end() || it->result == Inverter)
+		return false;
+	if (it->expires <= QDateTime::currentMSecsSinceEpoch())
+		return false;
+	return macAddress.isEmpty() || it->macAddress.isEmpty() || macAddress == it->macAddress;
+}
+
+QList<QHostAddress> ScanCache::inverters() const
+{
+	QList<QPair<qint64, QHostAddress> > found;
+	for (QHash<QHostAddress, Record>::const_iterator it = mRecords.begin();
+		 it != mRecords.end(); ++it) {
+		if (it->result == Inverter)
+			found.append(qMakePair(-it->lastSeen, it.key()));
+	}
+	std::sort(found.begin(), found.end(),
+		[](const QPair<qint64, QHostAddress> &a, const QPair<qint64, QHostAddress> &b) {
+			return a.first < b.first;
+		});
+	QList<QHostAddress> result;
+	for (int i=0; i<found.size(); ++i)
+		result.append(found[i].second);
+	return result;
+}
+
+void ScanCache::removeExpired()
+{
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QList<QPair<qint64, QHostAddress> > negative;
+	for (QHash<QHostAddress, Record>::iterator it = mRecords.begin(); it != mRecords.end();) {
+		bool expired = it->result == Inverter ?
+			it->lastSeen + InverterTtl <= now : it->expires <= now;
+		if (expired) {
+			it = mRecords.erase(it);
+			mDirty = true;
+		} else {
+			if (it->result != Inverter)
+				negative.append(qMakePair(it->lastSeen, it.key()));
+			++it;
+		}
+	}
+	if (mRecords.size() <= MaxRecords)
+		return;
+	// Drop the oldest negative results
+	std::sort(negative.begin(), negative.end(),
+		[](const QPair<qint64, QHostAddress> &a, const QPair<qint64, QHostAddress> &b) {
+			return a.first < b.first;
+		});
+	int excess = qMin(mRecords.size() - MaxRecords, negative.size());
+	for (int i=0; i<excess; ++i)
+		mRecords.remove(negative[i].second);
+	mDirty = true;
+}
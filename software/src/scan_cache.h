@@ -0,0 +1,97 @@
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QString>
+#include "defines.h"
+
+/*!
+ * Remembers the results of earlier network scans, so they survive a restart.
+ *
+ * For each IP address the cache stores whether an inverter was found, and if so with which
+ * protocol, port and unit ID. Hosts that did not respond, or responded but turned out not to be
+ * an inverter, are stored as negative results with a limited lifetime. A negative result is also
+ * ignored when the MAC address of the host has changed, because then the IP address has been
+ * handed out to another device.
+ *
+ * The cache is kept in memory, and written to `fileName` by `save`.
+ */
+class ScanCache
+{
+public:
+	enum Result {
+		Inverter,
+		NoInverter, // Host responded, but no inverter was detected
+		NoResponse
+	};
+
+	static const qint64 NoInverterTtl = 24 * 3600 * 1000; // ms
+	static const qint64 NoResponseTtl = 30 * 60 * 1000; // ms
+	// Inverters that have not been seen for this long are removed from the cache
+	static const qint64 InverterTtl = 30LL * 24 * 3600 * 1000; // ms
+	static const int MaxRecords = 4096;
+
+	explicit ScanCache(const QString &fileName = defaultFileName());
+
+	static QString defaultFileName();
+
+	void load();
+
+	/*!
+	 * Writes the cache to disk, if it has been changed since it was loaded or saved.
+	 */
+	void save();
+
+	/*!
+	 * @param macAddress The MAC address of the host, empty if unknown.
+	 */
+	void setInverter(const DeviceInfo &deviceInfo, const QString &macAddress);
+
+	void setNoInverter(const QHostAddress &address, bool responded, const QString &macAddress);
+
+	/*!
+	 * Returns true if there is a negative result for `address` which has not expired yet.
+	 * @param macAddress The current MAC address of the host, if known.
+	 */
+	bool isNegative(const QHostAddress &address, const QString &macAddress = QString()) const;
+
+	/*!
+	 * Addresses of the inverters found before, the most recently seen first.
+	 */
+	QList<QHostAddress> inverters() const;
+
+	QList<QHostAddress> addresses() const
+	{
+		return mRecords.keys();
+	}
+
+private:
+	struct Record {
+		Record():
+			result(NoResponse),
+			protocol(0),
+			port(0),
+			unitId(0),
+			lastSeen(0),
+			expires(0)
+		{}
+
+		QString macAddress;
+		Result result;
+		int protocol; // ProtocolType
+		int port;
+		int unitId;
+		qint64 lastSeen; // ms since epoch
+		qint64 expires; // ms since epoch, 0 for inverters
+	};
+
+	void removeExpired();
+
+	QString mFileName;
+	QHash<QHostAddress, Record> mRecords;
+	bool mDirty;
+};
+
+#endif // SCAN_CACHE_H
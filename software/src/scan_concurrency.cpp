@@ -0,0 +1,30 @@
+#include "scan_concurrency.h"
+
+ScanConcurrency::ScanConcurrency():
+	mLimit(InitialLimit),
+	mBaseRtt(-1),
+	mSinceDecrease(InitialLimit)
+{
+}
+
+void ScanConcurrency::onHostProbed(qint64 rtt, bool lost)
+{
+	++mSinceDecrease;
+	bool congested = lost;
+	if (rtt >= 0) {
+		if (mBaseRtt < 0 || rtt < mBaseRtt)
+			mBaseRtt = rtt;
+		if (rtt > mBaseRtt * RttFactor + RttSlack)
+			congested = true;
+	}
+	if (!congested) {
+		mLimit = qMin(static_cast<double>(MaxLimit), mLimit + 1 / mLimit);
+		return;
+	}
+	// The hosts already being scanned were started with the old limit, so they are likely to run
+	// into the same congestion. Wait for a full round before decreasing again.
+	if (mSinceDecrease < limit())
+		return;
+	mLimit = qMax(static_cast<double>(MinLimit), mLimit / 2);
+	mSinceDecrease = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef SCAN_CONCURRENCY_H
+#define SCAN_CONCURRENCY_H
+
+#include <QtGlobal>
+
+/*!
+ * Chooses the number of hosts scanned at the same time by the `InverterGateway`.
+ *
+ * The limit is adjusted using additive increase/multiplicative decrease (AIMD), like the
+ * congestion window of TCP. Every scanned host without a sign of congestion raises the limit by
+ * 1/limit, so the limit grows by about one host per round of `limit` hosts. On congestion, the
+ * limit is halved, at most once per round.
+ *
+ * Most addresses of a network sweep are not in use, so a host that does not respond at all is not
+ * a sign of congestion. These are:
+ * - A lost connection attempt on a host that did respond on another port.
+ * - A round trip time of more than `RttFactor` times the lowest round trip time seen so far
+ *   (plus `RttSlack`). Since the round trip time includes the time needed to handle the event,
+ *   this also detects an overloaded CPU.
+ */
+class ScanConcurrency
+{
+public:
+	static const int InitialLimit = 32;
+	static const int MinLimit = 4;
+	static const int MaxLimit = 256;
+	static const int RttFactor = 4;
+	static const int RttSlack = 25; // ms
+
+	ScanConcurrency();
+
+	int limit() const
+	{
+		return static_cast<int>(mLimit);
+	}
+
+	/*!
+	 * Should be called for each host that has been probed.
+	 * @param rtt The time until the first response of the host in milliseconds, or -1 if the host
+	 * did not respond.
+	 * @param lost True if the host did respond, but not on all ports.
+	 */
+	void onHostProbed(qint64 rtt, bool lost);
+
+	/*!
+	 * Lowest round trip time seen so far, or -1 if unknown.
+	 */
+	qint64 baseRtt() const
+	{
+		return mBaseRtt;
+	}
+
+private:
+	double mLimit;
+	qint64 mBaseRtt;
+	int mSinceDecrease; // Hosts probed since the last decrease
+};
+
+#endif // SCAN_CONCURRENCY_H
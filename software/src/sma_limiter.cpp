@@ -1,6 +1,6 @@
 #include "defines.h"
 #include "inverter.h"
-#include "modbus_tcp_client.h"
+#include "modbus_client.h"
 #include "sma_limiter.h"
 
 SmaLimiter::SmaLimiter(Inverter *parent) :
@@ -8,7 +8,7 @@ SmaLimiter::SmaLimiter(Inverter *parent) :
 {
 }
 
-void SmaLimiter::onConnected(ModbusTcpClient *client)
+void SmaLimiter::onConnected(ModbusClient *client)
 {
 	BaseLimiter::onConnected(client);
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
@@ -16,39 +16,39 @@ void SmaLimiter::onConnected(ModbusTcpClient *client)
 	// Check if WMaxLimPctEna is set, which we can only do if we have
 	// the required info model
 	if (deviceInfo.immediateControlOffset > 0) {
-		ModbusReply *reply = client->readHoldingRegisters(
-			deviceInfo.networkId, deviceInfo.immediateControlOffset + 9, 1);
-		connect(reply, SIGNAL(finished()), this,
-			SLOT(onReadLimitEnabledCompleted()));
+		client->readHoldingRegisters(
+			deviceInfo.networkId, deviceInfo.immediateControlOffset + 9, 1,
+			[this](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+				onReadLimitEnabledCompleted(error, values);
+			});
 	} else {
 		emit initialised(false);
 	}
 }
 
-void SmaLimiter::onReadLimitEnabledCompleted()
+void SmaLimiter::onReadLimitEnabledCompleted(ModbusReply::ExceptionCode error,
+											 const RegisterSpan &values)
 {
-	ModbusReply *reply = static_cast<ModbusReply *>(sender());
-	reply->deleteLater();
-	if (reply->error()) {
+	if (error) {
 		emit initialised(false);
 		return;
 	}
 
-	QVector<quint16> values = reply->registers();
 	emit initialised(values.size() > 0 && values[0] == 1);
 }
 
-ModbusReply *SmaLimiter::writePowerLimit(double powerLimitPct)
+void SmaLimiter::writePowerLimit(double powerLimitPct, const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 	quint16 pct = static_cast<quint16>(qRound(powerLimitPct * deviceInfo.powerLimitScale));
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 5, QVector<quint16>() << pct);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 5, QVector<quint16>() << pct, callback);
 }
 
-ModbusReply *SmaLimiter::resetPowerLimit()
+bool SmaLimiter::resetPowerLimit(const ModbusCallback &callback)
 {
 	// Do nothing
-	return 0;
+	Q_UNUSED(callback)
+	return false;
 }
 
 Sma2018Limiter::Sma2018Limiter(Inverter *parent) :
@@ -56,7 +56,7 @@ Sma2018Limiter::Sma2018Limiter(Inverter *parent) :
 {
 }
 
-void Sma2018Limiter::onConnected(ModbusTcpClient *client)
+void Sma2018Limiter::onConnected(ModbusClient *client)
 {
 	BaseLimiter::onConnected(client);
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
@@ -64,37 +64,37 @@ void Sma2018Limiter::onConnected(ModbusTcpClient *client)
 	// Check if WMaxLimPctEna is set, which we can only do if we have
 	// the required info model
 	if (deviceInfo.immediateControlOffset > 0) {
-		ModbusReply *reply = client->readHoldingRegisters(
-			deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, 1);
-		connect(reply, SIGNAL(finished()), this,
-			SLOT(onReadLimitEnabledCompleted()));
+		client->readHoldingRegisters(
+			deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, 1,
+			[this](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+				onReadLimitEnabledCompleted(error, values);
+			});
 	} else {
 		emit initialised(false);
 	}
 }
 
-void Sma2018Limiter::onReadLimitEnabledCompleted()
+void Sma2018Limiter::onReadLimitEnabledCompleted(ModbusReply::ExceptionCode error,
+											 const RegisterSpan &values)
 {
-	ModbusReply *reply = static_cast<ModbusReply *>(sender());
-	reply->deleteLater();
-	if (reply->error()) {
+	if (error) {
 		emit initialised(false);
 		return;
 	}
 
-	QVector<quint16> values = reply->registers();
 	emit initialised(values.size() > 0 && values[0] == 1);
 }
 
-ModbusReply *Sma2018Limiter::writePowerLimit(double powerLimitPct)
+void Sma2018Limiter::writePowerLimit(double powerLimitPct, const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 	quint16 pct = static_cast<quint16>(qRound(powerLimitPct * deviceInfo.powerLimitScale));
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 15, QVector<quint16>() << pct);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 15, QVector<quint16>() << pct, callback);
 }
 
-ModbusReply *Sma2018Limiter::resetPowerLimit()
+bool Sma2018Limiter::resetPowerLimit(const ModbusCallback &callback)
 {
 	// Do nothing
-	return 0;
+	Q_UNUSED(callback)
+	return false;
 }
@@ -11,14 +11,15 @@ class SmaLimiter : public SunspecLimiter
 public:
 	explicit SmaLimiter(Inverter *parent);
 
-	void onConnected(ModbusTcpClient *client) override;
+	void onConnected(ModbusClient *client) override;
 
-	ModbusReply *writePowerLimit(double powerLimitPct) override;
+	void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) override;
 
-	ModbusReply *resetPowerLimit() override;
+	bool resetPowerLimit(const ModbusCallback &callback) override;
 
-private slots:
-	void onReadLimitEnabledCompleted();
+private:
+	void onReadLimitEnabledCompleted(ModbusReply::ExceptionCode error,
+									 const RegisterSpan &values);
 };
 
 class Sma2018Limiter : public Sunspec2018Limiter
@@ -27,14 +28,15 @@ class Sma2018Limiter : public Sunspec2018Limiter
 public:
 	explicit Sma2018Limiter(Inverter *parent);
 
-	void onConnected(ModbusTcpClient *client) override;
+	void onConnected(ModbusClient *client) override;
 
-	ModbusReply *writePowerLimit(double powerLimitPct) override;
+	void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) override;
 
-	ModbusReply *resetPowerLimit() override;
+	bool resetPowerLimit(const ModbusCallback &callback) override;
 
-private slots:
-	void onReadLimitEnabledCompleted();
+private:
+	void onReadLimitEnabledCompleted(ModbusReply::ExceptionCode error,
+									 const RegisterSpan &values);
 };
 
 
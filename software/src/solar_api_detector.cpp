@@ -30,6 +30,11 @@ DetectorReply *SolarApiDetector::start(const QString &hostName, int timeout)
 	return reply;
 }
 
+quint16 SolarApiDetector::tcpPort() const
+{
+	return static_cast<quint16>(mSettings->portNumber());
+}
+
 void SolarApiDetector::onDeviceInfoFound(const DeviceInfoData &data)
 {
 	Api *api = static_cast<Api *>(sender());
@@ -17,6 +17,8 @@ public:
 
 	DetectorReply *start(const QString &hostName, int timeout) override;
 
+	quint16 tcpPort() const override;
+
 private slots:
 	void onDeviceInfoFound(const DeviceInfoData &data);
 
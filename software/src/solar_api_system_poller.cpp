@@ -0,0 +1,60 @@
+#include "solar_api_system_poller.h"
+
+QHash<QString, SolarApiSystemPoller *> SolarApiSystemPoller::mPollers;
+
+SolarApiSystemPoller::SolarApiSystemPoller(const QString &hostName, int port, QObject *parent):
+	QObject(parent),
+	mSolarApi(new FroniusSolarApi(hostName, port, 15000, this)),
+	mUsers(0),
+	mSupported(true)
+{
+	connect(mSolarApi, SIGNAL(systemDataFound(const SystemInverterData &)),
+			this, SLOT(onSystemDataFound(const SystemInverterData &)));
+	schedulePoll(hostName, 0);
+}
+
+SolarApiSystemPoller *SolarApiSystemPoller::acquire(const QString &hostName, int port)
+{
+	QString k = key(hostName, port);
+	SolarApiSystemPoller *poller = mPollers.value(k);
+	if (poller == 0) {
+		poller = new SolarApiSystemPoller(hostName, port);
+		mPollers.insert(k, poller);
+	}
+	++poller->mUsers;
+	return poller;
+}
+
+void SolarApiSystemPoller::release(SolarApiSystemPoller *poller)
+{
+	if (poller == 0 || --poller->mUsers > 0)
+		return;
+	mPollers.remove(key(poller->mSolarApi->hostName(), poller->mSolarApi->port()));
+	poller->deleteLater();
+}
+
+QString SolarApiSystemPoller::key(const QString &hostName, int port)
+{
+	return QString("%1:%2").arg(hostName).arg(port);
+}
+
+void SolarApiSystemPoller::onPoll()
+{
+	mSolarApi->getSystemDataAsync();
+}
+
+void SolarApiSystemPoller::onSystemDataFound(const SystemInverterData &data)
+{
+	// Scheduling the next poll (or cancelling it) also releases the endpoint for the other
+	// pollers
+	if (data.error == SolarApiReply::ApiError) {
+		// The updaters will fall back to polling each inverter
+		qInfo() << "[Solar API] System data not supported by" << mSolarApi->hostName()
+				<< data.errorMessage;
+		mSupported = false;
+		cancelPoll();
+	} else {
+		schedulePoll(mSolarApi->hostName(), PollInterval);
+	}
+	emit systemDataFound(data);
+}
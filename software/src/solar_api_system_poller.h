@@ -0,0 +1,53 @@
+#ifndef SOLAR_API_SYSTEM_POLLER_H
+#define SOLAR_API_SYSTEM_POLLER_H
+
+#include <QHash>
+#include <QObject>
+#include "froniussolar_api.h"
+#include "poll_scheduler.h"
+
+/*!
+ * Retrieves power and energy of all inverters behind a data manager with a single Solar API
+ * request (`Scope=System`), so the load on the data manager does not grow with the number of
+ * inverters chained with DATCOM.
+ *
+ * There is one poller per data manager, shared by the `SolarApiUpdater`s of its inverters. Use
+ * `acquire` to get the poller of a data manager and `release` when it is no longer needed. The
+ * poller stops polling if the data manager does not support the request, the updaters will
+ * notice this through `isSupported`.
+ */
+class SolarApiSystemPoller : public QObject, private PollScheduler::Entry
+{
+	Q_OBJECT
+public:
+	static const int PollInterval = 5000; // ms
+
+	static SolarApiSystemPoller *acquire(const QString &hostName, int port);
+
+	static void release(SolarApiSystemPoller *poller);
+
+	bool isSupported() const
+	{
+		return mSupported;
+	}
+
+signals:
+	void systemDataFound(const SystemInverterData &data);
+
+private slots:
+	void onSystemDataFound(const SystemInverterData &data);
+
+private:
+	SolarApiSystemPoller(const QString &hostName, int port, QObject *parent = 0);
+
+	static QString key(const QString &hostName, int port);
+
+	void onPoll() override;
+
+	FroniusSolarApi *mSolarApi;
+	int mUsers;
+	bool mSupported;
+	static QHash<QString, SolarApiSystemPoller *> mPollers;
+};
+
+#endif // SOLAR_API_SYSTEM_POLLER_H
@@ -2,19 +2,29 @@
 #include "froniussolar_api.h"
 #include "inverter.h"
 #include "inverter_settings.h"
+#include "solar_api_system_poller.h"
 #include "solar_api_updater.h"
 #include "power_info.h"
 
 static const int UpdateInterval = 5000;
 static const int UpdateSettingsInterval = 10 * 60 * 1000;
+// While the system poller supplies power and energy, the data of the inverter itself (status,
+// voltages and currents) is retrieved once every this many update intervals. In between, the
+// power of multi phase inverters is distributed over the phases in the ratio of the last per
+// phase values.
+static const int DevicePollDivider = 6;
 
 SolarApiUpdater::SolarApiUpdater(Inverter *inverter, InverterSettings *settings, QObject *parent):
 	QObject(parent),
 	mInverter(inverter),
 	mSettings(settings),
 	mSolarApi(new FroniusSolarApi(inverter->hostName(), inverter->port(), 15000, this)),
+	mSystemPoller(0),
 	mSettingsTimer(new QTimer(this)),
 	mProcessor(inverter, settings),
+	mHasCommonData(false),
+	mInSystemData(false),
+	mPollCount(0),
 	mInitialized(false),
 	mRetryCount(0)
 {
@@ -40,7 +50,13 @@ SolarApiUpdater::SolarApiUpdater(Inverter *inverter, InverterSettings *settings,
 		this, SLOT(onConnectionDataChanged()));
 	mSettingsTimer->setInterval(UpdateSettingsInterval);
 	mSettingsTimer->start();
-	onStartRetrieval();
+	acquireSystemPoller();
+	startRetrieval();
+}
+
+SolarApiUpdater::~SolarApiUpdater()
+{
+	SolarApiSystemPoller::release(mSystemPoller);
 }
 
 Inverter *SolarApiUpdater::inverter()
@@ -53,7 +69,19 @@ InverterSettings *SolarApiUpdater::settings()
 	return mSettings;
 }
 
-void SolarApiUpdater::onStartRetrieval()
+void SolarApiUpdater::onPoll()
+{
+	mInverter->setPollJitter(pollJitter());
+	if (mHasCommonData && mInSystemData && mSystemPoller->isSupported() &&
+		++mPollCount < DevicePollDivider) {
+		scheduleRetrieval();
+		return;
+	}
+	mPollCount = 0;
+	startRetrieval();
+}
+
+void SolarApiUpdater::startRetrieval()
 {
 	mSolarApi->getCommonDataAsync(mInverter->deviceInfo().networkId);
 }
@@ -64,7 +92,11 @@ void SolarApiUpdater::onCommonDataFound(const CommonInverterData &data)
 	{
 	case SolarApiReply::NoError:
 	{
+		mCommonData = data;
+		mHasCommonData = true;
 		mProcessor.process(data);
+		mInverter->setStatusCode(data.statusCode);
+		mInverter->setErrorCode(data.errorCode);
 		mRetryCount = 0;
 		const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 		if (deviceInfo.phaseCount > 1) {
@@ -73,8 +105,6 @@ void SolarApiUpdater::onCommonDataFound(const CommonInverterData &data)
 			setInitialized();
 			scheduleRetrieval();
 		}
-		mInverter->setStatusCode(data.statusCode);
-		mInverter->setErrorCode(data.errorCode);
 		break;
 	}
 	case SolarApiReply::NetworkError:
@@ -118,6 +148,49 @@ void SolarApiUpdater::onThreePhasesDataFound(const ThreePhasesInverterData &data
 	scheduleRetrieval();
 }
 
+void SolarApiUpdater::onSystemDataFound(const SystemInverterData &data)
+{
+	switch (data.error)
+	{
+	case SolarApiReply::NoError:
+		break;
+	case SolarApiReply::NetworkError:
+		qDebug() << "[Solar API] Network error: " << data.errorMessage;
+		mInSystemData = false;
+		handleError();
+		return;
+	default:
+		// The system poller has stopped, onPoll will retrieve all data from the inverter
+		return;
+	}
+	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
+	bool inSystemData = data.inverters.contains(deviceInfo.networkId);
+	if (inSystemData != mInSystemData) {
+		// Without system data, onPoll retrieves all data from the inverter itself
+		if (!inSystemData)
+			qInfo() << "[Solar API] Inverter" << deviceInfo.networkId << "missing from system data of"
+					<< mInverter->hostName();
+		mInSystemData = inSystemData;
+	}
+	if (!mHasCommonData || !inSystemData)
+		return;
+	// Combine the power and energy with the voltage and current retrieved before
+	const SystemInverterValues &values = data.inverters[deviceInfo.networkId];
+	mCommonData.acPower = values.acPower;
+	mCommonData.dayEnergy = values.dayEnergy;
+	mCommonData.yearEnergy = values.yearEnergy;
+	mCommonData.totalEnergy = values.totalEnergy;
+	if (deviceInfo.phaseCount > 1) {
+		// Scale the per phase power of the last device poll. The per phase energy catches up
+		// with the total energy at the next device poll.
+		mInverter->meanPowerInfo()->setTotalEnergy(values.totalEnergy / 1000);
+		mProcessor.processPower(values.acPower);
+	} else {
+		mProcessor.process(mCommonData);
+	}
+	mRetryCount = 0;
+}
+
 void SolarApiUpdater::onPhaseChanged()
 {
 	if (mInverter->deviceInfo().phaseCount > 1)
@@ -136,11 +209,13 @@ void SolarApiUpdater::onConnectionDataChanged()
 {
 	mSolarApi->setHostName(mInverter->hostName());
 	mSolarApi->setPort(mInverter->port());
+	acquireSystemPoller();
 }
 
 void SolarApiUpdater::scheduleRetrieval()
 {
-	QTimer::singleShot(UpdateInterval, this, SLOT(onStartRetrieval()));
+	// Inverters behind the same data manager are polled one at a time
+	schedulePoll(mInverter->hostName(), UpdateInterval);
 }
 
 void SolarApiUpdater::setInitialized()
@@ -159,3 +234,14 @@ void SolarApiUpdater::handleError()
 		mRetryCount = 0;
 	}
 }
+
+void SolarApiUpdater::acquireSystemPoller()
+{
+	if (mSystemPoller != 0)
+		disconnect(mSystemPoller, 0, this, 0);
+	SolarApiSystemPoller::release(mSystemPoller);
+	mSystemPoller = SolarApiSystemPoller::acquire(mInverter->hostName(), mInverter->port());
+	mInSystemData = false;
+	connect(mSystemPoller, SIGNAL(systemDataFound(const SystemInverterData &)),
+			this, SLOT(onSystemDataFound(const SystemInverterData &)));
+}
@@ -3,21 +3,23 @@
 
 #include <QObject>
 #include "data_processor.h"
+#include "froniussolar_api.h"
+#include "poll_scheduler.h"
 
-class FroniusSolarApi;
 class Inverter;
 class InverterSettings;
 class PowerInfo;
 class QTimer;
-struct CommonInverterData;
-struct ThreePhasesInverterData;
+class SolarApiSystemPoller;
 
-class SolarApiUpdater : public QObject
+class SolarApiUpdater : public QObject, private PollScheduler::Entry
 {
 	Q_OBJECT
 public:
 	SolarApiUpdater(Inverter *inverter, InverterSettings *settings, QObject *parent = 0);
 
+	~SolarApiUpdater();
+
 	Inverter *inverter();
 
 	InverterSettings *settings();
@@ -28,12 +30,12 @@ signals:
 	void connectionLost();
 
 private slots:
-	void onStartRetrieval();
-
 	void onCommonDataFound(const CommonInverterData &data);
 
 	void onThreePhasesDataFound(const ThreePhasesInverterData &data);
 
+	void onSystemDataFound(const SystemInverterData &data);
+
 	void onPhaseChanged();
 
 	void onSettingsTimer();
@@ -41,17 +43,31 @@ private slots:
 	void onConnectionDataChanged();
 
 private:
+	void onPoll() override;
+
+	void startRetrieval();
+
 	void scheduleRetrieval();
 
 	void setInitialized();
 
 	void handleError();
 
+	void acquireSystemPoller();
+
 	Inverter *mInverter;
 	InverterSettings *mSettings;
 	FroniusSolarApi *mSolarApi;
+	SolarApiSystemPoller *mSystemPoller;
 	QTimer *mSettingsTimer;
 	DataProcessor mProcessor;
+	// Last data retrieved from the inverter itself, updated with the power and energy from the
+	// system poller
+	CommonInverterData mCommonData;
+	bool mHasCommonData;
+	// True if the last reply of the system poller contained this inverter
+	bool mInSystemData;
+	int mPollCount;
 	bool mInitialized;
 	int mRetryCount;
 };
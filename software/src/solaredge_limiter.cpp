@@ -1,5 +1,5 @@
 #include "defines.h"
-#include "modbus_tcp_client.h"
+#include "modbus_client.h"
 #include "inverter.h"
 #include "solaredge_limiter.h"
 
@@ -36,7 +36,7 @@ SolarEdgeLimiter::SolarEdgeLimiter(Inverter *parent) :
 {
 }
 
-void SolarEdgeLimiter::onConnected(ModbusTcpClient *client)
+void SolarEdgeLimiter::onConnected(ModbusClient *client)
 {
 	BaseLimiter::onConnected(client);
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
@@ -44,35 +44,38 @@ void SolarEdgeLimiter::onConnected(ModbusTcpClient *client)
 	// If the maximum power was not obtained from model 704, or model 120,
 	// attempt to fetch it from the SolarEdge specific registers.
 	// Always fetch maximum power from the SolarEdge specific float32 register.
-	ModbusReply *reply = client->readHoldingRegisters(deviceInfo.networkId, MaxActivePower, 2);
-	connect(reply, SIGNAL(finished()), this, SLOT(onReadMaxPowerCompleted()));
+	client->readHoldingRegisters(deviceInfo.networkId, MaxActivePower, 2,
+		[this](ModbusReply::ExceptionCode error, const RegisterSpan &words) {
+			onReadMaxPowerCompleted(error, words);
+		});
 }
 
-ModbusReply *SolarEdgeLimiter::writePowerLimit(double powerLimitPct)
+void SolarEdgeLimiter::writePowerLimit(double powerLimitPct, const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId,
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId,
 		DynamicActivePowerLimit,
-		toWords(static_cast<float>(powerLimitPct * 100)));
+		toWords(static_cast<float>(powerLimitPct * 100)), callback);
 }
 
-ModbusReply *SolarEdgeLimiter::resetPowerLimit()
+bool SolarEdgeLimiter::resetPowerLimit(const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 	mInverter->setPowerLimit(deviceInfo.maxPower);
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId,
-		DynamicActivePowerLimit, toWords(PowerLimitDisableValue));
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId,
+		DynamicActivePowerLimit, toWords(PowerLimitDisableValue), callback);
+	return true;
 }
 
-void SolarEdgeLimiter::onReadMaxPowerCompleted()
+void SolarEdgeLimiter::onReadMaxPowerCompleted(ModbusReply::ExceptionCode error,
+											   const RegisterSpan &words)
 {
-	ModbusReply *reply = static_cast<ModbusReply *>(sender());
-	reply->deleteLater();
-	if (reply->error()) {
+	if (error) {
 		emit initialised(false);
 	} else {
-		QVector <quint16> words = reply->registers();
-		double value = static_cast<double>(*reinterpret_cast<float *>(words.data()));
+		float value = 0;
+		if (words.size() == 2)
+			memcpy(&value, words.data(), sizeof(value));
 		if (value > 0) {
 			qInfo() << "Maximum power is" << value << "for SolarEdge Inverter:" << mInverter->location();
 			mInverter->setMaxPower(value);
@@ -93,20 +96,14 @@ void SolarEdgeLimiter::initLimiter()
 	mCommands.append({CommandTimeout,            toWords(static_cast<uint32_t>(120))}); // 2 minutes
 	mCommands.append({EnableDynamicPowerControl, {1}});
 	qInfo() << "Writing EDPC settings to SolarEdge Inverter:" << mInverter->location();
-	writeCommands(true);
+	writeCommands();
 }
 
-void SolarEdgeLimiter::writeCommands(bool firstCommand)
+void SolarEdgeLimiter::writeCommands()
 {
-	if (!firstCommand) {
-		ModbusReply *previousReply = static_cast<ModbusReply *>(sender());
-		previousReply->deleteLater();
-		if (previousReply->error()) {
-			emit initialised(false);
-			return;
-		}
-	}
-
+	// The commands are written one at a time, and the sequence is aborted on the first error.
+	// EnableDynamicPowerControl must never be written if the fallback limit or the command
+	// timeout could not be set.
 	if (mCommands.isEmpty()) {
 		emit initialised(true);
 		return;
@@ -114,7 +111,18 @@ void SolarEdgeLimiter::writeCommands(bool firstCommand)
 
 	auto cmd = mCommands.takeFirst();
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-	ModbusReply *reply = mClient->writeMultipleHoldingRegisters(
-		deviceInfo.networkId, cmd.first, cmd.second);
-	connect(reply, SIGNAL(finished()), this, SLOT(writeCommands()));
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, cmd.first, cmd.second,
+		[this](ModbusReply::ExceptionCode error, const RegisterSpan &) {
+			onCommandCompleted(error);
+		});
+}
+
+void SolarEdgeLimiter::onCommandCompleted(ModbusReply::ExceptionCode error)
+{
+	if (error) {
+		mCommands.clear();
+		emit initialised(false);
+		return;
+	}
+	writeCommands();
 }
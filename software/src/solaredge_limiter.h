@@ -11,20 +11,21 @@ class SolarEdgeLimiter : public BaseLimiter
 public:
 	explicit SolarEdgeLimiter(Inverter *parent);
 
-	void onConnected(ModbusTcpClient *client) override;
+	void onConnected(ModbusClient *client) override;
 
-	ModbusReply *writePowerLimit(double powerLimitPct) override;
+	void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) override;
 
-	ModbusReply *resetPowerLimit() override;
+	bool resetPowerLimit(const ModbusCallback &callback) override;
 
-private slots:
-	void onReadMaxPowerCompleted();
+private:
+	void onReadMaxPowerCompleted(ModbusReply::ExceptionCode error, const RegisterSpan &words);
 
-	void writeCommands(bool firstCommand = false);
+	void onCommandCompleted(ModbusReply::ExceptionCode error);
 
-private:
 	void initLimiter();
 
+	void writeCommands();
+
 	QList<std::pair<uint16_t, QVector<uint16_t>>> mCommands;
 };
 
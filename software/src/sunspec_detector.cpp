@@ -1,10 +1,12 @@
 #include "products.h"
-#include "modbus_tcp_client.h"
+#include "modbus_tcp_channel.h"
 #include "modbus_reply.h"
 #include "sunspec_updater.h"
 #include "sunspec_detector.h"
 #include "sunspec_tools.h"
 
+QHash<QString, SunspecDetector::ModelMap> SunspecDetector::mModelMaps;
+
 SunspecDetector::SunspecDetector(QObject *parent):
 	AbstractDetector(parent),
 	mPort(ModbusTcpClient::DefaultTcpPort),
@@ -31,6 +33,11 @@ DetectorReply *SunspecDetector::start(const QString &hostName, int timeout)
 	return start(hostName, timeout, mPort, mUnitId);
 }
 
+quint16 SunspecDetector::tcpPort() const
+{
+	return static_cast<quint16>(mPort);
+}
+
 DetectorReply *SunspecDetector::start(const QString &hostName, int timeout, int port, quint8 unitId)
 {
 	Q_ASSERT(unitId != 0);
@@ -41,11 +48,13 @@ DetectorReply *SunspecDetector::start(const QString &hostName, int timeout, int
 		return 0;
 	}
 
-	ModbusTcpClient *client = new ModbusTcpClient(this);
+	// Probes of multiple unit IDs on the same device share a single connection, which is handed
+	// over to the updater once an inverter has been found.
+	ModbusTcpChannel *client = ModbusTcpChannel::open(hostName, port, this);
 	connect(client, SIGNAL(connected()), this, SLOT(onConnected()));
 	connect(client, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
 	client->setTimeout(timeout);
-	client->connectToServer(hostName, port);
+	client->connectToServer();
 	Reply *reply = new Reply(this);
 	reply->client = client;
 	reply->di.networkId = unitId;
@@ -55,19 +64,45 @@ DetectorReply *SunspecDetector::start(const QString &hostName, int timeout, int
 	return reply;
 }
 
+void SunspecDetector::invalidateModelMap(const DeviceInfo &deviceInfo)
+{
+	mModelMaps.remove(modelMapKey(deviceInfo.hostName, deviceInfo.modbusPort,
+								  deviceInfo.networkId));
+}
+
 void SunspecDetector::onConnected()
 {
-	ModbusTcpClient *client = static_cast<ModbusTcpClient *>(sender());
+	ModbusTcpChannel *client = static_cast<ModbusTcpChannel *>(sender());
 	Reply *di = mClientToReply.value(client);
 	Q_ASSERT(di != 0);
+	QHash<QString, ModelMap>::const_iterator it =
+		mModelMaps.find(modelMapKey(di->di.hostName, di->di.modbusPort, di->di.networkId));
+	if (it != mModelMaps.end()) {
+		// SunS marker, common model and the header of the next model
+		di->state = Reply::ModelMapCheck;
+		di->currentRegister = it->sunSpecRegister;
+		startNextRequest(di, 2 + it->commonModelSize + 2);
+		return;
+	}
+	startProbes(di);
+}
+
+void SunspecDetector::startProbes(Reply *di)
+{
 	di->state = Reply::SunSpecHeader;
-	di->currentRegister = di->nextSunspecStartRegister();
-	startNextRequest(di, 2);
+	// Probe all candidate locations of the SunSpec header at once. The results are evaluated in
+	// order of preference in onProbeFinished.
+	foreach (quint16 startRegister, di->startRegisters) {
+		ModbusReply *reply = di->client->readHoldingRegisters(di->di.networkId, startRegister, 2);
+		mModbusReplyToReply[reply] = di;
+		connect(reply, SIGNAL(finished()), this, SLOT(onProbeFinished()));
+		di->probes.append(reply);
+	}
 }
 
 void SunspecDetector::onDisconnected()
 {
-	ModbusTcpClient *client = static_cast<ModbusTcpClient *>(sender());
+	ModbusTcpChannel *client = static_cast<ModbusTcpChannel *>(sender());
 	Reply *di = mClientToReply.value(client);
 	if (di != 0)
 		setDone(di);
@@ -79,26 +114,40 @@ void SunspecDetector::onFinished()
 	Reply *di = mModbusReplyToReply.take(reply);
 	reply->deleteLater();
 
-	QVector<quint16> values = reply->registers();
+	RegisterSpan values = reply->registers();
+	if (di->blockPending) {
+		di->blockPending = false;
+		if (reply->error() != ModbusReply::NoException || values.size() < di->pendingCount) {
+			// Some devices refuse to read beyond the end of the model chain, or across
+			// registers they do not support (SMA model 123). Fall back to reading just the
+			// registers we need.
+			di->blockReads = false;
+			startNextRequest(di, di->pendingCount);
+			return;
+		}
+		di->block = values.toVector();
+		di->blockStart = di->currentRegister;
+		values = RegisterSpan(di->block).mid(0, di->pendingCount);
+	}
+	processRegisters(di, values);
+}
 
+void SunspecDetector::processRegisters(Reply *di, const RegisterSpan &values)
+{
 	switch (di->state) {
 	case Reply::SunSpecHeader:
-	{
-		if (values.size() != 2 || getString(values, 0, 2) != "SunS") {
-			// Check the next expected location for a sunspec header
-			quint16 next = di->nextSunspecStartRegister();
-			if (next == 0xFFFF) {
-				setDone(di);
-				return;
-			}
-			di->currentRegister = next;
-			startNextRequest(di, 2);
-			return;
+		// Header probes are handled by onProbeFinished
+		Q_ASSERT(false);
+		break;
+	case Reply::ModelMapCheck:
+		if (checkModelMap(di, values)) {
+			checkDone(di);
+		} else {
+			qInfo() << "SunSpec layout of" << di->di.hostName << "has changed";
+			mModelMaps.remove(modelMapKey(di->di.hostName, di->di.modbusPort, di->di.networkId));
+			startProbes(di);
 		}
-		di->currentRegister += 2;
-		requestNextHeader(di); // Probably model 1
 		break;
-	}
 	case Reply::ModuleHeader:
 	{
 		if (values.size() < 2) {
@@ -113,6 +162,11 @@ void SunspecDetector::onFinished()
 		quint16 modelId = values[0];
 		quint16 modelSize = values[1] + 2;
 		quint16 nextModel = di->currentRegister + modelSize;
+		if (di->nextModelId == 0 && di->commonModelSize > 0 &&
+			di->currentRegister == di->sunSpecRegister + 2 + di->commonModelSize) {
+			di->nextModelId = modelId;
+			di->nextModelSize = values[1];
+		}
 		switch (modelId) {
 		case 1:
 			// SolarEdge breaks the spec by having multiple device definitions
@@ -124,6 +178,8 @@ void SunspecDetector::onFinished()
 				checkDone(di);
 				return;
 			}
+			if (di->currentRegister == di->sunSpecRegister + 2)
+				di->commonModelSize = modelSize;
 			requestNextContent(di, 1, nextModel, modelSize); // Common model
 			return;
 		case 101:
@@ -196,29 +252,7 @@ void SunspecDetector::onFinished()
 		}
 		switch(di->currentModel) {
 		case 1:
-			if (values.size() >= 66) {
-				QString manufacturer = getString(values, 2, 16);
-				if (manufacturer == "Fronius")
-					di->di.productId = VE_PROD_ID_PV_INVERTER_FRONIUS;
-				else if (manufacturer == "SMA")
-					di->di.productId = VE_PROD_ID_PV_INVERTER_SMA;
-				else if ((manufacturer == "ABB") || (manufacturer == "FIMER"))
-					di->di.productId = VE_PROD_ID_PV_INVERTER_ABB;
-				else if (manufacturer.startsWith("SolarEdge"))
-					di->di.productId = VE_PROD_ID_PV_INVERTER_SOLAREDGE;
-				else
-					di->di.productId = VE_PROD_ID_PV_INVERTER_SUNSPEC;
-				QString model = getString(values, 18, 16);
-				di->di.productName = QString("%1 %2").arg(manufacturer).arg(model);
-
-				// Fronius uses 'options' (offset 34) for the data manager version
-				if (di->di.productId == VE_PROD_ID_PV_INVERTER_FRONIUS) {
-					di->di.dataManagerVersion = getString(values, 34, 8);
-				}
-
-				di->di.firmwareVersion = getString(values, 42, 8);
-				di->di.uniqueId = di->di.serialNumber = getString(values, 50, 16);
-			}
+			parseCommonModel(di->di, values);
 			break;
 		case 701: // DERMeasureAC
 			if (values.size() > 2)
@@ -255,12 +289,115 @@ void SunspecDetector::onFinished()
 	}
 }
 
+void SunspecDetector::onProbeFinished()
+{
+	ModbusReply *reply = static_cast<ModbusReply *>(sender());
+	Reply *di = mModbusReplyToReply.value(reply);
+	if (di == 0)
+		return;
+	// A header found at a preferred location wins, so we can only draw conclusions from the
+	// probes at the front of the list.
+	while (!di->probes.isEmpty() && di->probes.first()->isFinished()) {
+		ModbusReply *probe = di->probes.takeFirst();
+		quint16 startRegister = di->startRegisters.takeFirst();
+		mModbusReplyToReply.remove(probe);
+		probe->deleteLater();
+		RegisterSpan values = probe->registers();
+		if (values.size() == 2 && getString(values, 0, 2) == "SunS") {
+			cancelProbes(di);
+			di->sunSpecRegister = startRegister;
+			di->currentRegister = startRegister + 2;
+			requestNextHeader(di); // Probably model 1
+			return;
+		}
+	}
+	if (di->probes.isEmpty())
+		setDone(di);
+}
+
+QString SunspecDetector::modelMapKey(const QString &hostName, int port, quint8 unitId)
+{
+	return QString("%1:%2:%3").arg(hostName).arg(port).arg(unitId);
+}
+
+bool SunspecDetector::checkModelMap(Reply *di, const RegisterSpan &values)
+{
+	QHash<QString, ModelMap>::const_iterator it =
+		mModelMaps.find(modelMapKey(di->di.hostName, di->di.modbusPort, di->di.networkId));
+	if (it == mModelMaps.end())
+		return false;
+	int size = it->commonModelSize;
+	if (values.size() != 2 + size + 2 || getString(values, 0, 2) != "SunS" ||
+		values[2] != 1 || values[3] + 2 != size ||
+		values[2 + size] != it->nextModelId || values[2 + size + 1] != it->nextModelSize)
+		return false;
+	DeviceInfo deviceInfo = it->deviceInfo;
+	parseCommonModel(deviceInfo, values.mid(2, size));
+	if (deviceInfo.serialNumber != it->deviceInfo.serialNumber ||
+		deviceInfo.firmwareVersion != it->deviceInfo.firmwareVersion)
+		return false;
+	di->di = deviceInfo;
+	return true;
+}
+
+void SunspecDetector::storeModelMap(Reply *di)
+{
+	// Without a serial number we cannot tell whether the device has been replaced
+	if (di->di.serialNumber.isEmpty() || di->commonModelSize == 0 || di->nextModelId == 0)
+		return;
+	ModelMap map;
+	map.deviceInfo = di->di;
+	map.sunSpecRegister = di->sunSpecRegister;
+	map.commonModelSize = di->commonModelSize;
+	map.nextModelId = di->nextModelId;
+	map.nextModelSize = di->nextModelSize;
+	mModelMaps.insert(modelMapKey(di->di.hostName, di->di.modbusPort, di->di.networkId), map);
+}
+
+void SunspecDetector::parseCommonModel(DeviceInfo &deviceInfo, const RegisterSpan &values)
+{
+	if (values.size() < 66)
+		return;
+	QString manufacturer = getString(values, 2, 16);
+	if (manufacturer == "Fronius")
+		deviceInfo.productId = VE_PROD_ID_PV_INVERTER_FRONIUS;
+	else if (manufacturer == "SMA")
+		deviceInfo.productId = VE_PROD_ID_PV_INVERTER_SMA;
+	else if ((manufacturer == "ABB") || (manufacturer == "FIMER"))
+		deviceInfo.productId = VE_PROD_ID_PV_INVERTER_ABB;
+	else if (manufacturer.startsWith("SolarEdge"))
+		deviceInfo.productId = VE_PROD_ID_PV_INVERTER_SOLAREDGE;
+	else
+		deviceInfo.productId = VE_PROD_ID_PV_INVERTER_SUNSPEC;
+	QString model = getString(values, 18, 16);
+	deviceInfo.productName = QString("%1 %2").arg(manufacturer).arg(model);
+
+	// Fronius uses 'options' (offset 34) for the data manager version
+	if (deviceInfo.productId == VE_PROD_ID_PV_INVERTER_FRONIUS) {
+		deviceInfo.dataManagerVersion = getString(values, 34, 8);
+	}
+
+	deviceInfo.firmwareVersion = getString(values, 42, 8);
+	deviceInfo.uniqueId = deviceInfo.serialNumber = getString(values, 50, 16);
+}
+
+void SunspecDetector::cancelProbes(Reply *di)
+{
+	foreach (ModbusReply *probe, di->probes) {
+		mModbusReplyToReply.remove(probe);
+		disconnect(probe);
+		probe->deleteLater();
+	}
+	di->probes.clear();
+	di->startRegisters.clear();
+}
+
 void SunspecDetector::requestNextHeader(Reply *di)
 {
 	di->state = Reply::ModuleHeader;
 	di->currentModel = 0;
 	di->nextModelRegister = 0;
-	startNextRequest(di, 2);
+	fetch(di, 2);
 }
 
 void SunspecDetector::requestNextContent(Reply *di, quint16 currentModel, quint16 nextModelRegister, quint16 regCount, quint16 offset)
@@ -269,7 +406,25 @@ void SunspecDetector::requestNextContent(Reply *di, quint16 currentModel, quint1
 	di->currentModel = currentModel; // model being fetched
 	di->nextModelRegister = nextModelRegister;
 	di->currentRegister += offset;
-	startNextRequest(di, regCount);
+	fetch(di, regCount);
+}
+
+void SunspecDetector::fetch(Reply *di, quint16 regCount)
+{
+	int offset = di->currentRegister - di->blockStart;
+	if (offset >= 0 && offset + regCount <= di->block.size()) {
+		processRegisters(di, RegisterSpan(di->block).mid(offset, regCount));
+		return;
+	}
+	int count = qMin(static_cast<int>(BlockSize), 0x10000 - di->currentRegister);
+	if (!di->blockReads || count < regCount) {
+		startNextRequest(di, regCount);
+		return;
+	}
+	// Read ahead, the block will usually contain the next model headers as well
+	di->blockPending = true;
+	di->pendingCount = regCount;
+	startNextRequest(di, count);
 }
 
 void SunspecDetector::startNextRequest(Reply *di, quint16 regCount)
@@ -284,8 +439,10 @@ void SunspecDetector::checkDone(Reply *di)
 {
 	if ( !di->di.productName.isEmpty() && // Model 1 is present
 			di->di.phaseCount > 0 && // Model 1xx present
-			di->di.networkId > 0)
+			di->di.networkId > 0) {
+		storeModelMap(di);
 		di->setResult();
+	}
 	setDone(di);
 }
 
@@ -293,12 +450,25 @@ void SunspecDetector::setDone(Reply *di)
 {
 	if (!mClientToReply.contains(di->client))
 		return;
+	cancelProbes(di);
 	di->setFinished();
 	disconnect(di->client);
 	mClientToReply.remove(di->client);
 	di->client->deleteLater();
 }
 
+void SunspecDetector::cancel(Reply *di)
+{
+	QList<ModbusReply *> pending = mModbusReplyToReply.keys(di);
+	foreach (ModbusReply *reply, pending) {
+		mModbusReplyToReply.remove(reply);
+		disconnect(reply);
+		reply->deleteLater();
+	}
+	di->probes.clear();
+	setDone(di);
+}
+
 SunspecDetector::Reply::Reply(QObject *parent):
 	DetectorReply(parent),
 	client(0),
@@ -306,21 +476,26 @@ SunspecDetector::Reply::Reply(QObject *parent):
 	currentRegister(0),
 	currentModel(0),
 	nextModelRegister(0),
-	startRegisters(QList<quint16>() << 40000 << 50000 << 0)
+	startRegisters(QList<quint16>() << 40000 << 50000 << 0),
+	sunSpecRegister(0),
+	commonModelSize(0),
+	nextModelId(0),
+	nextModelSize(0),
+	blockStart(0),
+	blockReads(true),
+	blockPending(false),
+	pendingCount(0)
 {
 }
 
 void SunspecDetector::Reply::setFinished()
 {
-	startRegisters.clear();
 	emit finished();
 }
 
-quint16 SunspecDetector::Reply::nextSunspecStartRegister()
+void SunspecDetector::Reply::cancel()
 {
-	if (!startRegisters.isEmpty())
-		return startRegisters.takeFirst();
-	return 0xFFFF;
+	static_cast<SunspecDetector *>(parent())->cancel(this);
 }
 
 SunspecDetector::Reply::~Reply()
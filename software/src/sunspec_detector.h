@@ -4,16 +4,21 @@
 #include <QAbstractSocket>
 #include <QHash>
 #include <QList>
+#include <QVector>
 #include "abstract_detector.h"
 #include "defines.h"
 
 class ModbusReply;
-class ModbusTcpClient;
+class ModbusTcpChannel;
+class RegisterSpan;
 
 class SunspecDetector : public AbstractDetector
 {
 	Q_OBJECT
 public:
+	// Maximum number of registers in a single modbus read request
+	static const int BlockSize = 125;
+
 	SunspecDetector(QObject *parent = 0);
 
 	SunspecDetector(quint8 unitId, QObject *parent = 0);
@@ -23,6 +28,14 @@ public:
 	DetectorReply *start(const QString &hostName, int timeout) override;
 	DetectorReply *start(const QString &hostName, int timeout, int port, quint8 unitId);
 
+	quint16 tcpPort() const override;
+
+	/*!
+	 * Forgets the model layout of the device, so it will be detected from scratch the next time.
+	 * Should be called when the layout of the device has changed.
+	 */
+	static void invalidateModelMap(const DeviceInfo &deviceInfo);
+
 private slots:
 	void onConnected();
 
@@ -30,6 +43,8 @@ private slots:
 
 	void onFinished();
 
+	void onProbeFinished();
+
 private:
 	class Reply : public DetectorReply
 	{
@@ -49,34 +64,97 @@ private:
 		}
 
 		void setFinished();
-		quint16 nextSunspecStartRegister();
+
+		void cancel() override;
 
 		enum State {
 			SunSpecHeader,
 			ModuleHeader,
-			ModuleContent
+			ModuleContent,
+			ModelMapCheck
 		};
 
 		DeviceInfo di;
-		ModbusTcpClient *client;
+		ModbusTcpChannel *client;
 		State state;
 		quint16 currentRegister;
 		quint16 currentModel;
 		quint16 nextModelRegister;
 		QList<quint16> startRegisters;
+		QList<ModbusReply *> probes; // SunS probes, same order as startRegisters
+		// Layout information stored in the model map cache
+		quint16 sunSpecRegister;
+		quint16 commonModelSize; // Including the header
+		quint16 nextModelId; // The model following the common model, 0 if unknown
+		quint16 nextModelSize;
+		// Registers read ahead while walking the model chain
+		QVector<quint16> block;
+		quint16 blockStart;
+		bool blockReads; // Cleared when the device refuses a block read
+		bool blockPending;
+		quint16 pendingCount; // Number of registers needed from the pending block read
+	};
+
+	/*!
+	 * The result of an earlier detection. When a device is detected again, the SunSpec header,
+	 * the common model and the header of the next model are read in a single request. If the
+	 * serial number, firmware version and both model headers are unchanged, the remaining
+	 * information is taken from the cache instead of walking the model chain.
+	 */
+	struct ModelMap {
+		ModelMap():
+			sunSpecRegister(0),
+			commonModelSize(0),
+			nextModelId(0),
+			nextModelSize(0)
+		{}
+
+		DeviceInfo deviceInfo;
+		quint16 sunSpecRegister;
+		quint16 commonModelSize;
+		quint16 nextModelId;
+		quint16 nextModelSize;
 	};
 
+	static QString modelMapKey(const QString &hostName, int port, quint8 unitId);
+
+	/*!
+	 * Checks the result of the request sent for a cached model map. Returns true if the map is
+	 * still valid, in which case it is copied into `di`.
+	 */
+	bool checkModelMap(Reply *di, const RegisterSpan &values);
+
+	void storeModelMap(Reply *di);
+
+	static void parseCommonModel(DeviceInfo &deviceInfo, const RegisterSpan &values);
+
+	void startProbes(Reply *di);
+
+	void cancelProbes(Reply *di);
+
 	void requestNextHeader(Reply *di);
 	void requestNextContent(Reply *di, quint16 currentModel, quint16 nextModelRegister, quint16 regCount, quint16 offset = 0);
 	void startNextRequest(Reply *di, quint16 regCount);
 
+	/*!
+	 * Gets `regCount` registers starting at `di->currentRegister` and passes them to
+	 * `processRegisters`. The registers are taken from the last block read if possible, otherwise
+	 * a new block of `BlockSize` registers is read.
+	 */
+	void fetch(Reply *di, quint16 regCount);
+
+	void processRegisters(Reply *di, const RegisterSpan &values);
+
 	void checkDone(Reply *di);
 	void setDone(Reply *di);
 
-	QHash<ModbusTcpClient *, Reply *> mClientToReply;
+	void cancel(Reply *di);
+
+	QHash<ModbusTcpChannel *, Reply *> mClientToReply;
 	QHash<ModbusReply *, Reply *> mModbusReplyToReply;
 	int mPort;
 	quint8 mUnitId;
+	static QHash<QString, ModelMap> mModelMaps;
 };
 
 #endif // SUNSPEC_DETECTOR_H
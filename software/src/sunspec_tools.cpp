@@ -2,7 +2,7 @@
 #include <qnumeric.h>
 #include "sunspec_tools.h"
 
-double getRawValue(const QVector<quint16> &values, int offset, int size)
+double getRawValue(const RegisterSpan &values, int offset, int size)
 {
 	// Convert registers to a 64-bit integer
 	quint64 v = 0;
@@ -11,7 +11,7 @@ double getRawValue(const QVector<quint16> &values, int offset, int size)
 	return v;
 }
 
-double getScaledValue(const QVector<quint16> &values, int offset, int size, int scaleOffset,
+double getScaledValue(const RegisterSpan &values, int offset, int size, int scaleOffset,
 					  bool isSigned)
 {
 	Q_ASSERT(size > 0 && size < 5);
@@ -49,7 +49,7 @@ double getScaledValue(const QVector<quint16> &values, int offset, int size, int
 	return value * scale;
 }
 
-double getFloat(const QVector<quint16> &values, int offset)
+double getFloat(const RegisterSpan &values, int offset)
 {
 	// gcc 5.4 generates warning about strict aliasing when we compute a quint32 and cast its
 	// address to a float pointer. If we use a union instead we do the same thing, but there is
@@ -62,7 +62,7 @@ double getFloat(const QVector<quint16> &values, int offset)
 	return static_cast<double>(vf.f);
 }
 
-QString getString(const QVector<quint16> &values, int offset, int size)
+QString getString(const RegisterSpan &values, int offset, int size)
 {
 	QString result;
 	for (int i=0; i<size; ++i) {
@@ -73,7 +73,7 @@ QString getString(const QVector<quint16> &values, int offset, int size)
 	return result;
 }
 
-double getScale(const QVector<quint16> &values, int offset)
+double getScale(const RegisterSpan &values, int offset)
 {
 	quint16 v = values[offset];
 	if (v == 0x8000)
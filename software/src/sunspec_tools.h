@@ -2,17 +2,17 @@
 #define SUNSPEC_TOOLS_H
 
 #include <QString>
-#include <QVector>
+#include "register_span.h"
 
-double getRawValue(const QVector<quint16> &values, int offset, int size);
+double getRawValue(const RegisterSpan &values, int offset, int size);
 
-double getScaledValue(const QVector<quint16> &values, int offset, int size,
+double getScaledValue(const RegisterSpan &values, int offset, int size,
 					  int scaleOffset, bool isSigned);
 
-double getScale(const QVector<quint16> &values, int offset);
+double getScale(const RegisterSpan &values, int offset);
 
-double getFloat(const QVector<quint16> &values, int offset);
+double getFloat(const RegisterSpan &values, int offset);
 
-QString getString(const QVector<quint16> &values, int offset, int size);
+QString getString(const RegisterSpan &values, int offset, int size);
 
 #endif // SUNSPEC_TOOLS_H
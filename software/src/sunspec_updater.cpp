@@ -1,12 +1,14 @@
+#include <algorithm>
 #include <qnumeric.h>
 #include <QTimer>
 #include "products.h"
 #include "froniussolar_api.h"
 #include "data_processor.h"
 #include "inverter.h"
+#include "sunspec_detector.h"
 #include "sunspec_updater.h"
 #include "inverter_settings.h"
-#include "modbus_tcp_client.h"
+#include "modbus_tcp_channel.h"
 #include "modbus_reply.h"
 #include "power_info.h"
 #include "sunspec_tools.h"
@@ -16,35 +18,43 @@
 // timeout is pretty safe.
 static const int PowerLimitTimeout = 120;
 
+// In fast mode, all registers are read at this interval. The polls in between only read the AC
+// power.
+static const int SlowLaneInterval = 5000;
+
 QList<SunspecUpdater*> SunspecUpdater::mUpdaters;
 
 SunspecUpdater::SunspecUpdater(BaseLimiter *limiter, Inverter *inverter, InverterSettings *settings, QObject *parent):
 	QObject(parent),
 	mInverter(inverter),
 	mSettings(settings),
-	mModbusClient(new ModbusTcpClient(this)),
-	mTimer(new QTimer(this)),
+	mModbusClient(ModbusTcpChannel::open(inverter->hostName(), inverter->modbusPort(), this)),
 	mPowerLimitTimer(new QTimer(this)),
 	mDataProcessor(new DataProcessor(inverter, settings, this)),
+	mPowerRangesPending(0),
+	mPowerRangeMissing(false),
 	mCurrentState(Idle),
-	mPowerLimitPct(1.0),
+	mNextState(Idle),
 	mRetryCount(0),
-	mWritePowerLimitRequested(false),
+	mPendingRequests(0),
+	mCycleFailed(false),
+	mFastMode(false),
 	mLimiter(limiter)
 {
 	Q_ASSERT(inverter != 0);
 	connectModbusClient();
 	mModbusClient->setTimeout(5000);
-	mModbusClient->connectToServer(inverter->hostName(), inverter->modbusPort());
+	mModbusClient->setMaxInFlight(mSettings->modbusMaxInFlight());
+	mModbusClient->connectToServer();
 	connect(
 		mInverter, SIGNAL(powerLimitRequested(double)),
 		this, SLOT(onPowerLimitRequested(double)));
-	mTimer->setSingleShot(true);
-	connect(mTimer, SIGNAL(timeout()), this, SLOT(onTimer()));
 	mPowerLimitTimer->setSingleShot(true);
 	mPowerLimitTimer->setInterval(60000);
 	connect(mPowerLimitTimer, SIGNAL(timeout()), this, SLOT(onPowerLimitExpired()));
 	connect(mSettings, SIGNAL(phaseChanged()), this, SLOT(onPhaseChanged()));
+	connect(mSettings, SIGNAL(modbusMaxInFlightChanged()),
+			this, SLOT(onModbusMaxInFlightChanged()));
 
 	mUpdaters.append(this);
 }
@@ -62,23 +72,37 @@ void SunspecUpdater::startNextAction(ModbusState state)
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 	switch (mCurrentState) {
 	case ReadPowerAndVoltage:
-		readPowerAndVoltage();
-		break;
-	case ReadTrackerData:
-		readHoldingRegisters(deviceInfo.trackerModelOffset + 10,
-			deviceInfo.numberOfTrackers * 20);
-		break;
-	case WritePowerLimit:
-	{
-		if (writePowerLimit(mPowerLimitPct)) {
-			mInverter->setPowerLimit(mPowerLimitPct * deviceInfo.maxPower);
-			mPowerLimitTimer->start();
+		// All requests of a cycle are issued at once. The modbus client decides how many of them
+		// are actually on the wire at the same time. The cycle ends when all replies are in.
+		mNextState = Idle;
+		mCycleFailed = false;
+		// The power limit goes out first, so it does not have to wait for the reads.
+		double powerLimitPct;
+		if (mLimiter != 0 && mLimitStage.takeWrite(&powerLimitPct)) {
+			writePowerLimit(powerLimitPct);
+			mInverter->setPowerLimit(powerLimitPct * deviceInfo.maxPower);
+		}
+		mPlanner.clear();
+		mPowerRegisters.clear();
+		mPowerRangesPending = 0;
+		mPowerRangeMissing = false;
+		if (mPollPolicy.isFastMode() && mSlowLaneClock.isValid() &&
+			mSlowLaneClock.elapsed() < SlowLaneInterval) {
+			readPower();
 		} else {
-			startNextAction(ReadPowerAndVoltage);
+			mSlowLaneClock.start();
+			readPowerAndVoltage();
+			if (deviceInfo.trackerModelOffset > 0) {
+				mPlanner.add(deviceInfo.trackerModelOffset + 10, deviceInfo.numberOfTrackers * 20,
+					[this](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+						onTrackerReadCompleted(error, values);
+					});
+			}
 		}
+		sendPlannedReads();
 		break;
-	}
 	case Idle:
+		mPollPolicy.addPowerSample(mInverter->meanPowerInfo()->power(), deviceInfo.maxPower);
 		startIdleTimer();
 		break;
 	default:
@@ -89,8 +113,15 @@ void SunspecUpdater::startNextAction(ModbusState state)
 
 void SunspecUpdater::startIdleTimer()
 {
-	mTimer->setInterval(mCurrentState == Idle ? 1000 : 5000);
-	mTimer->start();
+	mPollPolicy.setFastModeEnabled(mSettings->fastMode());
+	if (mPollPolicy.isFastMode() != mFastMode) {
+		mFastMode = !mFastMode;
+		qInfo() << "Fast mode" << (mFastMode ? "enabled" : "disabled") << "for"
+				<< mInverter->location();
+	}
+	int interval = mCurrentState == Idle ? mPollPolicy.interval() : 5000;
+	mInverter->setPollInterval(interval);
+	schedulePoll(mInverter->hostName(), interval);
 }
 
 void SunspecUpdater::setInverterState(int sunSpecState)
@@ -99,25 +130,32 @@ void SunspecUpdater::setInverterState(int sunSpecState)
 	switch (sunSpecState) {
 	case SunspecOff:
 		froniusState = 0;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceSleeping);
 		break;
 	case SunspecSleeping:
 	case SunspecShutdown:
 	case SunspecStandby:
 		froniusState = 8;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceSleeping);
 		break;
 	case SunspecStarting:
 		froniusState = 3;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceProducing);
 		break;
 	case SunspecMppt:
 		froniusState = 11;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceProducing);
 		break;
 	case SunspecThrottled:
 		froniusState = 12;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceThrottled);
 		break;
 	case SunspecFault:
 		froniusState = 10;
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceProducing);
 		break;
 	default:
+		mPollPolicy.setDeviceState(PollIntervalPolicy::DeviceUnknown);
 		mInverter->invalidateStatusCode();
 		return;
 	}
@@ -125,24 +163,59 @@ void SunspecUpdater::setInverterState(int sunSpecState)
 }
 
 void SunspecUpdater::readHoldingRegisters(quint16 startRegister, quint16 count)
+{
+	mPlanner.add(startRegister, count,
+		[this](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+			onReadCompleted(error, values);
+		});
+}
+
+void SunspecUpdater::sendPlannedReads()
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-	ModbusReply *reply = mModbusClient->readHoldingRegisters(deviceInfo.networkId, startRegister, count);
-	connect(reply, SIGNAL(finished()), this, SLOT(onReadCompleted()));
+	foreach (const RegisterPlanner::Block &block, mPlanner.plan()) {
+		mModbusClient->readHoldingRegisters(deviceInfo.networkId, block.start, block.count,
+			[this, block](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+				onBlockReadCompleted(block, error, values);
+			});
+		++mPendingRequests;
+	}
 }
 
-bool SunspecUpdater::handleModbusError(ModbusReply *reply)
+void SunspecUpdater::onBlockReadCompleted(const RegisterPlanner::Block &block,
+										  ModbusReply::ExceptionCode error,
+										  const RegisterSpan &values)
 {
-	if (reply->error() == ModbusReply::NoException) {
-		mRetryCount = 0;
-		return true;
+	if (error > 0 && error < ModbusReply::UnsupportedFunction && block.ranges.size() > 1 &&
+		mPlanner.maxGap() >= 0) {
+		// The device rejected the combined read, probably because it covers registers that
+		// cannot be read. Read the ranges separately from now on.
+		qWarning() << "Combined read of" << block.count << "registers at" << block.start
+				   << "failed on" << mInverter->hostName() << "- disabling read merging";
+		mPlanner.setMaxGap(-1);
 	}
-	handleError();
-	return false;
+	RegisterPlanner::dispatch(block, error, values);
+	finishRequest();
+}
+
+void SunspecUpdater::finishRequest()
+{
+	Q_ASSERT(mPendingRequests > 0);
+	if (mPendingRequests > 0)
+		--mPendingRequests;
+	if (mPendingRequests > 0)
+		return;
+	if (mCycleFailed) {
+		handleError();
+		return;
+	}
+	mRetryCount = 0;
+	startNextAction(mNextState);
 }
 
 void SunspecUpdater::handleError()
 {
+	mRegisterCache.clear();
 	++mRetryCount;
 	if (mRetryCount > 5) {
 		mRetryCount = 0;
@@ -153,71 +226,75 @@ void SunspecUpdater::handleError()
 	startIdleTimer();
 }
 
-void SunspecUpdater::onReadCompleted()
+void SunspecUpdater::onReadCompleted(ModbusReply::ExceptionCode error,
+									 const RegisterSpan &values)
 {
-	ModbusReply *reply = static_cast<ModbusReply *>(sender());
-	reply->deleteLater();
-	if (!handleModbusError(reply))
-		return;
-
-	QVector<quint16> values = reply->registers();
-
-	mRetryCount = 0;
-
-	ModbusState nextState = mCurrentState;
-	switch (mCurrentState) {
-	case ReadPowerAndVoltage:
-	{
-		if (values.isEmpty())
-			break;
-
-		if (!parsePowerAndVoltage(values)) {
-			nextState = Idle;
-			break;
-		}
+	if (error != ModbusReply::NoException)
+		mCycleFailed = true;
+	else if (values.isEmpty())
+		mNextState = ReadPowerAndVoltage;
+	else if (!parsePowerAndVoltage(values))
+		mNextState = Idle;
+}
 
-		// If we have tracker data, read it
-		if (mInverter->deviceInfo().trackerModelOffset > 0) {
-			nextState = ReadTrackerData;
-			break;
-		}
+void SunspecUpdater::onPowerReadCompleted(int index, int count,
+										  ModbusReply::ExceptionCode error,
+										  const RegisterSpan &values)
+{
+	if (error != ModbusReply::NoException) {
+		mCycleFailed = true;
+		return;
+	}
+	if (values.size() == count)
+		std::copy(values.begin(), values.end(), mPowerRegisters.begin() + index);
+	else
+		mPowerRangeMissing = true;
+	if (--mPowerRangesPending > 0 || mCycleFailed)
+		return;
+	double power = parsePower(mPowerRangeMissing ? RegisterSpan() : RegisterSpan(mPowerRegisters));
+	if (qIsFinite(power)) {
+		mDataProcessor->processPower(power);
+		// The published power no longer matches the cached registers
+		mRegisterCache.clear();
+	}
+}
 
-		nextState = mWritePowerLimitRequested ? WritePowerLimit : Idle;
-		mWritePowerLimitRequested = false;
-		break;
+void SunspecUpdater::onTrackerReadCompleted(ModbusReply::ExceptionCode error,
+											const RegisterSpan &values)
+{
+	if (error != ModbusReply::NoException) {
+		mCycleFailed = true;
+		return;
 	}
-	case ReadTrackerData:
-	{
-		const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-		if (!values.isEmpty() &&
-			 values.size() == deviceInfo.numberOfTrackers * 20) {
-			for (int i=0; i < deviceInfo.numberOfTrackers; ++i) {
-				double rawVoltage = getRawValue(values, 20 * i + 10, 1);
-				double rawPower = getRawValue(values, 20 * i + 11, 1);
-				// 0xFFFF indicates "not implemented" in SunSpec
-				mInverter->setTrackerVoltage(i,
-					rawVoltage == 0xFFFF ? qQNaN() : rawVoltage * deviceInfo.trackerVoltageScale);
-				mInverter->setTrackerPower(i,
-					rawPower == 0xFFFF ? qQNaN() : rawPower * deviceInfo.trackerPowerScale);
-			}
+
+	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
+	if (!values.isEmpty() &&
+		 values.size() == deviceInfo.numberOfTrackers * 20) {
+		for (int i=0; i < deviceInfo.numberOfTrackers; ++i) {
+			double rawVoltage = getRawValue(values, 20 * i + 10, 1);
+			double rawPower = getRawValue(values, 20 * i + 11, 1);
+			// 0xFFFF indicates "not implemented" in SunSpec
+			mInverter->setTrackerVoltage(i,
+				rawVoltage == 0xFFFF ? qQNaN() : rawVoltage * deviceInfo.trackerVoltageScale);
+			mInverter->setTrackerPower(i,
+				rawPower == 0xFFFF ? qQNaN() : rawPower * deviceInfo.trackerPowerScale);
 		}
-		nextState = mWritePowerLimitRequested ? WritePowerLimit : Idle;
-		mWritePowerLimitRequested = false;
-		break;
 	}
-	default:
-		Q_ASSERT(false);
-		nextState = ReadPowerAndVoltage;
-		break;
-	}
-	startNextAction(nextState);
 }
 
-void SunspecUpdater::onWriteCompleted()
+void SunspecUpdater::onWriteCompleted(ModbusReply::ExceptionCode error)
 {
-	ModbusReply *reply = static_cast<ModbusReply *>(sender());
-	reply->deleteLater();
-	startNextAction(ReadPowerAndVoltage);
+	// A failed write is not a reason to drop the connection. The limit will be sent again
+	// with the next cycle.
+	mLimitStage.onWriteCompleted(error == ModbusReply::NoException);
+	publishPowerLimitStats();
+	finishRequest();
+}
+
+void SunspecUpdater::publishPowerLimitStats()
+{
+	mInverter->setPowerLimitStats(mLimitStage.writeCount(), mLimitStage.suppressedCount(),
+		mLimitStage.writeLatency());
 }
 
 void SunspecUpdater::onPowerLimitRequested(double value)
@@ -226,20 +303,31 @@ void SunspecUpdater::onPowerLimitRequested(double value)
 	// An invalid power limit means that power limiting is not supported. So we ignore the request.
 	if (!qIsFinite(mInverter->powerLimit()))
 		return;
-	mPowerLimitPct = qBound(0.0, value / deviceInfo.maxPower, 1.0);
-	if (mTimer->isActive()) {
-		mTimer->stop();
-		if (mCurrentState == Idle) {
-			startNextAction(WritePowerLimit);
-			return; // Skip setting of mWritePowerLimitRequested
-		}
-		startNextAction(mCurrentState);
+	mLimitStage.setDeadband(mSettings->powerLimitDeadband() / 100);
+	mLimitStage.setMinWriteInterval(mSettings->powerLimitMinInterval());
+	int suppressed = mLimitStage.suppressedCount();
+	mLimitStage.request(qBound(0.0, value / deviceInfo.maxPower, 1.0));
+	mPollPolicy.onPowerLimitRequested();
+	// The limit is reset when the requests stop coming in. Until then, the stage keeps the
+	// limit alive on the inverter, even if the requested value does not change.
+	mPowerLimitTimer->start();
+	if (mLimitStage.suppressedCount() != suppressed) {
+		publishPowerLimitStats();
+		return;
 	}
-	mWritePowerLimitRequested = true;
+	// If a cycle is running, the limit will be sent with the next one. Otherwise start a new
+	// cycle right away, so the limit is sent along with the next read.
+	if (isPollScheduled())
+		schedulePoll(mInverter->hostName(), 0);
 }
 
 void SunspecUpdater::onConnected()
 {
+	// The shared connection may have been restored by another user while we were waiting to
+	// retry.
+	cancelPoll();
+	// The inverter may have dropped the limit while we were not connected
+	mLimitStage.resend();
 	if (mLimiter) {
 		// Make sure no signals survive from last time
 		disconnect(mLimiter, SIGNAL(initialised(bool)), 0, 0);
@@ -284,22 +372,24 @@ void SunspecUpdater::onEnableLimiterChanged()
 		resetPowerLimit();
 		mInverter->setPowerLimit(qQNaN());
 		mPowerLimitTimer->stop(); // Cancel any pending timeouts
+		mLimitStage.reset();
 	}
 }
 
 void SunspecUpdater::onDisconnected()
 {
+	mLimitStage.resend();
 	mCurrentState = ReadPowerAndVoltage;
 	handleError();
 }
 
-void SunspecUpdater::onTimer()
+void SunspecUpdater::onPoll()
 {
-	Q_ASSERT(!mTimer->isActive());
+	mInverter->setPollJitter(pollJitter());
 	if (mModbusClient->isConnected())
-		startNextAction(mCurrentState == Idle ? ReadPowerAndVoltage : mCurrentState);
+		startNextAction(ReadPowerAndVoltage);
 	else
-		mModbusClient->connectToServer(mInverter->hostName());
+		mModbusClient->connectToServer();
 }
 
 void SunspecUpdater::onPowerLimitExpired()
@@ -309,6 +399,7 @@ void SunspecUpdater::onPowerLimitExpired()
 	// full power, or to go to zero.
 	resetPowerLimit();
 	mInverter->setPowerLimit(mInverter->deviceInfo().maxPower);
+	mLimitStage.reset();
 }
 
 void SunspecUpdater::onPhaseChanged()
@@ -318,6 +409,12 @@ void SunspecUpdater::onPhaseChanged()
 	mInverter->l1PowerInfo()->resetValues();
 	mInverter->l2PowerInfo()->resetValues();
 	mInverter->l3PowerInfo()->resetValues();
+	mRegisterCache.clear();
+}
+
+void SunspecUpdater::onModbusMaxInFlightChanged()
+{
+	mModbusClient->setMaxInFlight(mSettings->modbusMaxInFlight());
 }
 
 void SunspecUpdater::connectModbusClient()
@@ -358,12 +455,43 @@ void SunspecUpdater::readPowerAndVoltage()
 		readHoldingRegisters(deviceInfo.inverterModelOffset, 52);
 }
 
+void SunspecUpdater::readPower()
+{
+	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
+	// W and W_SF for integer models, the W float for float models
+	readPowerRegisters(deviceInfo.inverterModelOffset +
+		(deviceInfo.retrievalMode == ProtocolSunSpecFloat ? 22 : 14), 2);
+}
+
+void SunspecUpdater::readPowerRegisters(quint16 startRegister, quint16 count)
+{
+	int index = mPowerRegisters.size();
+	mPowerRegisters.resize(index + count);
+	++mPowerRangesPending;
+	mPlanner.add(startRegister, count,
+		[this, index, count](ModbusReply::ExceptionCode error, const RegisterSpan &values) {
+			onPowerReadCompleted(index, count, error, values);
+		});
+}
+
+double SunspecUpdater::parsePower(const RegisterSpan &values)
+{
+	if (values.size() != 2)
+		return qQNaN();
+	if (mInverter->deviceInfo().retrievalMode == ProtocolSunSpecFloat)
+		return getFloat(values, 0);
+	return getScaledValue(values, 0, 1, 1, true);
+}
+
 bool SunspecUpdater::writePowerLimit(double powerLimitPct)
 {
 	if (!mLimiter)
 		return false;
-	ModbusReply *reply = mLimiter->writePowerLimit(powerLimitPct);
-	connect(reply, SIGNAL(finished()), this, SLOT(onWriteCompleted()));
+	mLimiter->writePowerLimit(powerLimitPct,
+		[this](ModbusReply::ExceptionCode error, const RegisterSpan &) {
+			onWriteCompleted(error);
+		});
+	++mPendingRequests;
 	return true;
 }
 
@@ -372,29 +500,31 @@ bool SunspecUpdater::resetPowerLimit()
 	if (!mLimiter)
 		return false;
 
-	ModbusReply *reply = mLimiter->resetPowerLimit();
-	if (reply == 0)
-		return false;
-
-	connect(reply, SIGNAL(finished()), this, SLOT(onWriteCompleted()));
-	return true;
+	return mLimiter->resetPowerLimit(ModbusCallback());
 }
 
-bool SunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
+bool SunspecUpdater::parsePowerAndVoltage(const RegisterSpan &values)
 {
 	int modelId = values[0];
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 	ProtocolType retrievalMode = modelId > 103 ? ProtocolSunSpecFloat : ProtocolSunSpecIntSf;
 	int phaseCount = modelId % 10;
 	if (retrievalMode != deviceInfo.retrievalMode || phaseCount != deviceInfo.phaseCount) {
+		SunspecDetector::invalidateModelMap(deviceInfo);
 		emit inverterModelChanged();
 		return false; // go to idle
 	}
 	if (deviceInfo.retrievalMode == ProtocolSunSpecFloat) {
 		if (values.size() != 62)
 			return false;
+		// An unchanged block needs no conversion and nothing has to be published
+		if (!mRegisterCache.update(values))
+			return true;
+		bool commonDirty = mRegisterCache.isDirty(2, 2) || mRegisterCache.isDirty(16, 2) ||
+			mRegisterCache.isDirty(22, 2) || mRegisterCache.isDirty(32, 2);
+		bool phasesDirty = mRegisterCache.isDirty(4, 6) || mRegisterCache.isDirty(16, 6);
 		double power = getFloat(values, 22);
-		if (qIsFinite(power)) {
+		if (qIsFinite(power) && (commonDirty || phasesDirty)) {
 			CommonInverterData cid;
 			cid.acCurrent = getFloat(values, 2);
 			cid.acPower = power;
@@ -403,7 +533,8 @@ bool SunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
 			// value (retrieved via the Solar API) we use the value from phase 1.
 			cid.acVoltage = getFloat(values, 16);
 			cid.totalEnergy = getFloat(values, 32);
-			mDataProcessor->process(cid);
+			if (commonDirty)
+				mDataProcessor->process(cid);
 
 			if (deviceInfo.phaseCount > 1) {
 				ThreePhasesInverterData tpid;
@@ -419,18 +550,27 @@ bool SunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
 				// generator. This only makes sense in a split-phase
 				// system. Typical in North America, and fully
 				// supported by Fronius.
-				updateSplitPhase(cid.acPower/2, cid.totalEnergy/2);
+				if (commonDirty)
+					updateSplitPhase(cid.acPower/2, cid.totalEnergy/2);
 			}
 		}
-		setInverterState(values[48]);
+		if (mRegisterCache.isDirty(48))
+			setInverterState(values[48]);
 	} else {
 		if (values.size() != 52)
 			return false;
+		if (!mRegisterCache.update(values))
+			return true;
+		// The scale factors are part of the fields they apply to
+		bool commonDirty = mRegisterCache.isDirty(2) || mRegisterCache.isDirty(6) ||
+			mRegisterCache.isDirty(10) || mRegisterCache.isDirty(13, 3) ||
+			mRegisterCache.isDirty(24, 3);
+		bool phasesDirty = mRegisterCache.isDirty(3, 4) || mRegisterCache.isDirty(10, 4);
 		// In older versions of the Fronius firmware, power value and its scaling were sometimes
 		// 0 even when it was obvious that the value should have been different. It seemed to
 		// be indicating some kind of error situation.
 		double power = getScaledValue(values, 14, 1, 15, true);
-		if (qIsFinite(power)) {
+		if (qIsFinite(power) && (commonDirty || phasesDirty)) {
 			CommonInverterData cid;
 			cid.acCurrent = getScaledValue(values, 2, 1, 6, false);
 			cid.acPower = power;
@@ -439,7 +579,8 @@ bool SunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
 			// value (retrieved via the Solar API) we use the value from phase 1.
 			cid.acVoltage = getScaledValue(values, 10, 1, 13, false);
 			cid.totalEnergy = getScaledValue(values, 24, 2, 26, false);
-			mDataProcessor->process(cid);
+			if (commonDirty)
+				mDataProcessor->process(cid);
 
 			if (deviceInfo.phaseCount > 1) {
 				ThreePhasesInverterData tpid;
@@ -455,10 +596,12 @@ bool SunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
 				// generator. This only makes sense in a split-phase
 				// system. Typical in North America, and fully
 				// supported by Fronius.
-				updateSplitPhase(cid.acPower/2, cid.totalEnergy/2);
+				if (commonDirty)
+					updateSplitPhase(cid.acPower/2, cid.totalEnergy/2);
 			}
 		}
-		setInverterState(values[38]);
+		if (mRegisterCache.isDirty(38))
+			setInverterState(values[38]);
 	}
 	return true;
 }
@@ -476,7 +619,7 @@ FroniusSunspecUpdater::FroniusSunspecUpdater(BaseLimiter *limiter, Inverter *inv
 {
 }
 
-bool FroniusSunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
+bool FroniusSunspecUpdater::parsePowerAndVoltage(const RegisterSpan &values)
 {
 	// Filter data for Fronius inverters that send a frame consisting of all
 	// zeros, with Status=7. By returning true, the register will be fetched
@@ -490,6 +633,16 @@ bool FroniusSunspecUpdater::parsePowerAndVoltage(QVector<quint16> values)
 	return SunspecUpdater::parsePowerAndVoltage(values);
 }
 
+double FroniusSunspecUpdater::parsePower(const RegisterSpan &values)
+{
+	// A null frame (see above) has both W and W_SF set to zero
+	if (inverter()->deviceInfo().retrievalMode == ProtocolSunSpecIntSf &&
+			values.size() == 2 && values[0] == 0 && values[1] == 0)
+		return qQNaN();
+
+	return SunspecUpdater::parsePower(values);
+}
+
 
 // Extended classes for 700-series models, for Sunspec > 2018
 // ==========================================================
@@ -505,10 +658,28 @@ void Sunspec2018Updater::readPowerAndVoltage()
 	readHoldingRegisters(inverter()->deviceInfo().inverterModelOffset, 121);
 }
 
-bool Sunspec2018Updater::parsePowerAndVoltage(QVector<quint16> values)
+void Sunspec2018Updater::readPower()
+{
+	// W is at offset 10, W_SF at 116. The gap is far larger than the planner will bridge, so
+	// these are two single register reads instead of one read of 107 registers. The base class
+	// parses the result like W and W_SF of the integer models.
+	quint16 offset = inverter()->deviceInfo().inverterModelOffset;
+	readPowerRegisters(offset + 10, 1);
+	readPowerRegisters(offset + 116, 1);
+}
+
+bool Sunspec2018Updater::parsePowerAndVoltage(const RegisterSpan &values)
 {
 	if (values.size() != 121)
 		return false;
+	RegisterCache &cache = registerCache();
+	if (!cache.update(values))
+		return true;
+	bool commonDirty = cache.isDirty(10) || cache.isDirty(14) || cache.isDirty(16) ||
+		cache.isDirty(19, 4) || cache.isDirty(113, 2) || cache.isDirty(116) ||
+		cache.isDirty(120);
+	bool phasesDirty = cache.isDirty(45) || cache.isDirty(47) || cache.isDirty(68) ||
+		cache.isDirty(70) || cache.isDirty(91) || cache.isDirty(93) || cache.isDirty(113, 2);
 
 	CommonInverterData cid;
 	cid.acPower = getScaledValue(values, 10, 1, 116, true);
@@ -516,9 +687,10 @@ bool Sunspec2018Updater::parsePowerAndVoltage(QVector<quint16> values)
 	cid.acVoltage = getScaledValue(values, 16, 1, 114, false);
 
 	cid.totalEnergy = getScaledValue(values, 19, 4, 120, false);
-	processor()->process(cid);
+	if (commonDirty)
+		processor()->process(cid);
 
-	if (inverter()->deviceInfo().phaseCount > 1) {
+	if (inverter()->deviceInfo().phaseCount > 1 && (commonDirty || phasesDirty)) {
 		ThreePhasesInverterData tpid;
 		tpid.acCurrentPhase1 = getScaledValue(values, 45, 1, 113, true);
 		tpid.acCurrentPhase2 = getScaledValue(values, 68, 1, 113, true);
@@ -528,13 +700,14 @@ bool Sunspec2018Updater::parsePowerAndVoltage(QVector<quint16> values)
 		tpid.acVoltagePhase2 = getScaledValue(values, 70, 1, 114, false);
 		tpid.acVoltagePhase3 = getScaledValue(values, 93, 1, 114, false);
 		processor()->process(tpid);
-	} else if (settings()->phase() == MultiPhase) {
+	} else if (settings()->phase() == MultiPhase && commonDirty) {
 		// A single phase inverter across phases, in North America.
 		updateSplitPhase(cid.acPower/2, cid.totalEnergy/2);
 	}
 
 	// +1 because 2018 enum is literally off by one from the earlier spec
-	setInverterState(values[4] + 1);
+	if (cache.isDirty(4))
+		setInverterState(values[4] + 1);
 	return true;
 }
 
@@ -544,7 +717,7 @@ BaseLimiter::BaseLimiter(Inverter *parent) :
 {
 }
 
-void BaseLimiter::onConnected(ModbusTcpClient *client)
+void BaseLimiter::onConnected(ModbusClient *client)
 {
 	mClient = client;
 }
@@ -555,7 +728,7 @@ SunspecLimiter::SunspecLimiter(Inverter *parent) :
 {
 }
 
-void SunspecLimiter::onConnected(ModbusTcpClient *client)
+void SunspecLimiter::onConnected(ModbusClient *client)
 {
 	BaseLimiter::onConnected(client);
 
@@ -563,7 +736,7 @@ void SunspecLimiter::onConnected(ModbusTcpClient *client)
 	emit initialised(mInverter->deviceInfo().powerLimitScale > 0);
 }
 
-ModbusReply *SunspecLimiter::writePowerLimit(double powerLimitPct)
+void SunspecLimiter::writePowerLimit(double powerLimitPct, const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 
@@ -574,13 +747,14 @@ ModbusReply *SunspecLimiter::writePowerLimit(double powerLimitPct)
 	values.append(PowerLimitTimeout);
 	values.append(0); // unused
 	values.append(1); // enabled power throttle mode
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 5, values);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 5, values, callback);
 }
 
-ModbusReply *SunspecLimiter::resetPowerLimit()
+bool SunspecLimiter::resetPowerLimit(const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 9, QVector<quint16>() << 0);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 9, QVector<quint16>() << 0, callback);
+	return true;
 }
 
 // Limiter for model 704 (2018 sunspec limiter)
@@ -589,7 +763,7 @@ Sunspec2018Limiter::Sunspec2018Limiter(Inverter *parent) :
 {
 }
 
-void Sunspec2018Limiter::onConnected(ModbusTcpClient *client)
+void Sunspec2018Limiter::onConnected(ModbusClient *client)
 {
 	BaseLimiter::onConnected(client);
 
@@ -597,7 +771,7 @@ void Sunspec2018Limiter::onConnected(ModbusTcpClient *client)
 	emit initialised(mInverter->deviceInfo().powerLimitScale > 0);
 }
 
-ModbusReply *Sunspec2018Limiter::writePowerLimit(double powerLimitPct)
+void Sunspec2018Limiter::writePowerLimit(double powerLimitPct, const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
 
@@ -608,11 +782,12 @@ ModbusReply *Sunspec2018Limiter::writePowerLimit(double powerLimitPct)
 	values.append(0); // WMaxLimPctRvrt, revert to 0%
 	values.append(1); // WMaxLimPctEnaRvrt, enable reverting to 0%
 	values.append(PowerLimitTimeout); // WMaxLimPctRvrtTms
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, values);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, values, callback);
 }
 
-ModbusReply *Sunspec2018Limiter::resetPowerLimit()
+bool Sunspec2018Limiter::resetPowerLimit(const ModbusCallback &callback)
 {
 	const DeviceInfo &deviceInfo = mInverter->deviceInfo();
-	return mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, QVector<quint16>() << 0);
+	mClient->writeMultipleHoldingRegisters(deviceInfo.networkId, deviceInfo.immediateControlOffset + 14, QVector<quint16>() << 0, callback);
+	return true;
 }
@@ -4,17 +4,24 @@
 #include <QObject>
 #include <QList>
 #include <QAbstractSocket>
+#include <QElapsedTimer>
 #include <QString>
+#include "modbus_client.h"
+#include "poll_interval_policy.h"
+#include "poll_scheduler.h"
+#include "power_limit_stage.h"
+#include "register_cache.h"
+#include "register_planner.h"
+#include "register_span.h"
 
 class DataProcessor;
 class Inverter;
 class InverterSettings;
-class ModbusReply;
-class ModbusTcpClient;
+class ModbusTcpChannel;
 class QTimer;
 class BaseLimiter;
 
-class SunspecUpdater: public QObject
+class SunspecUpdater: public QObject, private PollScheduler::Entry
 {
 	Q_OBJECT
 public:
@@ -30,10 +37,6 @@ signals:
 	void inverterModelChanged();
 
 private slots:
-	void onReadCompleted();
-
-	void onWriteCompleted();
-
 	void onPowerLimitRequested(double value);
 
 	void onConnected();
@@ -44,16 +47,28 @@ private slots:
 
 	void onDisconnected();
 
-	void onTimer();
-
 	void onPowerLimitExpired();
 
 	void onPhaseChanged();
 
+	void onModbusMaxInFlightChanged();
+
 protected:
 	virtual void readPowerAndVoltage();
 
-	virtual bool parsePowerAndVoltage(QVector<quint16> values);
+	virtual bool parsePowerAndVoltage(const RegisterSpan &values);
+
+	/*!
+	 * Reads the registers needed for the AC power only. Used by the polls in fast mode.
+	 */
+	virtual void readPower();
+
+	/*!
+	 * Returns the AC power from the registers read by `readPower`, or NaN if the value is not
+	 * available. If `readPower` reads more than one range, `values` contains the registers of
+	 * all ranges, in the order they were added.
+	 */
+	virtual double parsePower(const RegisterSpan &values);
 
 	Inverter *inverter() { return mInverter; }
 
@@ -61,8 +76,23 @@ protected:
 
 	DataProcessor *processor() { return mDataProcessor; }
 
+	/*!
+	 * Last block passed to `parsePowerAndVoltage`, used to publish changed values only.
+	 */
+	RegisterCache &registerCache() { return mRegisterCache; }
+
+	/*!
+	 * Adds a read to the current poll cycle. Reads are combined into as few requests as
+	 * possible by `RegisterPlanner`, the result is passed to `parsePowerAndVoltage`.
+	 */
 	void readHoldingRegisters(quint16 startRegister, quint16 count);
 
+	/*!
+	 * Adds a range needed by `parsePower` to the current poll cycle. May be called more than once
+	 * per cycle, for registers that are too far apart to be read at once.
+	 */
+	void readPowerRegisters(quint16 startRegister, quint16 count);
+
 	void updateSplitPhase(double power, double energy);
 
 	void setInverterState(int sunSpecState);
@@ -70,8 +100,6 @@ protected:
 private:
 	enum ModbusState {
 		ReadPowerAndVoltage,
-		ReadTrackerData,
-		WritePowerLimit,
 		Idle
 	};
 
@@ -86,6 +114,22 @@ private:
 		SunspecStandby = 8
 	};
 
+	void sendPlannedReads();
+
+	void onBlockReadCompleted(const RegisterPlanner::Block &block,
+							  ModbusReply::ExceptionCode error, const RegisterSpan &values);
+
+	void onReadCompleted(ModbusReply::ExceptionCode error, const RegisterSpan &values);
+
+	void onPowerReadCompleted(int index, int count, ModbusReply::ExceptionCode error,
+							  const RegisterSpan &values);
+
+	void onTrackerReadCompleted(ModbusReply::ExceptionCode error, const RegisterSpan &values);
+
+	void onWriteCompleted(ModbusReply::ExceptionCode error);
+
+	void publishPowerLimitStats();
+
 	bool writePowerLimit(double powerLimitPct);
 
 	bool resetPowerLimit();
@@ -96,20 +140,31 @@ private:
 
 	void startIdleTimer();
 
-	bool handleModbusError(ModbusReply *reply);
+	void onPoll() override;
+
+	void finishRequest();
 
 	void handleError();
 
 	Inverter *mInverter;
 	InverterSettings *mSettings;
-	ModbusTcpClient *mModbusClient;
-	QTimer *mTimer;
+	ModbusTcpChannel *mModbusClient;
 	QTimer *mPowerLimitTimer;
 	DataProcessor *mDataProcessor;
+	RegisterPlanner mPlanner;
+	RegisterCache mRegisterCache;
+	QVector<quint16> mPowerRegisters; // Collected by onPowerReadCompleted
+	int mPowerRangesPending;
+	bool mPowerRangeMissing;
+	PollIntervalPolicy mPollPolicy;
+	PowerLimitStage mLimitStage;
+	QElapsedTimer mSlowLaneClock; // Time since all registers have been read
 	ModbusState mCurrentState;
-	double mPowerLimitPct;
+	ModbusState mNextState;
 	int mRetryCount;
-	bool mWritePowerLimitRequested;
+	int mPendingRequests;
+	bool mCycleFailed;
+	bool mFastMode;
 	static QList<SunspecUpdater*> mUpdaters; // to keep track of inverters we have a connection with
 	BaseLimiter *mLimiter;
 };
@@ -120,7 +175,9 @@ class FroniusSunspecUpdater : public SunspecUpdater
 public:
 	explicit FroniusSunspecUpdater(BaseLimiter *limiter, Inverter *inverter, InverterSettings *settings, QObject *parent = 0);
 private:
-	bool parsePowerAndVoltage(QVector<quint16> values) override;
+	bool parsePowerAndVoltage(const RegisterSpan &values) override;
+
+	double parsePower(const RegisterSpan &values) override;
 };
 
 class Sunspec2018Updater : public SunspecUpdater
@@ -131,7 +188,9 @@ public:
 private:
 	void readPowerAndVoltage() override;
 
-	bool parsePowerAndVoltage(QVector<quint16> values) override;
+	bool parsePowerAndVoltage(const RegisterSpan &values) override;
+
+	void readPower() override;
 };
 
 // Limiting functionality
@@ -142,18 +201,21 @@ class BaseLimiter : public QObject
 public:
 	explicit BaseLimiter(Inverter *parent);
 
-	virtual void onConnected(ModbusTcpClient *client);
+	virtual void onConnected(ModbusClient *client);
 
-	virtual ModbusReply *writePowerLimit(double powerLimitPct) = 0;
+	virtual void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) = 0;
 
-	virtual ModbusReply *resetPowerLimit() = 0;
+	/*!
+	 * Returns false if the limiter does not support resetting the power limit.
+	 */
+	virtual bool resetPowerLimit(const ModbusCallback &callback) = 0;
 
 signals:
 	void initialised(bool);
 
 protected:
 	Inverter *mInverter;
-	ModbusTcpClient *mClient;
+	ModbusClient *mClient;
 };
 
 class SunspecLimiter : public BaseLimiter
@@ -162,11 +224,11 @@ class SunspecLimiter : public BaseLimiter
 public:
 	explicit SunspecLimiter(Inverter *parent);
 
-	void onConnected(ModbusTcpClient *client) override;
+	void onConnected(ModbusClient *client) override;
 
-	ModbusReply *writePowerLimit(double powerLimitPct) override;
+	void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) override;
 
-	ModbusReply *resetPowerLimit() override;
+	bool resetPowerLimit(const ModbusCallback &callback) override;
 };
 
 class Sunspec2018Limiter : public BaseLimiter
@@ -175,11 +237,11 @@ class Sunspec2018Limiter : public BaseLimiter
 public:
 	explicit Sunspec2018Limiter(Inverter *parent);
 
-	void onConnected(ModbusTcpClient *client) override;
+	void onConnected(ModbusClient *client) override;
 
-	ModbusReply *writePowerLimit(double powerLimitPct) override;
+	void writePowerLimit(double powerLimitPct, const ModbusCallback &callback) override;
 
-	ModbusReply *resetPowerLimit() override;
+	bool resetPowerLimit(const ModbusCallback &callback) override;
 };
 
 #endif // INVERTER_MODBUS_UPDATER_H
@@ -0,0 +1,104 @@
+#include <QTimer>
+#include "modbus_tcp_transport.h"
+#include "tcp_probe.h"
+
+double TcpProbe::mSmoothedRtt = -1;
+double TcpProbe::mRttVariation = 0;
+
+TcpProbe::TcpProbe(const QString &hostName, const QList<quint16> &ports, QObject *parent):
+	QObject(parent),
+	mHostName(hostName),
+	mPorts(ports),
+	mTimer(new QTimer(this)),
+	mResponseTime(-1),
+	mTimedOutCount(0),
+	mTimeout(0)
+{
+	mTimer->setSingleShot(true);
+	connect(mTimer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+}
+
+void TcpProbe::start()
+{
+	mClock.start();
+	mTimer->start(mTimeout > 0 ? mTimeout : timeout());
+	foreach (quint16 port, mPorts) {
+		// The transport is not modbus specific: it is used here because the native backend
+		// makes opening a lot of connections at once a lot cheaper.
+		ModbusTcpTransport *transport = ModbusTcpTransport::create(this);
+		connect(transport, SIGNAL(connected()), this, SLOT(onConnected()));
+		connect(transport, SIGNAL(errorOccurred(QAbstractSocket::SocketError)),
+				this, SLOT(onError(QAbstractSocket::SocketError)));
+		mPending.insert(transport, port);
+		transport->connectToHost(mHostName, port);
+	}
+}
+
+int TcpProbe::timeout()
+{
+	if (mSmoothedRtt < 0)
+		return InitialTimeout;
+	return qBound(MinTimeout, qRound(mSmoothedRtt + 4 * mRttVariation), MaxTimeout);
+}
+
+void TcpProbe::onConnected()
+{
+	ModbusTcpTransport *transport = static_cast<ModbusTcpTransport *>(sender());
+	if (!mPending.contains(transport))
+		return;
+	addRttSample();
+	mOpenPorts.append(mPending.value(transport));
+	close(transport);
+	checkDone();
+}
+
+void TcpProbe::onError(QAbstractSocket::SocketError error)
+{
+	ModbusTcpTransport *transport = static_cast<ModbusTcpTransport *>(sender());
+	if (!mPending.contains(transport))
+		return;
+	// A refused connection is an answer from the host as well, so it tells us something about
+	// the round trip time.
+	if (error == QAbstractSocket::ConnectionRefusedError)
+		addRttSample();
+	close(transport);
+	checkDone();
+}
+
+void TcpProbe::onTimeout()
+{
+	mTimedOutCount = mPending.size();
+	foreach (ModbusTcpTransport *transport, mPending.keys())
+		close(transport);
+	emit finished();
+}
+
+void TcpProbe::close(ModbusTcpTransport *transport)
+{
+	mPending.remove(transport);
+	disconnect(transport, 0, this, 0);
+	transport->deleteLater();
+}
+
+void TcpProbe::checkDone()
+{
+	if (!mPending.isEmpty())
+		return;
+	mTimer->stop();
+	emit finished();
+}
+
+void TcpProbe::addRttSample()
+{
+	qint64 rtt = mClock.elapsed();
+	if (mResponseTime < 0)
+		mResponseTime = rtt;
+	double sample = static_cast<double>(rtt);
+	if (mSmoothedRtt < 0) {
+		mSmoothedRtt = sample;
+		mRttVariation = sample / 2;
+		return;
+	}
+	mRttVariation = 0.75 * mRttVariation + 0.25 * qAbs(mSmoothedRtt - sample);
+	mSmoothedRtt = 0.875 * mSmoothedRtt + 0.125 * sample;
+}
@@ -0,0 +1,102 @@
+#ifndef TCP_PROBE_H
+#define TCP_PROBE_H
+
+#include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class ModbusTcpTransport;
+class QTimer;
+
+/*!
+ * Checks which of a list of TCP ports accept connections on a host.
+ *
+ * Used as a cheap first stage while scanning the network: most addresses are not in use, or do
+ * not belong to an inverter, and would otherwise keep the (slow) detectors busy until they time
+ * out. All ports are tried at the same time, using a short timeout. The timeout adapts to the
+ * round trip times measured by earlier probes, in the same way as the TCP retransmission
+ * timeout (RFC 6298), so it grows on slow networks.
+ */
+class TcpProbe : public QObject
+{
+	Q_OBJECT
+public:
+	static const int InitialTimeout = 300; // ms
+	static const int MinTimeout = 150; // ms
+	static const int MaxTimeout = 3000; // ms
+
+	TcpProbe(const QString &hostName, const QList<quint16> &ports, QObject *parent = 0);
+
+	/*!
+	 * Sets a fixed timeout in milliseconds, instead of the one based on the round trip times.
+	 */
+	void setTimeout(int timeout)
+	{
+		mTimeout = timeout;
+	}
+
+	void start();
+
+	/*!
+	 * Ports that accepted a connection. Valid after `finished` has been emitted.
+	 */
+	const QList<quint16> &openPorts() const
+	{
+		return mOpenPorts;
+	}
+
+	/*!
+	 * Time until the first response (an accepted or refused connection) in milliseconds, or -1
+	 * if the host did not respond.
+	 */
+	qint64 responseTime() const
+	{
+		return mResponseTime;
+	}
+
+	/*!
+	 * Number of ports that did not respond before the timeout.
+	 */
+	int timedOutCount() const
+	{
+		return mTimedOutCount;
+	}
+
+	/*!
+	 * Timeout used for new probes, based on the round trip times measured so far.
+	 */
+	static int timeout();
+
+signals:
+	void finished();
+
+private slots:
+	void onConnected();
+
+	void onError(QAbstractSocket::SocketError error);
+
+	void onTimeout();
+
+private:
+	void close(ModbusTcpTransport *transport);
+
+	void checkDone();
+
+	void addRttSample();
+
+	QString mHostName;
+	QList<quint16> mPorts;
+	QList<quint16> mOpenPorts;
+	QHash<ModbusTcpTransport *, quint16> mPending;
+	QTimer *mTimer;
+	QElapsedTimer mClock;
+	qint64 mResponseTime;
+	int mTimedOutCount;
+	int mTimeout; // ms, 0 to use `timeout()`
+	static double mSmoothedRtt; // ms, negative if no samples have been taken yet
+	static double mRttVariation; // ms
+};
+
+#endif // TCP_PROBE_H
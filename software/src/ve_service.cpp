@@ -1,12 +1,17 @@
+#include <cmath>
 #include <qnumeric.h>
+#include <QTimer>
 #include "ve_service.h"
 
 VeService::VeService(VeQItem *root, QObject *parent):
 	QObject(parent),
-	mRoot(root)
+	mRoot(root),
+	mHeartbeatTimer(new QTimer(this))
 {
 	Q_ASSERT(mRoot != 0);
 	connect(mRoot, SIGNAL(destroyed()), this, SLOT(onRootDestroyed()));
+	mHeartbeatTimer->setSingleShot(true);
+	connect(mHeartbeatTimer, SIGNAL(timeout()), this, SLOT(onHeartbeat()));
 }
 
 VeService::~VeService()
@@ -33,17 +38,22 @@ void VeService::registerService()
 void VeService::produceDouble(VeQItem *item, double value, int precision, const QString &unit)
 {
 	QVariant v = qIsFinite(value) ? QVariant(value) : QVariant();
-	QString text;
-	if (v.isValid()) {
-		if (precision >= 0) {
-			text.setNum(value, 'f', precision);
-		} else {
-			text.setNum(value);
+	VeProducerItem *producerItem = static_cast<VeProducerItem *>(item);
+	if (producerItem->hasTextFormat(precision, unit)) {
+		if (producerItem->getValue() == v) {
+			producerItem->clearSample();
+			return;
+		}
+		if (!producerItem->isSignificant(v, precision)) {
+			producerItem->setSample(v);
+			addPendingItem(item);
+			return;
 		}
-		if (!text.isEmpty())
-			text += unit;
 	}
-	produceValue(item, v, text);
+	// Set the format first, so the text is up to date when valueChanged is handled
+	producerItem->setTextFormat(precision, unit);
+	producerItem->produceValue(v);
+	producerItem->onPublished();
 }
 
 void VeService::produceValue(VeQItem *item, const QVariant &value)
@@ -57,6 +67,11 @@ void VeService::produceValue(VeQItem *item, const QVariant &value, const QString
 	item->produceText(text);
 }
 
+void VeService::setPublishPolicy(VeQItem *item, const PublishPolicy &policy)
+{
+	static_cast<VeProducerItem *>(item)->setPublishPolicy(policy);
+}
+
 double VeService::getDouble(VeQItem *item) const
 {
 	return getDouble(item, qQNaN());
@@ -64,13 +79,53 @@ double VeService::getDouble(VeQItem *item) const
 
 double VeService::getDouble(VeQItem *item, double defaultValue) const
 {
-	QVariant v = item->getValue();
+	QVariant v = getValue(item);
 	return v.isValid() ? v.toDouble() : defaultValue;
 }
 
+QVariant VeService::getValue(VeQItem *item) const
+{
+	return static_cast<VeProducerItem *>(item)->latestValue();
+}
+
 void VeService::onRootDestroyed()
 {
 	mRoot = 0;
+	mPendingItems.clear();
+	mHeartbeatTimer->stop();
+}
+
+void VeService::onHeartbeat()
+{
+	qint64 next = -1;
+	for (int i=0; i<mPendingItems.size();) {
+		VeProducerItem *item = static_cast<VeProducerItem *>(mPendingItems[i]);
+		if (!item->hasSample()) {
+			mPendingItems.removeAt(i);
+			continue;
+		}
+		qint64 due = item->heartbeatDue();
+		if (due == 0) {
+			item->publishSample();
+			mPendingItems.removeAt(i);
+			continue;
+		}
+		if (next < 0 || due < next)
+			next = due;
+		++i;
+	}
+	if (next >= 0)
+		mHeartbeatTimer->start(static_cast<int>(next));
+}
+
+void VeService::addPendingItem(VeQItem *item)
+{
+	if (!mPendingItems.contains(item))
+		mPendingItems.append(item);
+	// Items may have different heartbeat intervals, so this item may be due before the others
+	qint64 due = static_cast<VeProducerItem *>(item)->heartbeatDue();
+	if (!mHeartbeatTimer->isActive() || due < mHeartbeatTimer->remainingTime())
+		mHeartbeatTimer->start(static_cast<int>(due));
 }
 
 void VeService::removeFromItems(VeQItem *item)
@@ -83,3 +138,60 @@ void VeService::removeFromItems(VeQItem *item)
 		removeFromItems(child);
 	}
 }
+
+QString VeProducerItem::getText(bool force)
+{
+	if (mFormatText && !mTextValid) {
+		QVariant value = getValue();
+		QString text;
+		if (value.isValid()) {
+			double v = value.toDouble();
+			if (mPrecision >= 0) {
+				text.setNum(v, 'f', mPrecision);
+			} else {
+				text.setNum(v);
+			}
+			if (!text.isEmpty())
+				text += mUnit;
+		}
+		mTextValid = true;
+		// Caches the text. Does not go through our own produceText, which would drop the format.
+		VeQItem::produceText(text);
+	}
+	return VeQItem::getText(force);
+}
+
+bool VeProducerItem::isSignificant(const QVariant &value, int precision)
+{
+	QVariant current = getValue();
+	if (current.isValid() != value.isValid() || !value.isValid())
+		return true;
+	if (!mLastPublish.isValid() || mLastPublish.elapsed() >= mPolicy.heartbeatInterval)
+		return true;
+	double v = value.toDouble();
+	double c = current.toDouble();
+	if (mPolicy.roundToPrecision && precision >= 0) {
+		double factor = std::pow(10.0, precision);
+		if (qRound64(v * factor) == qRound64(c * factor))
+			return false;
+	}
+	return qAbs(v - c) >= mPolicy.deadband;
+}
+
+qint64 VeProducerItem::heartbeatDue() const
+{
+	if (!mLastPublish.isValid())
+		return 0;
+	qint64 left = mPolicy.heartbeatInterval - mLastPublish.elapsed();
+	return left > 0 ? left : 0;
+}
+
+void VeProducerItem::publishSample()
+{
+	if (!mHasSample)
+		return;
+	// The format is unchanged, but the cached text is outdated
+	mTextValid = false;
+	produceValue(mSample);
+	onPublished();
+}
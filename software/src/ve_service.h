@@ -1,9 +1,35 @@
 #ifndef VESERVICE_H
 #define VESERVICE_H
 
+#include <QElapsedTimer>
+#include <QList>
 #include <QObject>
 #include <veutil/qt/ve_qitem.hpp>
 
+/*!
+ * Decides which changes of a numeric item are significant enough to be published.
+ */
+struct PublishPolicy
+{
+	static const int DefaultHeartbeatInterval = 10000; // ms
+
+	PublishPolicy():
+		deadband(0),
+		roundToPrecision(false),
+		heartbeatInterval(DefaultHeartbeatInterval)
+	{
+	}
+
+	// Changes smaller than this are not published
+	double deadband;
+	// Only publish changes that are visible at the precision used for the text
+	bool roundToPrecision;
+	// Maximum time a held back value waits before it is published, in milliseconds
+	int heartbeatInterval;
+};
+
+class QTimer;
+
 class VeService: public QObject
 {
 	Q_OBJECT
@@ -39,13 +65,30 @@ protected:
 
 	double getDouble(VeQItem *item, double defaultValue) const;
 
+	QVariant getValue(VeQItem *item) const;
+
+	/*!
+	 * Sets the policy for values published with `produceDouble`. Changes that are not significant
+	 * according to the policy are held back, and published by a timer `heartbeatInterval` after
+	 * the last update of the item, unless a later change was significant. Changes from or to an
+	 * invalid value are always published. Values read with `getDouble` are the latest values
+	 * produced, including the ones held back.
+	 */
+	void setPublishPolicy(VeQItem *item, const PublishPolicy &policy);
+
 private slots:
 	void onRootDestroyed();
 
+	void onHeartbeat();
+
 private:
 	void removeFromItems(VeQItem *parent);
 
+	void addPendingItem(VeQItem *item);
+
 	VeQItem *mRoot;
+	QTimer *mHeartbeatTimer;
+	QList<VeQItem *> mPendingItems; // Items with a value that has not been published yet
 };
 
 class VeProducerItem : public VeQItem
@@ -54,7 +97,11 @@ class VeProducerItem : public VeQItem
 public:
 	explicit VeProducerItem(VeQItemProducer *producer, QObject *parent = 0):
 		VeQItem(producer, parent),
-		mService(0)
+		mService(0),
+		mPrecision(0),
+		mFormatText(false),
+		mTextValid(false),
+		mHasSample(false)
 	{
 	}
 
@@ -70,6 +117,61 @@ public:
 			mService = 0;
 	}
 
+	void setPublishPolicy(const PublishPolicy &policy)
+	{
+		mPolicy = policy;
+	}
+
+	/*!
+	 * Returns true if `value` differs enough from the current value to be published, given the
+	 * publish policy and the precision of the text.
+	 */
+	bool isSignificant(const QVariant &value, int precision);
+
+	void onPublished()
+	{
+		mLastPublish.start();
+		clearSample();
+	}
+
+	void clearSample()
+	{
+		mSample = QVariant();
+		mHasSample = false;
+	}
+
+	/*!
+	 * Stores a value that was not published because it was not significant.
+	 */
+	void setSample(const QVariant &value)
+	{
+		mSample = value;
+		mHasSample = true;
+	}
+
+	bool hasSample() const
+	{
+		return mHasSample;
+	}
+
+	/*!
+	 * Returns the time left until the held back value must be published, in milliseconds.
+	 */
+	qint64 heartbeatDue() const;
+
+	/*!
+	 * Publishes the value stored with `setSample`.
+	 */
+	void publishSample();
+
+	/*!
+	 * Returns the last value produced, whether it has been published or not.
+	 */
+	QVariant latestValue()
+	{
+		return mHasSample ? mSample : getValue();
+	}
+
 	int setValue(QVariant const &value) override
 	{
 		if (mService == 0)
@@ -77,8 +179,46 @@ public:
 		return mService->handleSetValue(this, value);
 	}
 
+	/*!
+	 * Returns true if the text is created from the value, with `precision` decimals followed by
+	 * `unit`.
+	 */
+	bool hasTextFormat(int precision, const QString &unit) const
+	{
+		return mFormatText && mPrecision == precision && mUnit == unit;
+	}
+
+	/*!
+	 * Creates the text from the value when it is first asked for, instead of storing a text with
+	 * every value. A negative precision gives all significant digits. An invalid value has an
+	 * empty text. The format applies until `produceText` is called.
+	 */
+	void setTextFormat(int precision, const QString &unit)
+	{
+		mPrecision = precision;
+		mUnit = unit;
+		mFormatText = true;
+		mTextValid = false;
+	}
+
+	QString getText(bool force = false) override;
+
+	void produceText(QString text, State state = Synchronized) override
+	{
+		mFormatText = false;
+		VeQItem::produceText(text, state);
+	}
+
 private:
 	VeService *mService;
+	int mPrecision;
+	QString mUnit;
+	bool mFormatText;
+	bool mTextValid;
+	PublishPolicy mPolicy;
+	QElapsedTimer mLastPublish;
+	QVariant mSample;
+	bool mHasSample;
 };
 
 class VeProducer: public VeQItemProducer
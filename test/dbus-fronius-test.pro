@@ -36,7 +36,8 @@ INCLUDEPATH += \
     $$EXTDIR/googletest/include \
     $$EXTDIR/googletest \
     $$EXTDIR/qthttp/src/qhttp \
-    $$SRCDIR
+    $$SRCDIR \
+    $$SRCDIR/modbus_tcp_client
 
 HEADERS += \
     $$SRCDIR/froniussolar_api.h \
@@ -47,6 +48,24 @@ HEADERS += \
     $$SRCDIR/fronius_device_info.h \
     $$SRCDIR/ve_qitem_consumer.h \
     $$SRCDIR/ve_service.h \
+    $$SRCDIR/register_planner.h \
+    $$SRCDIR/scan_concurrency.h \
+    $$SRCDIR/power_limit_stage.h \
+    $$SRCDIR/scan_cache.h \
+    $$SRCDIR/device_info_store.h \
+    $$SRCDIR/register_cache.h \
+    $$SRCDIR/poll_interval_policy.h \
+    $$SRCDIR/poll_scheduler.h \
+    $$SRCDIR/modbus_tcp_client/timer_wheel.h \
+    $$SRCDIR/modbus_tcp_client/ring_buffer.h \
+    $$SRCDIR/modbus_tcp_client/register_span.h \
+    $$SRCDIR/modbus_tcp_client/modbus_client.h \
+    $$SRCDIR/modbus_tcp_client/modbus_reply.h \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_client.h \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_transport.h \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_channel.h \
+    $$SRCDIR/modbus_tcp_client/modbus_io_thread.h \
+    $$SRCDIR/modbus_tcp_client/spsc_queue.h \
     src/fronius_solar_api_test.h \
     src/test_helper.h \
     src/dbus_inverter_bridge_test.h \
@@ -61,12 +80,41 @@ SOURCES += \
     $$SRCDIR/fronius_device_info.cpp \
     $$SRCDIR/ve_qitem_consumer.cpp \
     $$SRCDIR/ve_service.cpp \
+    $$SRCDIR/register_planner.cpp \
+    $$SRCDIR/scan_concurrency.cpp \
+    $$SRCDIR/power_limit_stage.cpp \
+    $$SRCDIR/scan_cache.cpp \
+    $$SRCDIR/device_info_store.cpp \
+    $$SRCDIR/register_cache.cpp \
+    $$SRCDIR/poll_interval_policy.cpp \
+    $$SRCDIR/poll_scheduler.cpp \
+    $$SRCDIR/modbus_tcp_client/timer_wheel.cpp \
+    $$SRCDIR/modbus_tcp_client/ring_buffer.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_client.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_reply.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_client.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_transport.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_tcp_channel.cpp \
+    $$SRCDIR/modbus_tcp_client/modbus_io_thread.cpp \
     $$EXTDIR/googletest/src/gtest-all.cc \
     src/main.cpp \
     src/dbus_inverter_bridge_test.cpp \
     src/fronius_solar_api_test.cpp \
     src/test_helper.cpp \
-    src/data_processor_test.cpp
+    src/data_processor_test.cpp \
+    src/register_planner_test.cpp \
+    src/scan_concurrency_test.cpp \
+    src/ve_service_test.cpp \
+    src/power_limit_stage_test.cpp \
+    src/scan_cache_test.cpp \
+    src/device_info_store_test.cpp \
+    src/register_cache_test.cpp \
+    src/poll_interval_policy_test.cpp \
+    src/poll_scheduler_test.cpp \
+    src/timer_wheel_test.cpp \
+    src/ring_buffer_test.cpp \
+    src/modbus_io_thread_test.cpp \
+    src/modbus_tcp_client_test.cpp
 
 OTHER_FILES += \
     src/fronius_sim/app.py \
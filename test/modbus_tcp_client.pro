@@ -41,8 +41,12 @@ HEADERS += \
     $$CLIENTDIR/crc16.h \
     $$CLIENTDIR/modbus_client.h \
     $$CLIENTDIR/modbus_tcp_client.h \
+    $$CLIENTDIR/modbus_tcp_transport.h \
     $$CLIENTDIR/modbus_reply.h \
     $$CLIENTDIR/modbus_rtu_client.h \
+    $$CLIENTDIR/register_span.h \
+    $$CLIENTDIR/ring_buffer.h \
+    $$CLIENTDIR/timer_wheel.h \
     $$APPDIR/app.h \
     $$APPDIR/arguments.h
 
@@ -54,8 +58,11 @@ SOURCES += \
     $$CLIENTDIR/crc16.cpp \
     $$CLIENTDIR/modbus_client.cpp \
     $$CLIENTDIR/modbus_tcp_client.cpp \
+    $$CLIENTDIR/modbus_tcp_transport.cpp \
     $$CLIENTDIR/modbus_reply.cpp \
     $$CLIENTDIR/modbus_rtu_client.cpp \
+    $$CLIENTDIR/ring_buffer.cpp \
+    $$CLIENTDIR/timer_wheel.cpp \
     $$APPDIR/app.cpp \
     $$APPDIR/arguments.cpp \
     $$APPDIR/main.cpp
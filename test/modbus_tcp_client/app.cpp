@@ -1,11 +1,30 @@
 #include <QTextStream>
+#include <time.h>
 #include "modbus_tcp_client/modbus_rtu_client.h"
 #include "modbus_tcp_client/modbus_tcp_client.h"
 #include "app.h"
 #include "arguments.h"
 
+static qint64 cpuTime()
+{
+	// Process CPU time in milliseconds
+	return static_cast<qint64>(clock()) * 1000 / CLOCKS_PER_SEC;
+}
+
 App::App(int &argc, char **argv):
-	QCoreApplication(argc, argv)
+	QCoreApplication(argc, argv),
+	mClient(0),
+	mRegister(0),
+	mUnitId(0),
+	mCount(1),
+	mWrite(false),
+	mValue(0),
+	mPort(502),
+	mTimeout(1000),
+	mBenchmarkCount(0),
+	mConnectionCount(1),
+	mCpuStart(0),
+	mFailures(0)
 {
 }
 
@@ -20,6 +39,9 @@ int App::parseOptions()
 	args.addArg("-u", "Unit ID");
 	args.addArg("-w", "Write to register");
 	args.addArg("-o", "Timeout (ms)");
+	args.addArg("-n", "Use native sockets instead of QTcpSocket");
+	args.addArg("-b", "Benchmark: number of reads per connection, using both socket backends");
+	args.addArg("-k", "Benchmark: number of concurrent connections");
 	args.addArg("-h", "Help");
 
 	if (args.contains("h")) {
@@ -57,6 +79,20 @@ int App::parseOptions()
 	if (args.contains("d"))
 		serialPort = args.value("d");
 
+	if (args.contains("n"))
+		ModbusTcpTransport::setDefaultBackend(ModbusTcpTransport::NativeBackend);
+
+	if (args.contains("b")) {
+		mServer = server;
+		mPort = port;
+		mTimeout = timeout;
+		mBenchmarkCount = qMax(1, args.value("b").toInt());
+		mConnectionCount = qMax(1, args.value("k").toInt());
+		mBackends << ModbusTcpTransport::QtBackend << ModbusTcpTransport::NativeBackend;
+		startBenchmark();
+		return 0;
+	}
+
 	if (serialPort.isEmpty()) {
 		ModbusTcpClient *client = new ModbusTcpClient(this);
 		connect(client, SIGNAL(connected()), this, SLOT(onConnected()));
@@ -89,3 +125,86 @@ void App::onFinished()
 	out << *reply << endl;
 	quit();
 }
+
+void App::onBenchmarkConnected()
+{
+	sendBenchmarkRequest(static_cast<ModbusTcpClient *>(sender()));
+}
+
+void App::onBenchmarkDisconnected()
+{
+	ModbusTcpClient *client = static_cast<ModbusTcpClient *>(sender());
+	if (!mRemaining.contains(client))
+		return;
+	mFailures += mRemaining.value(client);
+	finishBenchmarkClient(client);
+}
+
+void App::startBenchmark()
+{
+	ModbusTcpTransport::setDefaultBackend(mBackends.first());
+	mFailures = 0;
+	mClock.start();
+	mCpuStart = cpuTime();
+	for (int i=0; i<mConnectionCount; ++i) {
+		ModbusTcpClient *client = new ModbusTcpClient(this);
+		client->setTimeout(mTimeout);
+		connect(client, SIGNAL(connected()), this, SLOT(onBenchmarkConnected()));
+		connect(client, SIGNAL(disconnected()), this, SLOT(onBenchmarkDisconnected()));
+		mRemaining.insert(client, mBenchmarkCount);
+		client->connectToServer(mServer, mPort);
+	}
+}
+
+void App::sendBenchmarkRequest(ModbusTcpClient *client)
+{
+	client->readHoldingRegisters(mUnitId, mRegister, mCount,
+		[this, client](ModbusReply::ExceptionCode error, const RegisterSpan &) {
+			onBenchmarkReply(client, error);
+		});
+}
+
+void App::onBenchmarkReply(ModbusTcpClient *client, ModbusReply::ExceptionCode error)
+{
+	if (!mRemaining.contains(client))
+		return;
+	int &remaining = mRemaining[client];
+	--remaining;
+	if (error != ModbusReply::NoException) {
+		++mFailures;
+		if (error == ModbusReply::TcpError) {
+			mFailures += remaining;
+			remaining = 0;
+		}
+	}
+	if (remaining > 0)
+		sendBenchmarkRequest(client);
+	else
+		finishBenchmarkClient(client);
+}
+
+void App::finishBenchmarkClient(ModbusTcpClient *client)
+{
+	mRemaining.remove(client);
+	disconnect(client, 0, this, 0);
+	client->deleteLater();
+	if (mRemaining.isEmpty())
+		reportBenchmark();
+}
+
+void App::reportBenchmark()
+{
+	qint64 elapsed = qMax<qint64>(1, mClock.elapsed());
+	qint64 cpu = cpuTime() - mCpuStart;
+	int requests = mBenchmarkCount * mConnectionCount - mFailures;
+	QTextStream out(stdout);
+	out << (mBackends.first() == ModbusTcpTransport::NativeBackend ? "native" : "qt") << ": "
+		<< requests << " requests in " << elapsed << " ms ("
+		<< requests * 1000 / elapsed << " requests/s), CPU time " << cpu << " ms, "
+		<< mFailures << " failed" << endl;
+	mBackends.removeFirst();
+	if (mBackends.isEmpty())
+		quit();
+	else
+		startBenchmark();
+}
@@ -2,8 +2,13 @@
 #define APP_H
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include "modbus_tcp_client/modbus_reply.h"
+#include "modbus_tcp_client/modbus_tcp_transport.h"
 
 class ModbusClient;
+class ModbusTcpClient;
 
 class App: public QCoreApplication
 {
@@ -18,13 +23,38 @@ private slots:
 
 	void onFinished();
 
+	void onBenchmarkConnected();
+
+	void onBenchmarkDisconnected();
+
 private:
+	void startBenchmark();
+
+	void sendBenchmarkRequest(ModbusTcpClient *client);
+
+	void onBenchmarkReply(ModbusTcpClient *client, ModbusReply::ExceptionCode error);
+
+	void finishBenchmarkClient(ModbusTcpClient *client);
+
+	void reportBenchmark();
+
 	ModbusClient *mClient;
 	quint16 mRegister;
 	quint8 mUnitId;
 	quint16 mCount;
 	bool mWrite;
 	quint16 mValue;
+	// Benchmark: each of the connections sends `mBenchmarkCount` requests, once for every backend
+	QString mServer;
+	quint16 mPort;
+	int mTimeout;
+	int mBenchmarkCount;
+	int mConnectionCount;
+	QList<ModbusTcpTransport::Backend> mBackends;
+	QHash<ModbusTcpClient *, int> mRemaining;
+	QElapsedTimer mClock;
+	qint64 mCpuStart;
+	int mFailures;
 };
 
 #endif // APP_H
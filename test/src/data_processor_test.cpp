@@ -227,6 +227,48 @@ TEST_F(DataProcessorTest, ThreePhaseMultiple)
 	}
 }
 
+TEST_F(DataProcessorTest, ProcessPowerThreePhase)
+{
+	setUpProcessor(MultiPhase);
+
+	CommonInverterData data;
+	data.acPower = 600;
+	data.totalEnergy = 0;
+	mProcessor->process(data);
+
+	ThreePhasesInverterData tpd;
+	tpd.acCurrentPhase1 = 1;
+	tpd.acVoltagePhase1 = 200;
+	tpd.acCurrentPhase2 = 1;
+	tpd.acVoltagePhase2 = 200;
+	tpd.acCurrentPhase3 = 2;
+	tpd.acVoltagePhase3 = 200;
+	mProcessor->process(tpd);
+
+	// The phase powers are scaled along with the total power
+	mProcessor->processPower(1200);
+	EXPECT_FLOAT_EQ(1200, mInverter->meanPowerInfo()->power());
+	EXPECT_FLOAT_EQ(300, mInverter->l1PowerInfo()->power());
+	EXPECT_FLOAT_EQ(300, mInverter->l2PowerInfo()->power());
+	EXPECT_FLOAT_EQ(600, mInverter->l3PowerInfo()->power());
+}
+
+TEST_F(DataProcessorTest, ProcessPowerSplitPhase)
+{
+	// Single phase inverter, configured across two phases
+	setUpProcessor(MultiPhase, 1);
+
+	mProcessor->processPower(1000);
+	EXPECT_FLOAT_EQ(1000, mInverter->meanPowerInfo()->power());
+	EXPECT_FLOAT_EQ(500, mInverter->l1PowerInfo()->power());
+	EXPECT_FLOAT_EQ(500, mInverter->l2PowerInfo()->power());
+	EXPECT_NAN(mInverter->l3PowerInfo()->power());
+
+	mProcessor->processPower(400);
+	EXPECT_FLOAT_EQ(200, mInverter->l1PowerInfo()->power());
+	EXPECT_FLOAT_EQ(200, mInverter->l2PowerInfo()->power());
+}
+
 void DataProcessorTest::SetUp()
 {
 }
@@ -240,12 +282,14 @@ void DataProcessorTest::TearDown()
 	mItemSubscriber.reset();
 }
 
-void DataProcessorTest::setUpProcessor(InverterPhase phase)
+void DataProcessorTest::setUpProcessor(InverterPhase phase, int phaseCount)
 {
 	mItemProducer.reset(new VeProducer(VeQItems::getRoot(), "pub"));
 	mItemSubscriber.reset(new VeQItemProducer(VeQItems::getRoot(), "sub"));
 	DeviceInfo deviceInfo;
-	deviceInfo.phaseCount = phase == MultiPhase ? 3 : 1;
+	if (phaseCount == 0)
+		phaseCount = phase == MultiPhase ? 3 : 1;
+	deviceInfo.phaseCount = phaseCount;
 	deviceInfo.hostName = "10.0.1.4";
 	deviceInfo.port = 80;
 	deviceInfo.uniqueId = "756";
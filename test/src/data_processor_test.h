@@ -17,7 +17,10 @@ protected:
 
 	virtual void TearDown();
 
-	void setUpProcessor(InverterPhase phase);
+	/*!
+	 * If `phaseCount` is 0, the inverter has 3 phases if `phase` is MultiPhase, 1 otherwise.
+	 */
+	void setUpProcessor(InverterPhase phase, int phaseCount = 0);
 
 	QScopedPointer<Inverter> mInverter;
 	QScopedPointer<InverterSettings> mSettings;
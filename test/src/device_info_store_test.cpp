@@ -0,0 +1,103 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include <qnumeric.h>
+#include <QTemporaryDir>
+#include "device_info_store.h"
+
+#define EXPECT_NAN(x) EXPECT_TRUE(std::isnan(x))
+
+static DeviceInfo sunspecInverter(const QString &uniqueId, const QString &hostName)
+{
+	DeviceInfo deviceInfo;
+	deviceInfo.hostName = hostName;
+	deviceInfo.uniqueId = uniqueId;
+	deviceInfo.productName = "Fronius Symo 8.2-3-M";
+	deviceInfo.firmwareVersion = "1.2.3";
+	deviceInfo.serialNumber = "12345678";
+	deviceInfo.modbusPort = 502;
+	deviceInfo.networkId = 1;
+	deviceInfo.phaseCount = 3;
+	deviceInfo.productId = 0xA142;
+	deviceInfo.retrievalMode = ProtocolSunSpecIntSf;
+	deviceInfo.inverterModelOffset = 40070;
+	deviceInfo.inverterModel = 103;
+	deviceInfo.immediateControlOffset = 40232;
+	deviceInfo.immediateControlModel = 123;
+	deviceInfo.powerLimitScale = 100;
+	deviceInfo.trackerVoltageScale = qQNaN();
+	deviceInfo.trackerPowerScale = qQNaN();
+	deviceInfo.maxPower = 8200;
+	deviceInfo.storageCapacity = qQNaN();
+	return deviceInfo;
+}
+
+TEST(DeviceInfoStoreTest, JsonRoundTrip)
+{
+	DeviceInfo deviceInfo = sunspecInverter("Fronius_12345678", "192.168.1.20");
+	DeviceInfo result = DeviceInfoStore::fromJson(DeviceInfoStore::toJson(deviceInfo));
+
+	EXPECT_EQ(deviceInfo.hostName, result.hostName);
+	EXPECT_EQ(deviceInfo.uniqueId, result.uniqueId);
+	EXPECT_EQ(deviceInfo.productName, result.productName);
+	EXPECT_EQ(deviceInfo.firmwareVersion, result.firmwareVersion);
+	EXPECT_EQ(deviceInfo.serialNumber, result.serialNumber);
+	EXPECT_EQ(deviceInfo.modbusPort, result.modbusPort);
+	EXPECT_EQ(deviceInfo.networkId, result.networkId);
+	EXPECT_EQ(deviceInfo.phaseCount, result.phaseCount);
+	EXPECT_EQ(deviceInfo.productId, result.productId);
+	EXPECT_EQ(deviceInfo.retrievalMode, result.retrievalMode);
+	EXPECT_EQ(deviceInfo.inverterModelOffset, result.inverterModelOffset);
+	EXPECT_EQ(deviceInfo.immediateControlModel, result.immediateControlModel);
+	EXPECT_EQ(100, result.powerLimitScale);
+	EXPECT_EQ(8200, result.maxPower);
+	EXPECT_NAN(result.trackerVoltageScale);
+	EXPECT_NAN(result.trackerPowerScale);
+	EXPECT_NAN(result.storageCapacity);
+	EXPECT_TRUE(DeviceInfoStore::isSameLayout(deviceInfo, result));
+	// NaN is stored as null, so the same information gives the same object
+	EXPECT_TRUE(DeviceInfoStore::toJson(result) == DeviceInfoStore::toJson(deviceInfo));
+}
+
+TEST(DeviceInfoStoreTest, SaveLoadRoundTrip)
+{
+	QTemporaryDir dir;
+	QString fileName = dir.filePath("inverters.json");
+	DeviceInfoStore store(fileName);
+	store.setDevice(sunspecInverter("Fronius_12345678", "192.168.1.20"));
+	store.setDevice(sunspecInverter("Fronius_87654321", "192.168.1.21"));
+	store.save();
+
+	DeviceInfoStore loaded(fileName);
+	loaded.load();
+	QList<DeviceInfo> devices = loaded.devices();
+	ASSERT_EQ(2, devices.size());
+	foreach (const DeviceInfo &d, devices) {
+		EXPECT_TRUE(DeviceInfoStore::isSameLayout(sunspecInverter(d.uniqueId, d.hostName), d));
+		EXPECT_NAN(d.storageCapacity);
+	}
+}
+
+TEST(DeviceInfoStoreTest, OtherInverterAtSameAddress)
+{
+	DeviceInfoStore store(QString("/nonexistent/inverters.json"));
+	store.setDevice(sunspecInverter("Fronius_12345678", "192.168.1.20"));
+	store.setDevice(sunspecInverter("Fronius_87654321", "192.168.1.20"));
+	QList<DeviceInfo> devices = store.devices();
+	ASSERT_EQ(1, devices.size());
+	EXPECT_EQ(QString("Fronius_87654321"), devices.first().uniqueId);
+}
+
+TEST(DeviceInfoStoreTest, Remove)
+{
+	QTemporaryDir dir;
+	QString fileName = dir.filePath("inverters.json");
+	DeviceInfoStore store(fileName);
+	store.setDevice(sunspecInverter("Fronius_12345678", "192.168.1.20"));
+	store.save();
+	store.remove("Fronius_12345678");
+	store.save();
+
+	DeviceInfoStore loaded(fileName);
+	loaded.load();
+	EXPECT_TRUE(loaded.devices().isEmpty());
+}
@@ -139,10 +139,10 @@ def get_inverter_realtime_data():
 			'Head': create_head({'Scope': scope}),
 			'Body': {
 				'Data': {
-					'PAC': {'Value': 3373, 'Unit': 'W'},
-					'DAY_ENERGY': {'Value': 8000, 'Unit': 'Wh'},
-					'YEAR_ENERGY': {'Value': 44000, 'Unit': 'Wh'},
-					'TOTAL_ENERGY': {'Value': 45000, 'Unit': 'Wh'}}}}
+					'PAC': {'Unit': 'W', 'Values': {i.id: i.main.power for i in inverters}},
+					'DAY_ENERGY': {'Unit': 'Wh', 'Values': {i.id: 8000 for i in inverters}},
+					'YEAR_ENERGY': {'Unit': 'Wh', 'Values': {i.id: 44000 for i in inverters}},
+					'TOTAL_ENERGY': {'Unit': 'Wh', 'Values': {i.id: i.main.energy for i in inverters}}}}}
 	else:
 		raise Exception('Unknown scope')
 
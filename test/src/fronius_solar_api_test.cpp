@@ -20,6 +20,8 @@ FroniusSolarApiTest::FroniusSolarApiTest(QObject *parent) :
 			this, SLOT(onCommonDataFound(CommonInverterData)));
 	connect(&mApi, SIGNAL(threePhasesDataFound(ThreePhasesInverterData)),
 			this, SLOT(onThreePhasesDataFound(ThreePhasesInverterData)));
+	connect(&mApi, SIGNAL(systemDataFound(SystemInverterData)),
+			this, SLOT(onSystemDataFound(SystemInverterData)));
 }
 
 void FroniusSolarApiTest::onConverterInfoFound(const InverterListData &data)
@@ -37,6 +39,11 @@ void FroniusSolarApiTest::onThreePhasesDataFound(const ThreePhasesInverterData &
 	m3PData.reset(new ThreePhasesInverterData(data));
 }
 
+void FroniusSolarApiTest::onSystemDataFound(const SystemInverterData &data)
+{
+	mSystemData.reset(new SystemInverterData(data));
+}
+
 void FroniusSolarApiTest::SetUpTestCase()
 {
 	mProcess = new QProcess();
@@ -106,3 +113,17 @@ TEST_F(FroniusSolarApiTest, getThreePhasesInverterDataSinglePhase)
 	EXPECT_EQ(SolarApiReply::ApiError, m3PData->error);
 	EXPECT_FALSE(m3PData->errorMessage.isEmpty());
 }
+
+TEST_F(FroniusSolarApiTest, getSystemData)
+{
+	mApi.getSystemDataAsync();
+	waitForCompletion(mSystemData);
+
+	EXPECT_EQ(SolarApiReply::NoError, mSystemData->error);
+	EXPECT_TRUE(mSystemData->errorMessage.isEmpty());
+	EXPECT_EQ(3, mSystemData->inverters.size());
+	ASSERT_TRUE(mSystemData->inverters.contains(2));
+	EXPECT_EQ(8000.0, mSystemData->inverters[2].dayEnergy);
+	EXPECT_EQ(44000.0, mSystemData->inverters[2].yearEnergy);
+	EXPECT_GE(mSystemData->inverters[2].totalEnergy, 0);
+}
@@ -29,6 +29,8 @@ public slots:
 
 	void onThreePhasesDataFound(const ThreePhasesInverterData &data);
 
+	void onSystemDataFound(const SystemInverterData &data);
+
 protected:
 	/*! Per-test-case set-up.
 	 * Called before the first test in this test case.
@@ -60,6 +62,7 @@ protected:
 	QScopedPointer<InverterListData> mInverterListData;
 	QScopedPointer<CommonInverterData> mCommonData;
 	QScopedPointer<ThreePhasesInverterData> m3PData;
+	QScopedPointer<SystemInverterData> mSystemData;
 
 private:
 	static QProcess *mProcess;
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <QElapsedTimer>
+#include <QList>
+#include <QThread>
+#include "modbus_io_thread.h"
+#include "modbus_tcp_channel.h"
+#include "test_helper.h"
+
+TEST(ModbusIoThreadTest, EventQueueOverflow)
+{
+	ModbusIoThread::start();
+	ModbusTcpChannel *channel = ModbusTcpChannel::open("127.0.0.1", 1502);
+	// The channel has not been connected, so the I/O thread fails each request right away.
+	// While this test does not return to the event loop, the results are not taken from the
+	// event queue, and most of them end up in the overflow list of the worker.
+	const int batchSize = ModbusIoThread::QueueCapacity / 2;
+	const int count = 3 * ModbusIoThread::QueueCapacity;
+	QList<int> results;
+	for (int i=0; i<count; ++i) {
+		// Give the I/O thread time to empty the command queue
+		if (i % batchSize == 0)
+			QThread::msleep(50);
+		channel->readHoldingRegisters(1, 0, 1,
+			[&results, i](ModbusReply::ExceptionCode error, const RegisterSpan &registers) {
+			EXPECT_EQ(ModbusReply::TcpError, error);
+			EXPECT_TRUE(registers.isEmpty());
+			results.append(i);
+		});
+	}
+	QThread::msleep(50);
+	EXPECT_TRUE(results.isEmpty());
+
+	QElapsedTimer timer;
+	timer.start();
+	while (results.size() < count && timer.elapsed() < 5000)
+		qWait(20);
+	// All results are delivered, in the order of the requests
+	ASSERT_EQ(count, results.size());
+	for (int i=0; i<count; ++i)
+		EXPECT_EQ(i, results[i]);
+	delete channel;
+	ModbusIoThread::stop();
+	EXPECT_EQ(0, ModbusIoThread::instance());
+}
@@ -0,0 +1,256 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <QByteArray>
+#include <QList>
+#include "modbus_tcp_client.h"
+#include "test_helper.h"
+
+/*!
+ * Stands in for the socket. Keeps the requests written by the client, and lets the test send
+ * the replies.
+ */
+class FakeTransport : public ModbusTcpTransport
+{
+public:
+	struct Request
+	{
+		quint16 transactionId;
+		quint8 function;
+		quint16 startReg;
+		quint16 count;
+	};
+
+	FakeTransport():
+		mState(QAbstractSocket::UnconnectedState)
+	{
+	}
+
+	void connectToHost(const QString &hostName, quint16 port) override
+	{
+		Q_UNUSED(hostName)
+		Q_UNUSED(port)
+		mState = QAbstractSocket::ConnectedState;
+		emit connected();
+	}
+
+	void disconnectFromHost() override
+	{
+		mState = QAbstractSocket::UnconnectedState;
+	}
+
+	QAbstractSocket::SocketState state() const override
+	{
+		return mState;
+	}
+
+	qint64 read(char *data, qint64 maxSize) override
+	{
+		int n = static_cast<int>(qMin<qint64>(maxSize, mIncoming.size()));
+		memcpy(data, mIncoming.constData(), n);
+		mIncoming.remove(0, n);
+		return n;
+	}
+
+	qint64 write(const char *data, qint64 size) override
+	{
+		QByteArray frame(data, static_cast<int>(size));
+		Request r;
+		r.transactionId = word(frame, 0);
+		r.function = static_cast<quint8>(frame[7]);
+		r.startReg = word(frame, 8);
+		r.count = word(frame, 10);
+		mRequests.append(r);
+		return size;
+	}
+
+	int pendingCount() const
+	{
+		return mRequests.size();
+	}
+
+	/*!
+	 * Answers the oldest request with `count` registers. If `function` is not 0, it replaces the
+	 * function code of the request.
+	 */
+	void reply(quint8 function = 0)
+	{
+		Request r = mRequests.takeFirst();
+		QByteArray frame;
+		appendWord(frame, r.transactionId);
+		appendWord(frame, 0);
+		appendWord(frame, static_cast<quint16>(3 + 2 * r.count));
+		frame.append(static_cast<char>(1));
+		frame.append(static_cast<char>(function == 0 ? r.function : function));
+		frame.append(static_cast<char>(2 * r.count));
+		for (int i=0; i<r.count; ++i)
+			appendWord(frame, static_cast<quint16>(r.startReg + i));
+		mIncoming.append(frame);
+		emit readyRead();
+	}
+
+	/*!
+	 * Forgets the requests on the wire, as if the device dropped them.
+	 */
+	void drop()
+	{
+		mRequests.clear();
+	}
+
+private:
+	static quint16 word(const QByteArray &frame, int offset)
+	{
+		return static_cast<quint16>((static_cast<quint8>(frame[offset]) << 8) |
+									static_cast<quint8>(frame[offset + 1]));
+	}
+
+	static void appendWord(QByteArray &frame, quint16 w)
+	{
+		frame.append(static_cast<char>(w >> 8));
+		frame.append(static_cast<char>(w & 0xFF));
+	}
+
+	QAbstractSocket::SocketState mState;
+	QList<Request> mRequests;
+	QByteArray mIncoming;
+};
+
+class ModbusTcpClientTest : public testing::Test
+{
+protected:
+	/*!
+	 * Each test uses its own host name, because the serial mode is remembered per endpoint.
+	 */
+	void setUpClient(const QString &hostName, int maxInFlight)
+	{
+		mTransport = new FakeTransport();
+		mClient.reset(new ModbusTcpClient(mTransport));
+		mClient->setMaxInFlight(maxInFlight);
+		mClient->connectToServer(hostName);
+		mErrors = 0;
+		mResults = 0;
+	}
+
+	void read(int count)
+	{
+		for (int i=0; i<count; ++i) {
+			mClient->readHoldingRegisters(1, 100, 2,
+				[this](ModbusReply::ExceptionCode error, const RegisterSpan &registers) {
+				++mResults;
+				if (error != ModbusReply::NoException)
+					++mErrors;
+				else
+					EXPECT_EQ(2, registers.size());
+			});
+		}
+	}
+
+	/*!
+	 * Answers the requests in order until none are left, and returns the largest number of
+	 * requests that were on the wire at the same time.
+	 */
+	int replyAll()
+	{
+		int maxPending = 0;
+		while (mTransport->pendingCount() > 0) {
+			maxPending = qMax(maxPending, mTransport->pendingCount());
+			mTransport->reply();
+		}
+		return maxPending;
+	}
+
+	/*!
+	 * Widens the window to 2 with successful transactions.
+	 */
+	void openWindow()
+	{
+		while (mClient->window() < 2) {
+			read(1);
+			replyAll();
+		}
+	}
+
+	QScopedPointer<ModbusTcpClient> mClient;
+	FakeTransport *mTransport;
+	int mResults;
+	int mErrors;
+};
+
+TEST_F(ModbusTcpClientTest, WindowGrowth)
+{
+	setUpClient("window-growth", 4);
+	EXPECT_EQ(1, mClient->window());
+	read(10);
+	EXPECT_EQ(1, replyAll());
+	EXPECT_EQ(2, mClient->window());
+	read(10);
+	EXPECT_EQ(2, replyAll());
+	EXPECT_EQ(3, mClient->window());
+	read(20);
+	replyAll();
+	EXPECT_EQ(4, mClient->window());
+	// The window does not grow beyond the maximum
+	read(20);
+	EXPECT_EQ(4, replyAll());
+	EXPECT_EQ(4, mClient->window());
+	EXPECT_EQ(60, mResults);
+	EXPECT_EQ(0, mErrors);
+}
+
+TEST_F(ModbusTcpClientTest, FunctionCodeMismatch)
+{
+	setUpClient("function-mismatch", 4);
+	for (int i=0; i<ModbusTcpClient::MaxConcurrencyErrors; ++i) {
+		EXPECT_FALSE(mClient->isSerialOnly()) << i;
+		openWindow();
+		read(2);
+		ASSERT_EQ(2, mTransport->pendingCount());
+		// The reply does not belong to the request with this transaction ID
+		mTransport->reply(4);
+		EXPECT_EQ(1, mErrors);
+		EXPECT_EQ(1, mClient->window());
+		replyAll();
+		mErrors = 0;
+	}
+	EXPECT_TRUE(mClient->isSerialOnly());
+	read(10);
+	EXPECT_EQ(1, replyAll());
+	EXPECT_EQ(1, mClient->window());
+
+	// A new connection probes the window again
+	mClient->connectToServer("function-mismatch");
+	EXPECT_FALSE(mClient->isSerialOnly());
+	read(20);
+	EXPECT_EQ(2, replyAll());
+}
+
+TEST_F(ModbusTcpClientTest, TimeoutDemotion)
+{
+	setUpClient("timeout", 4);
+	mClient->setTimeout(100);
+	for (int i=0; i<ModbusTcpClient::MaxConcurrencyErrors; ++i) {
+		EXPECT_FALSE(mClient->isSerialOnly()) << i;
+		openWindow();
+		read(2);
+		ASSERT_EQ(2, mTransport->pendingCount());
+		// Both requests time out, but that counts as a single error
+		mTransport->drop();
+		qWait(400);
+		EXPECT_EQ(2, mErrors);
+		EXPECT_EQ(1, mClient->window());
+		mErrors = 0;
+	}
+	EXPECT_TRUE(mClient->isSerialOnly());
+}
+
+TEST_F(ModbusTcpClientTest, SerialTimeoutIsNotAnError)
+{
+	setUpClient("serial-timeout", 1);
+	mClient->setTimeout(100);
+	for (int i=0; i<ModbusTcpClient::MaxConcurrencyErrors; ++i) {
+		read(1);
+		mTransport->drop();
+		qWait(300);
+	}
+	EXPECT_EQ(ModbusTcpClient::MaxConcurrencyErrors, mErrors);
+	EXPECT_FALSE(mClient->isSerialOnly());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <qnumeric.h>
+#include "poll_interval_policy.h"
+#include "test_helper.h"
+
+struct IntervalCase
+{
+	const char *name;
+	PollIntervalPolicy::DeviceState state;
+	bool fastModeEnabled;
+	bool limiterRequested;
+	bool fluctuating;
+	int expected;
+};
+
+static void feedPower(PollIntervalPolicy &policy, bool fluctuating)
+{
+	for (int i=0; i<10; ++i)
+		policy.addPowerSample(fluctuating && i % 2 == 1 ? 1000 : 500, 5000);
+}
+
+TEST(PollIntervalPolicyTest, Intervals)
+{
+	typedef PollIntervalPolicy P;
+	static const IntervalCase cases[] = {
+		{ "unknown", P::DeviceUnknown, false, false, false, P::NormalInterval },
+		{ "producing", P::DeviceProducing, false, false, false, P::NormalInterval },
+		{ "fluctuating", P::DeviceProducing, false, false, true, P::FluctuatingInterval },
+		{ "sleeping", P::DeviceSleeping, false, false, false, P::SleepInterval },
+		{ "sleeping, fluctuating", P::DeviceSleeping, false, false, true, P::SleepInterval },
+		{ "throttled", P::DeviceThrottled, false, false, false, P::FastInterval },
+		{ "throttled, fast mode", P::DeviceThrottled, true, false, false, P::FastInterval },
+		{ "limiter", P::DeviceProducing, false, true, false, P::FastInterval },
+		{ "limiter, sleeping", P::DeviceSleeping, false, true, false, P::FastInterval },
+		{ "limiter, fluctuating", P::DeviceProducing, false, true, true, P::FastInterval },
+		{ "fast mode", P::DeviceProducing, true, false, false, P::NormalInterval },
+		{ "fast mode, limiter", P::DeviceProducing, true, true, false, P::FastModeInterval },
+		{ "fast mode, limiter, throttled", P::DeviceThrottled, true, true, false,
+		  P::FastModeInterval },
+		{ "fast mode, limiter, sleeping", P::DeviceSleeping, true, true, true,
+		  P::FastModeInterval }
+	};
+	for (size_t i=0; i<sizeof(cases) / sizeof(cases[0]); ++i) {
+		const IntervalCase &c = cases[i];
+		PollIntervalPolicy policy;
+		policy.setDeviceState(c.state);
+		policy.setFastModeEnabled(c.fastModeEnabled);
+		if (c.limiterRequested)
+			policy.onPowerLimitRequested();
+		feedPower(policy, c.fluctuating);
+		EXPECT_EQ(c.limiterRequested, policy.isLimiterActive()) << c.name;
+		EXPECT_EQ(c.fastModeEnabled && c.limiterRequested, policy.isFastMode()) << c.name;
+		EXPECT_EQ(c.expected, policy.interval()) << c.name;
+	}
+}
+
+TEST(PollIntervalPolicyTest, FluctuationSettles)
+{
+	PollIntervalPolicy policy;
+	policy.setDeviceState(PollIntervalPolicy::DeviceProducing);
+	feedPower(policy, true);
+	EXPECT_EQ(PollIntervalPolicy::FluctuatingInterval, policy.interval());
+	// A steady power brings the moving average back below the threshold
+	feedPower(policy, false);
+	EXPECT_EQ(PollIntervalPolicy::NormalInterval, policy.interval());
+}
+
+TEST(PollIntervalPolicyTest, SmallChangesAreNotFluctuations)
+{
+	PollIntervalPolicy policy;
+	// 1% of the maximum power per cycle
+	for (int i=0; i<20; ++i)
+		policy.addPowerSample(i % 2 == 0 ? 500 : 550, 5000);
+	EXPECT_EQ(PollIntervalPolicy::NormalInterval, policy.interval());
+}
+
+TEST(PollIntervalPolicyTest, InvalidSamplesAreIgnored)
+{
+	PollIntervalPolicy policy;
+	policy.addPowerSample(500, 5000);
+	policy.addPowerSample(qQNaN(), 5000);
+	// No change is computed across an invalid sample
+	policy.addPowerSample(5000, 5000);
+	policy.addPowerSample(5000, 0);
+	policy.addPowerSample(0, 5000);
+	EXPECT_EQ(PollIntervalPolicy::NormalInterval, policy.interval());
+}
+
+TEST(PollIntervalPolicyTest, LimiterHoldExpires)
+{
+	PollIntervalPolicy policy;
+	policy.setLimiterHoldTime(200);
+	policy.setFastModeEnabled(true);
+	policy.setDeviceState(PollIntervalPolicy::DeviceSleeping);
+	EXPECT_EQ(PollIntervalPolicy::SleepInterval, policy.interval());
+	policy.onPowerLimitRequested();
+	EXPECT_TRUE(policy.isFastMode());
+	EXPECT_EQ(PollIntervalPolicy::FastModeInterval, policy.interval());
+	qWait(100);
+	// A new request restarts the hold time
+	policy.onPowerLimitRequested();
+	qWait(150);
+	EXPECT_TRUE(policy.isFastMode());
+	qWait(100);
+	EXPECT_FALSE(policy.isLimiterActive());
+	EXPECT_FALSE(policy.isFastMode());
+	EXPECT_EQ(PollIntervalPolicy::SleepInterval, policy.interval());
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include "poll_scheduler.h"
+#include "test_helper.h"
+
+/*!
+ * Records the start time of each poll. A poll is finished `workTime` milliseconds after it was
+ * started by scheduling the next one, or never if `workTime` is negative.
+ */
+class TestEntry : public PollScheduler::Entry
+{
+public:
+	TestEntry(const QElapsedTimer &clock, const QString &endpoint, int interval,
+			  int workTime = 0):
+		mClock(clock),
+		mEndpoint(endpoint),
+		mInterval(interval),
+		mWorkTime(workTime)
+	{
+	}
+
+	void start()
+	{
+		schedulePoll(mEndpoint, mInterval);
+	}
+
+	void cancel()
+	{
+		cancelPoll();
+	}
+
+	const QList<qint64> &polls() const
+	{
+		return mPolls;
+	}
+
+protected:
+	void onPoll() override
+	{
+		mPolls.append(mClock.elapsed());
+		if (mWorkTime == 0)
+			start();
+		else if (mWorkTime > 0)
+			QTimer::singleShot(mWorkTime, &mContext, [this]() { start(); });
+	}
+
+private:
+	const QElapsedTimer &mClock;
+	QString mEndpoint;
+	int mInterval;
+	int mWorkTime;
+	QList<qint64> mPolls;
+	QObject mContext; // Cancels the pending work when the entry is deleted
+};
+
+TEST(PollSchedulerTest, SpacingOnSameEndpoint)
+{
+	QElapsedTimer clock;
+	clock.start();
+	TestEntry a(clock, "spacing", 10000);
+	TestEntry b(clock, "spacing", 0);
+	TestEntry c(clock, "spacing-other", 0);
+	a.start();
+	qWait(10);
+	b.start();
+	c.start();
+	qWait(200);
+	ASSERT_EQ(1, a.polls().size());
+	ASSERT_GE(b.polls().size(), 2);
+	// The polls on the same endpoint start at least MinPollSpacing apart
+	EXPECT_GE(b.polls()[0] - a.polls()[0], PollScheduler::MinPollSpacing - 1);
+	for (int i=1; i<b.polls().size(); ++i)
+		EXPECT_GE(b.polls()[i] - b.polls()[i - 1], PollScheduler::MinPollSpacing - 1);
+	// The other endpoint is not held up
+	ASSERT_GE(c.polls().size(), 1);
+	EXPECT_LT(c.polls()[0], b.polls()[0]);
+}
+
+TEST(PollSchedulerTest, BusyEndpoint)
+{
+	QElapsedTimer clock;
+	clock.start();
+	TestEntry a(clock, "busy", 10000, 300);
+	TestEntry b(clock, "busy", 0, -1);
+	a.start();
+	qWait(10);
+	b.start();
+	qWait(200);
+	ASSERT_EQ(1, a.polls().size());
+	// The poll of `a` is still in progress
+	EXPECT_TRUE(b.polls().isEmpty());
+	qWait(200);
+	ASSERT_EQ(1, b.polls().size());
+	EXPECT_GE(b.polls()[0] - a.polls()[0], 300 - 1);
+}
+
+TEST(PollSchedulerTest, FixedRate)
+{
+	QElapsedTimer clock;
+	clock.start();
+	TestEntry a(clock, "fixed-rate", 200, 100);
+	a.start();
+	qWait(700);
+	ASSERT_GE(a.polls().size(), 3);
+	// The interval is counted from the moment the previous poll was due, not from the moment
+	// it finished.
+	for (int i=1; i<a.polls().size(); ++i) {
+		qint64 d = a.polls()[i] - a.polls()[i - 1];
+		EXPECT_GE(d, 200 - 1);
+		EXPECT_LT(d, 280);
+	}
+}
+
+TEST(PollSchedulerTest, FixedRateCatchUp)
+{
+	QElapsedTimer clock;
+	clock.start();
+	// The poll takes longer than the interval
+	TestEntry a(clock, "catch-up", 200, 300);
+	a.start();
+	qWait(750);
+	ASSERT_GE(a.polls().size(), 3);
+	// The next poll starts right away, and the missed polls are not made up for
+	for (int i=1; i<a.polls().size(); ++i) {
+		qint64 d = a.polls()[i] - a.polls()[i - 1];
+		EXPECT_GE(d, 300 - 1);
+		EXPECT_LT(d, 380);
+	}
+}
+
+TEST(PollSchedulerTest, FirstPollStagger)
+{
+	QElapsedTimer clock;
+	clock.start();
+	TestEntry a(clock, "stagger", 900);
+	TestEntry b(clock, "stagger", 900);
+	TestEntry c(clock, "stagger", 900);
+	a.start();
+	b.start();
+	c.start();
+	qWait(800);
+	ASSERT_EQ(1, a.polls().size());
+	ASSERT_EQ(1, b.polls().size());
+	ASSERT_EQ(1, c.polls().size());
+	// Each device gets its own slot in the cycle
+	EXPECT_LT(a.polls()[0], 100);
+	EXPECT_GE(b.polls()[0], 450 - 1);
+	EXPECT_LT(b.polls()[0], 550);
+	EXPECT_GE(c.polls()[0], 600 - 1);
+	EXPECT_LT(c.polls()[0], 700);
+}
+
+TEST(PollSchedulerTest, CancelReleasesEndpoint)
+{
+	QElapsedTimer clock;
+	clock.start();
+	TestEntry a(clock, "cancel", 10000, -1);
+	TestEntry b(clock, "cancel", 0, -1);
+	a.start();
+	qWait(10);
+	b.start();
+	qWait(100);
+	ASSERT_EQ(1, a.polls().size());
+	EXPECT_TRUE(b.polls().isEmpty());
+	// The poll in progress no longer blocks the endpoint
+	a.cancel();
+	qWait(100);
+	EXPECT_EQ(1, b.polls().size());
+}
+
+TEST(PollSchedulerTest, PollTimeout)
+{
+	QElapsedTimer clock;
+	clock.start();
+	PollScheduler::instance()->setPollTimeout(300);
+	TestEntry a(clock, "timeout", 10000, -1);
+	TestEntry b(clock, "timeout", 0, -1);
+	a.start();
+	qWait(10);
+	b.start();
+	qWait(200);
+	EXPECT_TRUE(b.polls().isEmpty());
+	qWait(200);
+	PollScheduler::instance()->setPollTimeout(PollScheduler::PollTimeout);
+	// The poll of `a` never finished, and was dropped after the timeout
+	ASSERT_EQ(1, b.polls().size());
+	EXPECT_GE(b.polls()[0] - a.polls()[0], 300 - 1);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include "power_limit_stage.h"
+#include "test_helper.h"
+
+TEST(PowerLimitStageTest, Deadband)
+{
+	PowerLimitStage stage;
+	stage.setDeadband(0.05);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.5, limit);
+	stage.onWriteCompleted(true);
+
+	stage.request(0.53);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+	EXPECT_EQ(1, stage.suppressedCount());
+	stage.request(0.6);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.6, limit);
+	EXPECT_EQ(2, stage.writeCount());
+}
+
+TEST(PowerLimitStageTest, DeadbandEndPoints)
+{
+	PowerLimitStage stage;
+	stage.setDeadband(0.05);
+	double limit = -1;
+
+	stage.request(0.004);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	// Full curtailment is written, even though it is within the deadband
+	stage.request(0);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0, limit);
+	stage.onWriteCompleted(true);
+	stage.request(0);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+
+	stage.request(0.98);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	stage.request(1);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(1, limit);
+	stage.onWriteCompleted(true);
+	EXPECT_EQ(1, stage.suppressedCount());
+}
+
+TEST(PowerLimitStageTest, LatestWins)
+{
+	PowerLimitStage stage;
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.request(0.6);
+	stage.request(0.7);
+	// Nothing is written while a write is in progress
+	EXPECT_FALSE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.7, limit);
+	stage.onWriteCompleted(true);
+	EXPECT_EQ(2, stage.writeCount());
+	// Replaced requests are not suppressed requests
+	EXPECT_EQ(0, stage.suppressedCount());
+}
+
+TEST(PowerLimitStageTest, SuppressedRequestCancelsPending)
+{
+	PowerLimitStage stage;
+	stage.setDeadband(0.05);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	stage.request(0.8);
+	stage.request(0.51);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+	EXPECT_EQ(1, stage.suppressedCount());
+}
+
+TEST(PowerLimitStageTest, MinWriteInterval)
+{
+	PowerLimitStage stage;
+	stage.setMinWriteInterval(300);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	stage.request(0.6);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+	qWait(400);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.6, limit);
+}
+
+TEST(PowerLimitStageTest, KeepAlive)
+{
+	PowerLimitStage stage;
+	stage.setKeepAliveInterval(300);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+	qWait(400);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.5, limit);
+	stage.onWriteCompleted(true);
+
+	// No keep alive after a reset
+	stage.reset();
+	qWait(400);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+}
+
+TEST(PowerLimitStageTest, RetryOnFailure)
+{
+	PowerLimitStage stage;
+	stage.setDeadband(0.05);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(false);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.5, limit);
+
+	// A newer request is written instead of the failed one
+	stage.request(0.7);
+	stage.onWriteCompleted(false);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.7, limit);
+}
+
+TEST(PowerLimitStageTest, ResendAfterReconnect)
+{
+	PowerLimitStage stage;
+	stage.setMinWriteInterval(10000);
+	double limit = 0;
+
+	stage.request(0.5);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	stage.onWriteCompleted(true);
+	stage.request(0.6);
+	EXPECT_FALSE(stage.takeWrite(&limit));
+
+	// After a reconnect the pending value is written right away
+	stage.resend();
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.6, limit);
+	// The connection is lost with a write in progress. Its completion is ignored.
+	stage.resend();
+	stage.onWriteCompleted(true);
+	ASSERT_TRUE(stage.takeWrite(&limit));
+	EXPECT_EQ(0.6, limit);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <QVector>
+#include "register_cache.h"
+
+TEST(RegisterCacheTest, FirstFill)
+{
+	RegisterCache cache;
+	QVector<quint16> values(52, 7);
+	EXPECT_TRUE(cache.update(values));
+	for (int i=0; i<values.size(); ++i)
+		EXPECT_TRUE(cache.isDirty(i)) << i;
+	EXPECT_FALSE(cache.isDirty(52));
+	EXPECT_FALSE(cache.isDirty(-1));
+}
+
+TEST(RegisterCacheTest, Unchanged)
+{
+	RegisterCache cache;
+	QVector<quint16> values(52, 7);
+	cache.update(values);
+	EXPECT_FALSE(cache.update(values));
+	EXPECT_FALSE(cache.isDirty(0, 52));
+}
+
+TEST(RegisterCacheTest, PartialChange)
+{
+	RegisterCache cache;
+	QVector<quint16> values(52, 7);
+	cache.update(values);
+	values[14] = 1000;
+	values[25] = 1;
+	EXPECT_TRUE(cache.update(values));
+	EXPECT_TRUE(cache.isDirty(14));
+	EXPECT_TRUE(cache.isDirty(24, 3));
+	EXPECT_FALSE(cache.isDirty(0, 14));
+	EXPECT_FALSE(cache.isDirty(15, 9));
+	EXPECT_FALSE(cache.isDirty(26, 26));
+	// The change is only reported once
+	EXPECT_FALSE(cache.update(values));
+	EXPECT_FALSE(cache.isDirty(14));
+}
+
+TEST(RegisterCacheTest, SizeChange)
+{
+	RegisterCache cache;
+	QVector<quint16> values(52, 7);
+	cache.update(values);
+	QVector<quint16> longer(62, 7);
+	EXPECT_TRUE(cache.update(longer));
+	EXPECT_TRUE(cache.isDirty(0));
+	EXPECT_TRUE(cache.isDirty(61));
+	cache.update(longer);
+	EXPECT_FALSE(cache.isDirty(0, 62));
+}
+
+TEST(RegisterCacheTest, Clear)
+{
+	RegisterCache cache;
+	QVector<quint16> values(52, 7);
+	cache.update(values);
+	cache.clear();
+	EXPECT_FALSE(cache.isDirty(0, 52));
+	EXPECT_TRUE(cache.update(values));
+	EXPECT_TRUE(cache.isDirty(0, 52));
+}
+
+struct Field
+{
+	const char *name;
+	int index;
+	int count;
+};
+
+/*!
+ * Changes each field of a block in turn, and checks that the parsers see exactly that field as
+ * changed. The fields are the ones used by the SunSpec parsers, with their indices in the block
+ * read from the model.
+ */
+static void checkFields(int blockSize, const Field *fields, int fieldCount)
+{
+	RegisterCache cache;
+	QVector<quint16> values(blockSize, 0);
+	cache.update(values);
+	for (int i=0; i<fieldCount; ++i) {
+		const Field &f = fields[i];
+		values[f.index + f.count - 1] += 1;
+		ASSERT_TRUE(cache.update(values)) << f.name;
+		for (int j=0; j<fieldCount; ++j) {
+			const Field &g = fields[j];
+			EXPECT_EQ(i == j, cache.isDirty(g.index, g.count)) << f.name << " / " << g.name;
+		}
+	}
+}
+
+TEST(RegisterCacheTest, IntegerModelFields)
+{
+	// Models 101-103
+	static const Field fields[] = {
+		{ "A", 2, 1 },
+		{ "AphA-C", 3, 3 },
+		{ "A_SF", 6, 1 },
+		{ "PhVphA", 10, 1 },
+		{ "PhVphB-C", 11, 2 },
+		{ "V_SF", 13, 1 },
+		{ "W", 14, 1 },
+		{ "W_SF", 15, 1 },
+		{ "WH", 24, 2 },
+		{ "WH_SF", 26, 1 },
+		{ "St", 38, 1 }
+	};
+	checkFields(52, fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+TEST(RegisterCacheTest, FloatModelFields)
+{
+	// Models 111-113
+	static const Field fields[] = {
+		{ "A", 2, 2 },
+		{ "AphA-C", 4, 6 },
+		{ "PhVphA", 16, 2 },
+		{ "PhVphB-C", 18, 4 },
+		{ "W", 22, 2 },
+		{ "WH", 32, 2 },
+		{ "St", 48, 1 }
+	};
+	checkFields(62, fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+TEST(RegisterCacheTest, Sunspec2018ModelFields)
+{
+	// Model 701
+	static const Field fields[] = {
+		{ "InvSt", 4, 1 },
+		{ "W", 10, 1 },
+		{ "A", 14, 1 },
+		{ "LNV", 16, 1 },
+		{ "TotWhInj", 19, 4 },
+		{ "AL1", 45, 1 },
+		{ "LNVL1", 47, 1 },
+		{ "AL2", 68, 1 },
+		{ "LNVL2", 70, 1 },
+		{ "AL3", 91, 1 },
+		{ "LNVL3", 93, 1 },
+		{ "A_SF", 113, 1 },
+		{ "V_SF", 114, 1 },
+		{ "W_SF", 116, 1 },
+		{ "TotWh_SF", 120, 1 }
+	};
+	checkFields(121, fields, sizeof(fields) / sizeof(fields[0]));
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "register_planner.h"
+
+TEST(RegisterPlannerTest, MergeNearbyRanges)
+{
+	RegisterPlanner planner(16);
+	planner.add(40072, 52, ModbusCallback());
+	planner.add(40130, 20, ModbusCallback());
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(1, blocks.size());
+	EXPECT_EQ(40072, blocks[0].start);
+	EXPECT_EQ(78, blocks[0].count);
+	EXPECT_EQ(2, blocks[0].ranges.size());
+}
+
+TEST(RegisterPlannerTest, SplitOnGap)
+{
+	RegisterPlanner planner(4);
+	planner.add(100, 10, ModbusCallback());
+	planner.add(115, 10, ModbusCallback());
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(2, blocks.size());
+	EXPECT_EQ(100, blocks[0].start);
+	EXPECT_EQ(10, blocks[0].count);
+	EXPECT_EQ(115, blocks[1].start);
+	EXPECT_EQ(10, blocks[1].count);
+}
+
+TEST(RegisterPlannerTest, SplitOnMaxRegisters)
+{
+	RegisterPlanner planner(16);
+	planner.add(40000, 62, ModbusCallback());
+	planner.add(40062, 62, ModbusCallback());
+	planner.add(40124, 2, ModbusCallback());
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(2, blocks.size());
+	EXPECT_EQ(40000, blocks[0].start);
+	EXPECT_EQ(124, blocks[0].count);
+	EXPECT_EQ(40124, blocks[1].start);
+	EXPECT_EQ(2, blocks[1].count);
+}
+
+TEST(RegisterPlannerTest, UnsortedAndOverlappingRanges)
+{
+	RegisterPlanner planner(0);
+	planner.add(210, 10, ModbusCallback());
+	planner.add(200, 15, ModbusCallback());
+	planner.add(220, 5, ModbusCallback());
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(1, blocks.size());
+	EXPECT_EQ(200, blocks[0].start);
+	EXPECT_EQ(25, blocks[0].count);
+}
+
+TEST(RegisterPlannerTest, MergingDisabled)
+{
+	RegisterPlanner planner;
+	planner.setMaxGap(-1);
+	planner.add(100, 10, ModbusCallback());
+	planner.add(110, 10, ModbusCallback());
+
+	EXPECT_EQ(2, planner.plan().size());
+}
+
+TEST(RegisterPlannerTest, Dispatch)
+{
+	RegisterPlanner planner(16);
+	QVector<quint16> first;
+	QVector<quint16> second;
+	planner.add(10, 3, [&first](ModbusReply::ExceptionCode, const RegisterSpan &values) {
+		first = values.toVector();
+	});
+	planner.add(15, 2, [&second](ModbusReply::ExceptionCode, const RegisterSpan &values) {
+		second = values.toVector();
+	});
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(1, blocks.size());
+	QVector<quint16> values;
+	for (int i=0; i<7; ++i)
+		values.append(static_cast<quint16>(10 + i));
+	RegisterPlanner::dispatch(blocks[0], ModbusReply::NoException, values);
+	EXPECT_EQ(QVector<quint16>() << 10 << 11 << 12, first);
+	EXPECT_EQ(QVector<quint16>() << 15 << 16, second);
+}
+
+TEST(RegisterPlannerTest, DispatchError)
+{
+	RegisterPlanner planner(16);
+	int errorCount = 0;
+	ModbusCallback consumer = [&errorCount](ModbusReply::ExceptionCode error,
+											const RegisterSpan &values) {
+		if (error == ModbusReply::IllegalDataAddress && values.isEmpty())
+			++errorCount;
+	};
+	planner.add(10, 3, consumer);
+	planner.add(15, 2, consumer);
+
+	QList<RegisterPlanner::Block> blocks = planner.plan();
+	ASSERT_EQ(1, blocks.size());
+	RegisterPlanner::dispatch(blocks[0], ModbusReply::IllegalDataAddress, RegisterSpan());
+	EXPECT_EQ(2, errorCount);
+}
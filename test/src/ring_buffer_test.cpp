@@ -0,0 +1,215 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include "register_span.h"
+#include "ring_buffer.h"
+
+// Maximum size of a modbus TCP frame, as in ModbusTcpClient
+static const int MaxAduSize = 260;
+
+/*!
+ * Stands in for the socket. Returns at most `chunkSize` bytes per read.
+ */
+class ChunkDevice
+{
+public:
+	ChunkDevice(int chunkSize = 1 << 30):
+		mChunkSize(chunkSize),
+		mPos(0)
+	{
+	}
+
+	void append(const QByteArray &data)
+	{
+		mData.append(data);
+	}
+
+	int available() const
+	{
+		return mData.size() - mPos;
+	}
+
+	qint64 read(char *data, qint64 maxSize)
+	{
+		int n = static_cast<int>(qMin<qint64>(maxSize, qMin(mChunkSize, available())));
+		memcpy(data, mData.constData() + mPos, n);
+		mPos += n;
+		return n;
+	}
+
+private:
+	QByteArray mData;
+	int mChunkSize;
+	int mPos;
+};
+
+static QByteArray readResponse(quint16 transactionId, const QVector<quint16> &values)
+{
+	QByteArray frame;
+	int length = 3 + 2 * values.size();
+	frame.append(static_cast<char>(transactionId >> 8));
+	frame.append(static_cast<char>(transactionId & 0xFF));
+	frame.append(2, '\0'); // Protocol ID
+	frame.append(static_cast<char>(length >> 8));
+	frame.append(static_cast<char>(length & 0xFF));
+	frame.append(static_cast<char>(1)); // Unit ID
+	frame.append(static_cast<char>(3)); // Read holding registers
+	frame.append(static_cast<char>(2 * values.size()));
+	foreach (quint16 v, values) {
+		frame.append(static_cast<char>(v >> 8));
+		frame.append(static_cast<char>(v & 0xFF));
+	}
+	return frame;
+}
+
+/*!
+ * Splits the buffered data into frames, the way `ModbusTcpClient::onReadyRead` does, and
+ * returns the registers of each complete frame. `invalid` is set if a frame with an invalid
+ * length was found.
+ */
+static QList<QVector<quint16> > takeFrames(RingBuffer &buffer, bool *invalid = 0)
+{
+	QList<QVector<quint16> > frames;
+	for (;;) {
+		if (buffer.size() < 6)
+			break;
+		int length = buffer.toUInt16(4) + 6;
+		if (length > MaxAduSize) {
+			if (invalid != 0)
+				*invalid = true;
+			buffer.clear();
+			break;
+		}
+		if (buffer.size() < length)
+			break;
+		quint16 registers[MaxAduSize / 2];
+		int count = buffer.at(8) / 2;
+		for (int i=0; i<count; ++i)
+			registers[i] = buffer.toUInt16(9 + 2 * i);
+		frames.append(RegisterSpan(registers, count).toVector());
+		buffer.skip(length);
+	}
+	return frames;
+}
+
+TEST(RingBufferTest, FrameSplitAcrossWrapPoint)
+{
+	RingBuffer buffer;
+	ChunkDevice device;
+	// Move the cursors to 3 bytes before the end of the storage, so the next read wraps and the
+	// MBAP header of the frame is split in the middle of the protocol ID.
+	const int fill = RingBuffer::Capacity - 3;
+	device.append(QByteArray(fill, '\x55'));
+	EXPECT_EQ(fill, buffer.readFrom(&device));
+	buffer.skip(fill - 1);
+	EXPECT_EQ(1, buffer.size());
+
+	QVector<quint16> values;
+	values << 0xABCD << 0x0102 << 0xFFFF;
+	QByteArray frame = readResponse(0x1234, values);
+	device.append(frame);
+	EXPECT_EQ(frame.size(), buffer.readFrom(&device));
+	buffer.skip(1);
+	EXPECT_EQ(frame.size(), buffer.size());
+	EXPECT_EQ(0x1234, buffer.toUInt16(0));
+	EXPECT_EQ(0, buffer.toUInt16(2));
+
+	QList<QVector<quint16> > frames = takeFrames(buffer);
+	ASSERT_EQ(1, frames.size());
+	EXPECT_EQ(values, frames.first());
+	EXPECT_EQ(0, buffer.size());
+}
+
+TEST(RingBufferTest, PartialHeader)
+{
+	RingBuffer buffer;
+	// The socket delivers the data one byte at a time
+	ChunkDevice device(1);
+	QVector<quint16> values;
+	values << 1 << 2;
+	QByteArray frame = readResponse(7, values);
+	device.append(frame);
+	device.append(frame);
+	QList<QVector<quint16> > frames;
+	for (int i=0; i<2 * frame.size(); ++i) {
+		EXPECT_EQ(1, buffer.readFrom(&device));
+		frames.append(takeFrames(buffer));
+		// A frame is only taken when it is complete
+		EXPECT_EQ((i + 1) / frame.size(), frames.size()) << i;
+	}
+	EXPECT_EQ(0, buffer.readFrom(&device));
+	ASSERT_EQ(2, frames.size());
+	EXPECT_EQ(values, frames[0]);
+	EXPECT_EQ(values, frames[1]);
+}
+
+TEST(RingBufferTest, LengthLargerThanBuffer)
+{
+	RingBuffer buffer;
+	ChunkDevice device;
+	QByteArray garbage = readResponse(1, QVector<quint16>());
+	// The length field claims more data than the buffer can hold
+	garbage[4] = '\xFF';
+	garbage[5] = '\xFF';
+	device.append(garbage);
+	buffer.readFrom(&device);
+	bool invalid = false;
+	EXPECT_TRUE(takeFrames(buffer, &invalid).isEmpty());
+	EXPECT_TRUE(invalid);
+	EXPECT_EQ(0, buffer.size());
+
+	// The buffer recovers with the next frame
+	QVector<quint16> values;
+	values << 42;
+	device.append(readResponse(2, values));
+	buffer.readFrom(&device);
+	invalid = false;
+	QList<QVector<quint16> > frames = takeFrames(buffer, &invalid);
+	EXPECT_FALSE(invalid);
+	ASSERT_EQ(1, frames.size());
+	EXPECT_EQ(values, frames.first());
+}
+
+TEST(RingBufferTest, FullBuffer)
+{
+	RingBuffer buffer;
+	ChunkDevice device;
+	device.append(QByteArray(RingBuffer::Capacity + 10, '\0'));
+	EXPECT_EQ(RingBuffer::Capacity, buffer.readFrom(&device));
+	EXPECT_EQ(0, buffer.readFrom(&device));
+	EXPECT_EQ(10, device.available());
+	buffer.skip(10);
+	EXPECT_EQ(10, buffer.readFrom(&device));
+	EXPECT_EQ(RingBuffer::Capacity, buffer.size());
+	buffer.skip(RingBuffer::Capacity);
+	EXPECT_EQ(0, buffer.size());
+}
+
+TEST(RegisterSpanTest, Mid)
+{
+	QVector<quint16> values;
+	values << 1 << 2 << 3 << 4;
+	RegisterSpan span(values);
+	EXPECT_EQ(RegisterSpan(values.constData() + 1, 2), span.mid(1, 2));
+	EXPECT_EQ(3, span.mid(1).size());
+	// Truncated at the end of the span
+	EXPECT_EQ(1, span.mid(3, 5).size());
+	EXPECT_EQ(4, span.mid(3, 5)[0]);
+	EXPECT_TRUE(span.mid(4).isEmpty());
+	EXPECT_TRUE(span.mid(-1, 2).isEmpty());
+}
+
+TEST(RegisterSpanTest, Compare)
+{
+	QVector<quint16> a;
+	a << 1 << 2 << 3;
+	QVector<quint16> b = a;
+	EXPECT_TRUE(RegisterSpan(a) == RegisterSpan(b));
+	b[2] = 4;
+	EXPECT_TRUE(RegisterSpan(a) != RegisterSpan(b));
+	EXPECT_TRUE(RegisterSpan(a) != RegisterSpan(a).mid(0, 2));
+	EXPECT_TRUE(RegisterSpan() == RegisterSpan(QVector<quint16>()));
+	EXPECT_EQ(a, RegisterSpan(a).toVector());
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include "scan_cache.h"
+
+static QJsonObject hostRecord(const QString &address, const QString &result, qint64 lastSeen,
+							  qint64 expires)
+{
+	QJsonObject o;
+	o.insert("address", address);
+	o.insert("mac", QString("00:11:22:33:44:55"));
+	o.insert("result", result);
+	o.insert("lastSeen", static_cast<double>(lastSeen));
+	o.insert("expires", static_cast<double>(expires));
+	return o;
+}
+
+static void writeCache(const QString &fileName, const QJsonArray &hosts)
+{
+	QJsonObject root;
+	root.insert("version", 1);
+	root.insert("hosts", hosts);
+	QFile file(fileName);
+	ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+	file.write(QJsonDocument(root).toJson());
+}
+
+TEST(ScanCacheTest, SaveLoadRoundTrip)
+{
+	QTemporaryDir dir;
+	QString fileName = dir.filePath("scan-cache.json");
+	DeviceInfo deviceInfo;
+	deviceInfo.hostName = "192.168.1.20";
+	deviceInfo.retrievalMode = ProtocolSunSpecIntSf;
+	deviceInfo.modbusPort = 1502;
+	deviceInfo.networkId = 126;
+
+	ScanCache cache(fileName);
+	cache.setInverter(deviceInfo, "00:11:22:33:44:55");
+	cache.setNoInverter(QHostAddress("192.168.1.21"), true, "00:11:22:33:44:66");
+	cache.setNoInverter(QHostAddress("192.168.1.22"), false, QString());
+	cache.save();
+
+	ScanCache loaded(fileName);
+	loaded.load();
+	EXPECT_EQ(3, loaded.addresses().size());
+	ASSERT_EQ(1, loaded.inverters().size());
+	EXPECT_EQ(QHostAddress("192.168.1.20"), loaded.inverters().first());
+	EXPECT_FALSE(loaded.isNegative(QHostAddress("192.168.1.20")));
+	EXPECT_TRUE(loaded.isNegative(QHostAddress("192.168.1.21"), "00:11:22:33:44:66"));
+	EXPECT_TRUE(loaded.isNegative(QHostAddress("192.168.1.22"), "00:11:22:33:44:77"));
+	EXPECT_FALSE(loaded.isNegative(QHostAddress("192.168.1.23")));
+}
+
+TEST(ScanCacheTest, MacAddressMismatch)
+{
+	QTemporaryDir dir;
+	ScanCache cache(dir.filePath("scan-cache.json"));
+	QHostAddress address("192.168.1.21");
+	cache.setNoInverter(address, true, "00:11:22:33:44:66");
+	EXPECT_TRUE(cache.isNegative(address));
+	EXPECT_TRUE(cache.isNegative(address, "00:11:22:33:44:66"));
+	// The address has been handed out to another host
+	EXPECT_FALSE(cache.isNegative(address, "00:11:22:33:44:77"));
+}
+
+TEST(ScanCacheTest, ExpiredRecordsAreDropped)
+{
+	QTemporaryDir dir;
+	QString fileName = dir.filePath("scan-cache.json");
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QJsonArray hosts;
+	hosts.append(hostRecord("192.168.1.10", "no-response", now - 1000, now - 1));
+	hosts.append(hostRecord("192.168.1.11", "no-inverter", now - 1000, now + 60000));
+	hosts.append(hostRecord("192.168.1.12", "inverter", now - ScanCache::InverterTtl - 1, 0));
+	hosts.append(hostRecord("192.168.1.13", "inverter", now - 1000, 0));
+	writeCache(fileName, hosts);
+
+	ScanCache cache(fileName);
+	cache.load();
+	EXPECT_EQ(2, cache.addresses().size());
+	EXPECT_FALSE(cache.isNegative(QHostAddress("192.168.1.10")));
+	EXPECT_TRUE(cache.isNegative(QHostAddress("192.168.1.11")));
+	ASSERT_EQ(1, cache.inverters().size());
+	EXPECT_EQ(QHostAddress("192.168.1.13"), cache.inverters().first());
+}
+
+TEST(ScanCacheTest, TrimToMaxRecords)
+{
+	QTemporaryDir dir;
+	QString fileName = dir.filePath("scan-cache.json");
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QJsonArray hosts;
+	// An old inverter, which must survive the trimming
+	hosts.append(hostRecord("10.0.255.1", "inverter", now - 100000, 0));
+	for (int i=0; i<ScanCache::MaxRecords + 10; ++i) {
+		QString address = QHostAddress(0x0a000000 + i + 1).toString();
+		hosts.append(hostRecord(address, "no-inverter", now - 50000 + i, now + 60000));
+	}
+	writeCache(fileName, hosts);
+
+	ScanCache cache(fileName);
+	cache.load();
+	EXPECT_EQ(ScanCache::MaxRecords, cache.addresses().size());
+	EXPECT_EQ(1, cache.inverters().size());
+	// The oldest negative results are dropped
+	for (int i=0; i<11; ++i)
+		EXPECT_FALSE(cache.isNegative(QHostAddress(0x0a000000 + i + 1)));
+	EXPECT_TRUE(cache.isNegative(QHostAddress(0x0a000000 + 12)));
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "scan_concurrency.h"
+
+TEST(ScanConcurrencyTest, AdditiveIncrease)
+{
+	ScanConcurrency concurrency;
+	int limit = concurrency.limit();
+	// Slightly less than one step per round of `limit` hosts, because the limit grows during the
+	// round.
+	for (int i=0; i<limit; ++i)
+		concurrency.onHostProbed(-1, false);
+	EXPECT_EQ(limit, concurrency.limit());
+	for (int i=0; i<limit; ++i)
+		concurrency.onHostProbed(-1, false);
+	EXPECT_EQ(limit + 1, concurrency.limit());
+}
+
+TEST(ScanConcurrencyTest, HalveOnLoss)
+{
+	ScanConcurrency concurrency;
+	concurrency.onHostProbed(2, false);
+	int limit = concurrency.limit();
+	concurrency.onHostProbed(2, true);
+	EXPECT_EQ(limit / 2, concurrency.limit());
+	// No second decrease within the same round
+	concurrency.onHostProbed(2, true);
+	EXPECT_EQ(limit / 2, concurrency.limit());
+}
+
+TEST(ScanConcurrencyTest, HalveOnRttInflation)
+{
+	ScanConcurrency concurrency;
+	concurrency.onHostProbed(2, false);
+	int limit = concurrency.limit();
+	concurrency.onHostProbed(20, false);
+	EXPECT_EQ(limit, concurrency.limit());
+	concurrency.onHostProbed(2 * ScanConcurrency::RttFactor + ScanConcurrency::RttSlack + 1, false);
+	EXPECT_EQ(limit / 2, concurrency.limit());
+	EXPECT_EQ(2, concurrency.baseRtt());
+}
+
+TEST(ScanConcurrencyTest, Bounds)
+{
+	ScanConcurrency concurrency;
+	for (int i=0; i<100; ++i) {
+		for (int j=0; j<ScanConcurrency::MaxLimit; ++j)
+			concurrency.onHostProbed(1, true);
+	}
+	EXPECT_EQ(ScanConcurrency::MinLimit, concurrency.limit());
+	for (int i=0; i<100000; ++i)
+		concurrency.onHostProbed(1, false);
+	EXPECT_EQ(ScanConcurrency::MaxLimit, concurrency.limit());
+}
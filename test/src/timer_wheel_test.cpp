@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <QElapsedTimer>
+#include <functional>
+#include "test_helper.h"
+#include "timer_wheel.h"
+
+class TestTimeout : public TimerWheel::Entry
+{
+public:
+	TestTimeout():
+		mCount(0)
+	{
+	}
+
+	using TimerWheel::Entry::startTimeout;
+	using TimerWheel::Entry::stopTimeout;
+
+	int count() const
+	{
+		return mCount;
+	}
+
+	std::function<void()> action;
+
+protected:
+	void onTimeout() override
+	{
+		++mCount;
+		if (action)
+			action();
+	}
+
+private:
+	int mCount;
+};
+
+TEST(TimerWheelTest, Timeout)
+{
+	TestTimeout a;
+	TestTimeout b;
+	a.startTimeout(100);
+	b.startTimeout(500);
+	EXPECT_EQ(2, TimerWheel::instance()->count());
+	qWait(350);
+	EXPECT_EQ(1, a.count());
+	EXPECT_FALSE(a.isTimeoutActive());
+	EXPECT_EQ(0, b.count());
+	EXPECT_TRUE(b.isTimeoutActive());
+	qWait(400);
+	EXPECT_EQ(1, b.count());
+	EXPECT_EQ(0, TimerWheel::instance()->count());
+}
+
+TEST(TimerWheelTest, SlotWrapAround)
+{
+	// Both timeouts end up in the same slot, one turn of the wheel apart
+	const int turn = TimerWheel::SlotCount * TimerWheel::TickInterval;
+	TestTimeout a;
+	TestTimeout b;
+	a.startTimeout(200);
+	b.startTimeout(turn + 200);
+	qWait(500);
+	EXPECT_EQ(1, a.count());
+	EXPECT_EQ(0, b.count());
+	EXPECT_TRUE(b.isTimeoutActive());
+	qWait(turn - 500);
+	EXPECT_EQ(0, b.count());
+	qWait(500);
+	EXPECT_EQ(1, b.count());
+	EXPECT_EQ(0, TimerWheel::instance()->count());
+}
+
+TEST(TimerWheelTest, Restart)
+{
+	TestTimeout a;
+	a.startTimeout(300);
+	qWait(200);
+	// Restarting replaces the running timeout
+	a.startTimeout(300);
+	EXPECT_EQ(1, TimerWheel::instance()->count());
+	qWait(250);
+	EXPECT_EQ(0, a.count());
+	qWait(300);
+	EXPECT_EQ(1, a.count());
+}
+
+TEST(TimerWheelTest, RearmInCallback)
+{
+	TestTimeout a;
+	a.action = [&a]() {
+		if (a.count() < 3)
+			a.startTimeout(100);
+	};
+	a.startTimeout(100);
+	qWait(1000);
+	EXPECT_EQ(3, a.count());
+	EXPECT_FALSE(a.isTimeoutActive());
+	EXPECT_EQ(0, TimerWheel::instance()->count());
+}
+
+TEST(TimerWheelTest, CancelInCallback)
+{
+	// `a` and `b` expire in the same tick. Whichever fires first cancels the other.
+	TestTimeout a;
+	TestTimeout b;
+	TestTimeout c;
+	a.action = [&b]() { b.stopTimeout(); };
+	b.action = [&a]() { a.stopTimeout(); };
+	a.startTimeout(100);
+	b.startTimeout(100);
+	c.startTimeout(300);
+	qWait(200);
+	EXPECT_EQ(1, a.count() + b.count());
+	EXPECT_FALSE(a.isTimeoutActive());
+	EXPECT_FALSE(b.isTimeoutActive());
+	EXPECT_TRUE(c.isTimeoutActive());
+	qWait(300);
+	EXPECT_EQ(1, c.count());
+	EXPECT_EQ(0, TimerWheel::instance()->count());
+}
+
+TEST(TimerWheelTest, DeleteInCallback)
+{
+	TestTimeout a;
+	TestTimeout *b = new TestTimeout();
+	a.action = [&b]() {
+		delete b;
+		b = 0;
+	};
+	a.startTimeout(100);
+	b->startTimeout(100);
+	qWait(300);
+	EXPECT_EQ(1, a.count());
+	EXPECT_EQ(0, TimerWheel::instance()->count());
+	delete b;
+}
@@ -0,0 +1,141 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include <QScopedPointer>
+#include <qnumeric.h>
+#include <veutil/qt/ve_qitem.hpp>
+#include "test_helper.h"
+#include "ve_service.h"
+
+class TestService : public VeService
+{
+public:
+	TestService(VeQItem *root):
+		VeService(root),
+		mItem(createItem("Ac/Power"))
+	{
+	}
+
+	void setPower(double power)
+	{
+		produceDouble(mItem, power, 0, "W");
+	}
+
+	double latestPower() const
+	{
+		return getDouble(mItem);
+	}
+
+	void setPolicy(const PublishPolicy &policy)
+	{
+		setPublishPolicy(mItem, policy);
+	}
+
+	VeQItem *item() const
+	{
+		return mItem;
+	}
+
+private:
+	VeQItem *mItem;
+};
+
+class VeServiceTest : public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		mItemProducer.reset(new VeProducer(VeQItems::getRoot(), "pub"));
+		VeQItem *root = mItemProducer->services()->itemGetOrCreate("com.victronenergy.pvinverter.test");
+		mService.reset(new TestService(root));
+	}
+
+	virtual void TearDown()
+	{
+		mService.reset();
+		mItemProducer.reset();
+	}
+
+	QVariant published() const
+	{
+		return mService->item()->getValue();
+	}
+
+	QScopedPointer<VeQItemProducer> mItemProducer;
+	QScopedPointer<TestService> mService;
+};
+
+TEST_F(VeServiceTest, Deadband)
+{
+	PublishPolicy policy;
+	policy.deadband = 5;
+	mService->setPolicy(policy);
+
+	mService->setPower(100);
+	EXPECT_EQ(QVariant(100.0), published());
+	mService->setPower(103);
+	EXPECT_EQ(QVariant(100.0), published());
+	EXPECT_EQ(103, mService->latestPower());
+	// The deadband applies to the published value, not to the last value produced
+	mService->setPower(105.5);
+	EXPECT_EQ(QVariant(105.5), published());
+	EXPECT_EQ(QString("106W"), mService->item()->getText());
+}
+
+TEST_F(VeServiceTest, RoundToPrecision)
+{
+	PublishPolicy policy;
+	policy.roundToPrecision = true;
+	mService->setPolicy(policy);
+
+	mService->setPower(100);
+	mService->setPower(100.3);
+	EXPECT_EQ(QVariant(100.0), published());
+	mService->setPower(100.6);
+	EXPECT_EQ(QVariant(100.6), published());
+}
+
+TEST_F(VeServiceTest, HeartbeatPublishesHeldBackValue)
+{
+	PublishPolicy policy;
+	policy.deadband = 50;
+	policy.heartbeatInterval = 100;
+	mService->setPolicy(policy);
+
+	mService->setPower(100);
+	mService->setPower(120);
+	EXPECT_EQ(QVariant(100.0), published());
+	// No further updates: the timer must publish the value
+	qWait(300);
+	EXPECT_EQ(QVariant(120.0), published());
+	EXPECT_EQ(QString("120W"), mService->item()->getText());
+}
+
+TEST_F(VeServiceTest, HeartbeatSkipsRevertedValue)
+{
+	PublishPolicy policy;
+	policy.deadband = 50;
+	policy.heartbeatInterval = 100;
+	mService->setPolicy(policy);
+
+	mService->setPower(100);
+	mService->setPower(120);
+	mService->setPower(100);
+	EXPECT_EQ(100, mService->latestPower());
+	qWait(300);
+	EXPECT_EQ(QVariant(100.0), published());
+}
+
+TEST_F(VeServiceTest, InvalidTransitions)
+{
+	PublishPolicy policy;
+	policy.deadband = 1000;
+	mService->setPolicy(policy);
+
+	mService->setPower(100);
+	mService->setPower(qQNaN());
+	EXPECT_FALSE(published().isValid());
+	EXPECT_TRUE(std::isnan(mService->latestPower()));
+	EXPECT_EQ(QString(), mService->item()->getText());
+	mService->setPower(101);
+	EXPECT_EQ(QVariant(101.0), published());
+}